@@ -7,13 +7,15 @@
 #include "ostrich.h"
 #include "injection.h"
 #include "mutexes.h"
+#include "contexts.h"
 #include "flash_memory.h"
+#include "tune_shadow.h"
+#include "revisions.h"
+#include "trace.h"
 #include <string.h>
 
 // Retrieve anything in flash to be mapped to RP2 RAM                        
 uint8_t* bank_data;
-uint8_t* bank_zero;
-uint8_t* bank_one;
 
 /*
 Sets the clock settings to get the desired execution timing.
@@ -27,47 +29,46 @@ void over_clock(){
 Open the block for mutexes as they must be open to set.
 */
 void enter_block(){
-    mutex_enter_blocking(&tune_data.tune_flag);                                         // Enter mutex for tune_data
-    mutex_enter_blocking(&bank_number.bank_flag);                                       // Enter mutex for bank_number
-}
-
-/*
-Sets the heap memory for flash and ostrich temp
-*/
-void set_memory(){
-    ostrich_temp = malloc(32768);                                                       // cut some memory for ostrich data in ram 
-    flash_temp = malloc(32768);                                                         // cut some memory for flash data in ram
+    for (uint8_t i = 0; i < EMULATION_CONTEXTS; i++){                                   // Every emulation context
+        mutex_enter_blocking(&contexts[i].tune_data.tune_flag);                         // Enter mutex for tune_data
+        mutex_enter_blocking(&contexts[i].bank_number.bank_flag);                       // Enter mutex for bank_number
+    }
 }
 
 /*
 Reads the flash for memory offsets to the location where data is stored.
 */
 void read_flash(){
-    bank_zero = flash_bank_zero();                                                      // Returns XIP_BASE + BANK_ZERO_OFFSET
-    bank_one  = flash_bank_one();                                                       // Returns XIP_BASE + BANK_ONE_OFFSET
+    flash_commits_init();                                                               // Work out which A/B slot holds each tune sector
     bank_data = read_persist();                                                         // Must return valid uint8_t* from flash
+    revisions_init();                                                                   // Find the newest tune revision in the revision ring
 }
 
 /*
-Sets the persistant data i.e. which bank to read and where.
+Sets the persistant data i.e. which bank every context reads and where.
+Context n keeps its banks at [2n] and [2n + 1], a board that never saved
+them for a context reads 0xFF and starts on bank 0.
 */
 void set_banks(){
-    memcpy(persist_data, bank_data, 2);                                                 // Copy 2 bytes from flash into RAM
-    persist_bank   = persist_data[0];                                                   // Not a pointer, just a byte flag
-    volitile_bank  = persist_data[1];                                                   // Same
-    bank_number.current_bank = persist_bank;                                            // set the current bank to persist
+    memcpy(persist_data, bank_data, 2 * EMULATION_CONTEXTS);                            // Copy 2 bytes per context from flash into RAM
+    for (uint8_t i = 0; i < EMULATION_CONTEXTS; i++){
+        emulation_context_t* target = &contexts[i];
+        if (persist_data[2 * i] > 1){persist_data[2 * i] = persist_data[(2 * i) + 1] = 0;}  // Erased flash, there are only 2 banks
+        target->persist_bank   = persist_data[2 * i];                                   // Not a pointer, just a byte flag
+        target->volitile_bank  = persist_data[(2 * i) + 1];                             // Same
+        target->bank_number.current_bank = target->persist_bank;                        // set the current bank to persist
+    }
 }
 
 /*
-Performs the conditional setting up of mutex vars and ostrich temp data.
+Performs the conditional setting up of mutex vars and the tune shadow.
+No bytes are copied here, the shadow reads from the bank in flash
+until a sector is written to.
 */
 void conditional(){
-    tune_data.tune_binary = ostrich_temp;                                               // Sets the temp data address to the pointer mutex
-    tune_data.tune_bytes = 0;                                                           // Set tune bytes to zero so nothing is injecting at start
-    if (persist_bank){
-        memcpy(ostrich_temp, bank_one, 32768);                                          // copy bank one data over if bank 1 is requested
-    } else {
-        memcpy(ostrich_temp, bank_zero, 32768);                                         // set bank zero data if bank zero is requested
+    for (uint8_t i = 0; i < EMULATION_CONTEXTS; i++){
+        contexts[i].tune_data.tune_bytes = 0;                                           // Set tune bytes to zero so nothing is injecting at start
+        shadow_init(&contexts[i].shadow, contexts[i].persist_bank);                     // shadow the active slots of the requested bank
     }
 }
 
@@ -75,8 +76,10 @@ void conditional(){
 Closes the mutex block so that it can be used later.
 */
 void exit_block(){
-    mutex_exit(&tune_data.tune_flag);                                                   // Exit mutexes
-    mutex_exit(&bank_number.bank_flag);                                                 // Exit mutexes
+    for (uint8_t i = 0; i < EMULATION_CONTEXTS; i++){
+        mutex_exit(&contexts[i].tune_data.tune_flag);                                   // Exit mutexes
+        mutex_exit(&contexts[i].bank_number.bank_flag);                                 // Exit mutexes
+    }
 }
 
 /*
@@ -92,10 +95,11 @@ Used to execute;
 voltage regulation, system clock, memory allocation, dual core operation, ostrich initialization.
 */ 
 int main(){          
+    contexts_init();
     mutexes_init();            
     over_clock();
+    trace(TRACE_BOOT, 0, clock_get_hz(clk_sys));
     enter_block();
-    set_memory();
     read_flash();
     set_banks();
     conditional();
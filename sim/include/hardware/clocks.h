@@ -0,0 +1,21 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#ifndef SIM_HARDWARE_CLOCKS_H
+#define SIM_HARDWARE_CLOCKS_H
+#include <stdint.h>
+
+enum clock_index {
+    clk_ref = 4,
+    clk_sys = 5
+};
+
+uint32_t clock_get_hz(enum clock_index clk_index);
+
+#endif
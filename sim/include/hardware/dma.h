@@ -0,0 +1,75 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#ifndef SIM_HARDWARE_DMA_H
+#define SIM_HARDWARE_DMA_H
+#include <stdint.h>
+#include <stdbool.h>
+#include "hardware/gpio.h"
+
+/*
+Host stand-in for the DMA. sim/sim_dma.c moves words between memory
+and the PIO FIFOs on pio1's clock (sim_pio.c), one transfer every
+SIM_DMA_CYCLES once its DREQ is ready, and empties the UART RX FIFOs
+from the UART's own thread (sim_uart.c). dma_hw only exists for the
+addresses of the trigger registers, writing one from a channel starts
+that channel like on the chip, and for write_addr, which follows the
+writes of a channel like on the chip.
+*/
+#define NUM_DMA_CHANNELS    (16u)
+
+enum dma_channel_transfer_size {
+    DMA_SIZE_8 = 0,
+    DMA_SIZE_16 = 1,
+    DMA_SIZE_32 = 2
+};
+
+typedef struct {
+    volatile uint32_t read_addr;
+    volatile uint32_t write_addr;
+    volatile uint32_t transfer_count;
+    volatile uint32_t al3_read_addr_trig;
+} dma_channel_hw_t;
+
+typedef struct {
+    dma_channel_hw_t ch[NUM_DMA_CHANNELS];
+} dma_hw_t;
+
+extern dma_hw_t* const dma_hw;
+
+typedef struct {
+    enum dma_channel_transfer_size size;
+    bool read_increment;
+    bool write_increment;
+    uint dreq;
+    uint chain_to;
+    bool high_priority;
+    bool ring_write;
+    uint ring_bits;
+} dma_channel_config;
+
+#define DREQ_FORCE          (0x3Fu)
+#define DMA_ENDLESS         (0xF0000000u)   // TRANS_COUNT mode: never runs out
+
+int dma_claim_unused_channel(bool required);
+dma_channel_config dma_channel_get_default_config(uint channel);
+void channel_config_set_transfer_data_size(dma_channel_config* c, enum dma_channel_transfer_size size);
+void channel_config_set_read_increment(dma_channel_config* c, bool increment);
+void channel_config_set_write_increment(dma_channel_config* c, bool increment);
+void channel_config_set_dreq(dma_channel_config* c, uint dreq);
+void channel_config_set_chain_to(dma_channel_config* c, uint chain_to);
+void channel_config_set_high_priority(dma_channel_config* c, bool high_priority);
+void channel_config_set_ring(dma_channel_config* c, bool write, uint size_bits);
+uint32_t dma_encode_endless_transfer_count(void);
+dma_channel_hw_t* dma_channel_hw_addr(uint channel);
+void dma_channel_configure(uint channel, const dma_channel_config* config, volatile void* write_addr,
+                           const volatile void* read_addr, uint transfer_count, bool trigger);
+void dma_channel_start(uint channel);
+
+#endif
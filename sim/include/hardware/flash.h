@@ -0,0 +1,27 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#ifndef SIM_HARDWARE_FLASH_H
+#define SIM_HARDWARE_FLASH_H
+#include <stdint.h>
+#include <stddef.h>
+
+#define FLASH_PAGE_SIZE     (1u << 8)
+#define FLASH_SECTOR_SIZE   (1u << 12)
+#define FLASH_BLOCK_SIZE    (1u << 16)
+
+/*
+Erase and program work on the mapped flash image with the same
+rules as the chip: sector aligned erases, page aligned programs
+that can only clear bits, and never from a buffer in flash.
+*/
+void flash_range_erase(uint32_t flash_offs, size_t count);
+void flash_range_program(uint32_t flash_offs, const uint8_t* data, size_t count);
+
+#endif
@@ -0,0 +1,35 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#ifndef SIM_HARDWARE_GPIO_H
+#define SIM_HARDWARE_GPIO_H
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef unsigned int uint;
+
+#define NUM_BANK0_GPIOS     (48u)
+
+enum gpio_function {
+    GPIO_FUNC_SIO = 5,
+    GPIO_FUNC_UART = 2,
+    GPIO_FUNC_PIO0 = 6,
+    GPIO_FUNC_PIO1 = 7,
+    GPIO_FUNC_NULL = 0x1f
+};
+
+void gpio_init(uint gpio);
+void gpio_deinit(uint gpio);
+void gpio_set_dir(uint gpio, bool out);
+void gpio_put(uint gpio, bool value);
+bool gpio_get(uint gpio);
+void gpio_set_function(uint gpio, enum gpio_function fn);
+void gpio_pull_up(uint gpio);
+
+#endif
@@ -0,0 +1,22 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#ifndef SIM_HARDWARE_IRQ_H
+#define SIM_HARDWARE_IRQ_H
+#include <stdbool.h>
+
+#define SIM_NUM_IRQS        (52u)
+
+typedef void (*irq_handler_t)(void);
+
+void irq_set_exclusive_handler(unsigned num, irq_handler_t handler);
+void irq_set_enabled(unsigned num, bool enabled);
+bool irq_is_enabled(unsigned num);
+
+#endif
@@ -0,0 +1,113 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#ifndef SIM_HARDWARE_PIO_H
+#define SIM_HARDWARE_PIO_H
+#include <stdint.h>
+#include <stdbool.h>
+#include "hardware/gpio.h"
+
+/*
+There is no PIO on the host, sim/sim_pio.c runs the programs itself,
+one instruction per cycle:
+
+    pio0    clocked by core 1: every word pushed into the injection
+            state machine is one write cycle on the out pins, decoded
+            against the SRAM wiring (exactly what injection.pio does
+            with a word). The other state machines (the bus snoop) run
+            while the word waits for its turn on the bus.
+    pio1    runs on its own thread once a state machine is enabled,
+            together with the DMA (sim_dma.c) and the ECU (sim_bus.c),
+            in ROM_EMULATION builds. Otherwise it and pio2 are clocked
+            by core 1 like pio0, for the extra emulation contexts.
+
+txf and rxf are only there for their addresses, DMA transfers to and
+from them reach the FIFOs.
+*/
+#define NUM_PIOS                (3u)
+#define NUM_PIO_STATE_MACHINES  (4u)
+#define PIO_INSTRUCTION_COUNT   (32u)
+
+typedef struct {
+    volatile uint32_t txf[NUM_PIO_STATE_MACHINES];
+    volatile uint32_t rxf[NUM_PIO_STATE_MACHINES];
+} pio_hw_t;
+
+typedef pio_hw_t* PIO;
+
+extern PIO pio0;
+extern PIO pio1;
+extern PIO pio2;
+
+typedef struct {
+    uint in_base;
+    uint jmp_pin;
+    uint out_base;
+    uint out_count;
+    uint set_base;
+    uint set_count;
+    bool in_right;
+    bool out_right;
+    uint pull_threshold;
+    float clkdiv;
+    uint wrap_target;
+    uint wrap;
+} pio_sm_config;
+
+enum pio_src_dest {
+    pio_pins = 0,
+    pio_x = 1,
+    pio_y = 2,
+    pio_null = 3,
+    pio_pindirs = 3,                                    // As a MOV destination (RP2350)
+    pio_isr = 6,
+    pio_osr = 7
+};
+
+typedef struct pio_program {
+    const uint16_t* instructions;
+    uint8_t length;
+    int8_t origin;
+    uint8_t pio_version;
+} pio_program_t;
+
+pio_sm_config pio_get_default_sm_config(void);
+void sm_config_set_wrap(pio_sm_config* c, uint wrap_target, uint wrap);
+void sm_config_set_in_pins(pio_sm_config* c, uint in_base);
+void sm_config_set_in_shift(pio_sm_config* c, bool shift_right, bool autopush, uint push_threshold);
+void sm_config_set_jmp_pin(pio_sm_config* c, uint pin);
+void sm_config_set_out_pins(pio_sm_config* c, uint out_base, uint out_count);
+void sm_config_set_out_shift(pio_sm_config* c, bool shift_right, bool autopull, uint pull_threshold);
+void sm_config_set_set_pins(pio_sm_config* c, uint set_base, uint set_count);
+void sm_config_set_clkdiv(pio_sm_config* c, float div);
+
+uint pio_add_program(PIO pio, const pio_program_t* program);
+uint pio_get_index(PIO pio);
+PIO pio_get_instance(uint instance);
+uint pio_get_dreq(PIO pio, uint sm, bool is_tx);
+void pio_gpio_init(PIO pio, uint pin);
+void pio_sm_set_consecutive_pindirs(PIO pio, uint sm, uint pin_base, uint pin_count, bool is_out);
+void pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config* config);
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled);
+void pio_enable_sm_mask_in_sync(PIO pio, uint32_t mask);
+void pio_sm_put(PIO pio, uint sm, uint32_t data);
+void pio_sm_put_blocking(PIO pio, uint sm, uint32_t data);
+void pio_sm_exec(PIO pio, uint sm, uint instr);
+bool pio_sm_is_tx_fifo_full(PIO pio, uint sm);
+bool pio_sm_is_tx_fifo_empty(PIO pio, uint sm);
+
+static inline uint pio_encode_pull(bool if_empty, bool block){
+    return 0x8080u | (if_empty ? 0x40u : 0u) | (block ? 0x20u : 0u);
+}
+
+static inline uint pio_encode_mov(enum pio_src_dest dest, enum pio_src_dest src){
+    return 0xA000u | ((uint)dest << 5) | (uint)src;
+}
+
+#endif
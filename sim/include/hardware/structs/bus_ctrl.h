@@ -0,0 +1,29 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#ifndef SIM_HARDWARE_STRUCTS_BUS_CTRL_H
+#define SIM_HARDWARE_STRUCTS_BUS_CTRL_H
+#include <stdint.h>
+
+/*
+Host stand-in for the bus fabric priority register. There is no bus
+fabric on the host, SIM_DMA_CYCLES already assumes DMA goes first.
+*/
+#define BUSCTRL_BUS_PRIORITY_PROC0_BITS     (0x00000001u)
+#define BUSCTRL_BUS_PRIORITY_PROC1_BITS     (0x00000010u)
+#define BUSCTRL_BUS_PRIORITY_DMA_R_BITS     (0x00000100u)
+#define BUSCTRL_BUS_PRIORITY_DMA_W_BITS     (0x00001000u)
+
+typedef struct {
+    volatile uint32_t priority;
+} bus_ctrl_hw_t;
+
+extern bus_ctrl_hw_t* const bus_ctrl_hw;
+
+#endif
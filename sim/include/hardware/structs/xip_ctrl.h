@@ -0,0 +1,26 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#ifndef SIM_HARDWARE_STRUCTS_XIP_CTRL_H
+#define SIM_HARDWARE_STRUCTS_XIP_CTRL_H
+#include "pico/stdlib.h"
+
+/*
+Host stand-in for the XIP cache counters. The sim reads its flash image
+straight from memory, there is no cache, so both counters stay at zero
+(defined in sim_flash.c).
+*/
+typedef struct {
+    volatile uint32_t ctr_hit;
+    volatile uint32_t ctr_acc;
+} xip_ctrl_hw_t;
+
+extern xip_ctrl_hw_t* const xip_ctrl_hw;
+
+#endif
@@ -0,0 +1,69 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#ifndef SIM_HARDWARE_UART_H
+#define SIM_HARDWARE_UART_H
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+uart0 is a PTY (the "ecu" link printed at boot), point the ECU
+simulator (ecu_sim, built with the sim) at it with -d. uart1 is not wired.
+*/
+typedef struct uart_inst uart_inst_t;
+
+extern uart_inst_t* uart0;
+extern uart_inst_t* uart1;
+
+#define UART0_IRQ           (33)
+#define UART1_IRQ           (34)
+
+/*
+Of the registers only the data register (a DMA read address, reads
+pop the RX FIFO) and the receive status are there. A PTY never has
+framing, parity or break errors, the only error the sim makes is an
+overrun: bytes the ECU sent while the 32 byte RX FIFO was full are
+lost and the next byte carries UART_UARTDR_OE_BITS.
+*/
+typedef struct {
+    volatile uint32_t dr;
+    volatile uint32_t rsr;
+} uart_hw_t;
+
+#define UART_UARTRSR_BITS   (0x0000000fu)
+#define UART_UARTDR_OE_BITS (0x00000800u)
+#define UART_UARTDR_BE_BITS (0x00000400u)
+#define UART_UARTDR_PE_BITS (0x00000200u)
+#define UART_UARTDR_FE_BITS (0x00000100u)
+#define DREQ_UART0_TX       (28u)
+#define DREQ_UART0_RX       (29u)
+#define DREQ_UART1_TX       (30u)
+#define DREQ_UART1_RX       (31u)
+
+typedef enum {
+    UART_PARITY_NONE,
+    UART_PARITY_EVEN,
+    UART_PARITY_ODD
+} uart_parity_t;
+
+unsigned uart_init(uart_inst_t* uart, unsigned baudrate);
+void uart_set_format(uart_inst_t* uart, unsigned data_bits, unsigned stop_bits, uart_parity_t parity);
+void uart_set_fifo_enabled(uart_inst_t* uart, bool enabled);
+void uart_set_irq_enables(uart_inst_t* uart, bool rx_has_data, bool tx_needs_data);
+bool uart_is_readable(uart_inst_t* uart);
+bool uart_is_writable(uart_inst_t* uart);
+char uart_getc(uart_inst_t* uart);
+void uart_putc_raw(uart_inst_t* uart, char c);
+void uart_write_blocking(uart_inst_t* uart, const uint8_t* src, size_t len);
+unsigned uart_get_index(uart_inst_t* uart);
+uart_hw_t* uart_get_hw(uart_inst_t* uart);
+unsigned uart_get_dreq(uart_inst_t* uart, bool is_tx);
+
+#endif
@@ -0,0 +1,22 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#ifndef SIM_HARDWARE_VREG_H
+#define SIM_HARDWARE_VREG_H
+
+enum vreg_voltage {
+    VREG_VOLTAGE_1_10 = 0x0b,
+    VREG_VOLTAGE_1_15 = 0x0c,
+    VREG_VOLTAGE_1_20 = 0x0d,
+    VREG_VOLTAGE_DEFAULT = VREG_VOLTAGE_1_10
+};
+
+void vreg_set_voltage(enum vreg_voltage voltage);
+
+#endif
@@ -0,0 +1,153 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#ifndef SIM_INJECTION_PIO_H
+#define SIM_INJECTION_PIO_H
+#include "hardware/pio.h"
+
+/*
+Stands in for the header pioasm generates from src/injection.pio.
+The injection instructions are only loaded for their length, sim_pio.c
+turns every word into a write cycle itself. The snoop instructions are
+run by sim_pio.c against the ECU bus model (sim_bus.c). The *_init()
+functions are the c-sdk blocks of injection.pio word for word, keep
+the two in step.
+*/
+#define injection_wrap_target 0
+#define injection_wrap 10
+#define injection_pio_version 0
+
+static const uint16_t injection_program_instructions[] = {
+            //     .wrap_target
+    0xe007, //  0: set    pins, 7
+    0x80a0, //  1: pull   block
+    0x6068, //  2: out    null, 8
+    0x6038, //  3: out    x, 24
+    0x20c0, //  4: wait   1 irq, 0
+    0xa001, //  5: mov    pins, x
+    0xe001, //  6: set    pins, 1
+    0xa542, //  7: nop                    [5]
+    0xe020, //  8: set    x, 0
+    0xe003, //  9: set    pins, 3
+    0xa001, // 10: mov    pins, x
+            //     .wrap
+};
+
+static const struct pio_program injection_program = {
+    .instructions = injection_program_instructions,
+    .length = 11,
+    .origin = -1,
+    .pio_version = injection_pio_version,
+};
+
+static inline pio_sm_config injection_program_get_default_config(uint offset) {
+    pio_sm_config c = pio_get_default_sm_config();
+    sm_config_set_wrap(&c, offset + injection_wrap_target, offset + injection_wrap);
+    return c;
+}
+
+// DO NOT touch below unless you absolutely have to. Helper script for setting up ASM.
+
+void injection_program_init(PIO pio, 
+                            uint state_machine, 
+                            int offset, 
+                            uint8_t pin_start,
+                            uint8_t pin_count,
+                            float div){
+
+    pio_sm_config c = injection_program_get_default_config(offset);
+    sm_config_set_out_shift(&c, false, false, 32);
+    sm_config_set_out_pins(&c, pin_start, pin_count);
+    sm_config_set_set_pins(&c, pin_start + pin_count, 3);
+    for (uint i = pin_start; i < (pin_count); i++){
+        pio_gpio_init(pio, i);
+    }
+    for (uint i = 0; i < 3; i++){
+        pio_gpio_init(pio, i + pin_start + pin_count);
+    }
+    pio_sm_set_consecutive_pindirs(pio, state_machine, pin_start, pin_count + 3, true);
+    sm_config_set_clkdiv(&c, div);
+    pio_sm_init(pio, state_machine, offset, &c);
+}
+
+#define snoop_wrap_target 0
+#define snoop_wrap 20
+#define snoop_pio_version 0
+
+#define snoop_offset_watch 0u
+#define snoop_offset_always 19u
+
+static const uint16_t snoop_program_instructions[] = {
+            //     .wrap_target
+    0x20a0, //  0: wait   1 pin, 0
+    0xa022, //  1: mov    x, y
+    0x00c4, //  2: jmp    pin, 4
+    0x0000, //  3: jmp    0
+    0x0042, //  4: jmp    x--, 2
+    0xa027, //  5: mov    x, osr
+    0x00c8, //  6: jmp    pin, 8
+    0x000a, //  7: jmp    10
+    0xc000, //  8: irq    nowait 0
+    0x0046, //  9: jmp    x--, 6
+    0xc040, // 10: irq    clear 0
+    0xa026, // 11: mov    x, isr
+    0x00ce, // 12: jmp    pin, 14
+    0x0000, // 13: jmp    0
+    0x004c, // 14: jmp    x--, 12
+    0x00d1, // 15: jmp    pin, 17
+    0x000a, // 16: jmp    10
+    0xc000, // 17: irq    nowait 0
+    0x000f, // 18: jmp    15
+    0xc000, // 19: irq    nowait 0
+    0x0013, // 20: jmp    19
+            //     .wrap
+};
+
+static const struct pio_program snoop_program = {
+    .instructions = snoop_program_instructions,
+    .length = 21,
+    .origin = -1,
+    .pio_version = snoop_pio_version,
+};
+
+static inline pio_sm_config snoop_program_get_default_config(uint offset) {
+    pio_sm_config c = pio_get_default_sm_config();
+    sm_config_set_wrap(&c, offset + snoop_wrap_target, offset + snoop_wrap);
+    return c;
+}
+
+// Loads guard, window and offline (in loops, see above) and starts at watch, or at always when snoop is false.
+
+void snoop_program_init(PIO pio,
+                        uint state_machine,
+                        uint offset,
+                        uint8_t pin,
+                        bool snoop,
+                        uint32_t guard,
+                        uint32_t window,
+                        uint32_t offline){
+
+    pio_sm_config c = snoop_program_get_default_config(offset);
+    sm_config_set_in_pins(&c, pin);
+    sm_config_set_jmp_pin(&c, pin);
+    pio_gpio_init(pio, pin);
+    gpio_pull_up(pin);
+    pio_sm_set_consecutive_pindirs(pio, state_machine, pin, 1, false);
+    pio_sm_init(pio, state_machine, offset + (snoop ? snoop_offset_watch : snoop_offset_always), &c);
+    pio_sm_put(pio, state_machine, guard);
+    pio_sm_exec(pio, state_machine, pio_encode_pull(false, false));
+    pio_sm_exec(pio, state_machine, pio_encode_mov(pio_y, pio_osr));
+    pio_sm_put(pio, state_machine, offline);
+    pio_sm_exec(pio, state_machine, pio_encode_pull(false, false));
+    pio_sm_exec(pio, state_machine, pio_encode_mov(pio_isr, pio_osr));
+    pio_sm_put(pio, state_machine, window);
+    pio_sm_exec(pio, state_machine, pio_encode_pull(false, false));
+}
+
+#endif
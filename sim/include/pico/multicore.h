@@ -0,0 +1,25 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#ifndef SIM_PICO_MULTICORE_H
+#define SIM_PICO_MULTICORE_H
+#include "pico/stdlib.h"
+
+/*
+Core 1 is a thread. A lockout parks it the next time it calls
+multicore_lockout_victim_init() (or sleeps), which core 1 does
+on every pass of every loop in injection.c.
+*/
+void multicore_launch_core1(void (*entry)(void));
+void multicore_lockout_victim_init(void);
+bool multicore_lockout_victim_is_initialized(uint core_num);
+void multicore_lockout_start_blocking(void);
+void multicore_lockout_end_blocking(void);
+
+#endif
@@ -0,0 +1,84 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#ifndef SIM_PICO_STDLIB_H
+#define SIM_PICO_STDLIB_H
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+/*
+Host stand-in for the parts of pico/stdlib.h Aetherion uses (see sim/).
+XIP_BASE points at the flash image the sim maps in, so every
+(XIP_BASE + offset) read in src/ lands in that file.
+SRAM_BASE is the start of the sim's own static data so the boot
+memory report still adds up.
+*/
+typedef unsigned int uint;
+
+extern uint8_t* sim_xip;
+extern char __data_start;
+
+#define XIP_BASE            ((uintptr_t)sim_xip)
+#define SRAM_BASE           ((uintptr_t)&__data_start)
+#define SRAM_STRIPED_BASE   (0u)                        // No SRAM banks on the host,
+#define SRAM_STRIPED_END    (0u)                        // nothing is ever in one
+#define SRAM8_BASE          (0u)
+#define SRAM9_BASE          (0u)
+#define SRAM_END            (0u)
+
+/*
+Everything runs from host RAM, the placement macros only
+have to compile.
+*/
+#define __not_in_flash(group)
+#define __not_in_flash_func(func_name)  func_name
+#define __time_critical_func(func_name) func_name
+#define __scratch_x(group)
+#define __scratch_y(group)
+#define __uninitialized_ram(name)       name
+#define __aligned(bytes)                __attribute__((aligned(bytes)))
+#define __unused                        __attribute__((unused))
+#define count_of(a)                     (sizeof(a) / sizeof((a)[0]))
+
+#define GPIO_OUT            (1)
+#define GPIO_IN             (0)
+
+uint64_t time_us_64(void);
+uint32_t time_us_32(void);
+void sleep_ms(uint32_t ms);
+void sleep_us(uint64_t us);
+void busy_wait_us_32(uint32_t us);
+void tight_loop_contents(void);
+bool set_sys_clock_khz(uint32_t freq_khz, bool required);
+uint get_core_num(void);
+void panic(const char* fmt, ...);
+#define hard_assert(condition) ((condition) ? (void)0 : panic("hard_assert: %s", #condition))
+
+/*
+Repeating timers run on their own thread, the callback is
+called with interrupts "disabled" like an alarm IRQ on core 0.
+*/
+typedef struct repeating_timer repeating_timer_t;
+typedef bool (*repeating_timer_callback_t)(repeating_timer_t* timer);
+struct repeating_timer {
+    int64_t delay_us;
+    void* user_data;
+    repeating_timer_callback_t callback;
+    volatile bool cancelled;
+};
+
+bool add_repeating_timer_us(int64_t delay_us, repeating_timer_callback_t callback, void* user_data, repeating_timer_t* out);
+bool cancel_repeating_timer(repeating_timer_t* timer);
+
+#include "hardware/gpio.h"
+#include "hardware/uart.h"
+
+#endif
@@ -0,0 +1,37 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#ifndef SIM_PICO_SYNC_H
+#define SIM_PICO_SYNC_H
+#include <pthread.h>
+#include "pico/stdlib.h"
+
+/*
+Pico mutexes are pthread mutexes on the host. Interrupts are a
+single recursive lock: core 0 code that disables interrupts holds
+it and the sim's interrupt threads hold it while a handler runs.
+*/
+typedef struct {
+    pthread_mutex_t lock;
+} mutex_t;
+
+void mutex_init(mutex_t* mtx);
+void mutex_enter_blocking(mutex_t* mtx);
+bool mutex_try_enter(mutex_t* mtx, uint32_t* owner_out);
+void mutex_exit(mutex_t* mtx);
+
+uint32_t save_and_disable_interrupts(void);
+void restore_interrupts(uint32_t status);
+
+#define __dmb()                         __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define __compiler_memory_barrier()     __atomic_signal_fence(__ATOMIC_SEQ_CST)
+#define __sev()                         ((void)0)
+#define __wfe()                         tight_loop_contents()
+
+#endif
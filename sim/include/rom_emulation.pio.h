@@ -0,0 +1,140 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#ifndef SIM_ROM_EMULATION_PIO_H
+#define SIM_ROM_EMULATION_PIO_H
+#include "hardware/pio.h"
+#include "hardware/gpio.h"
+
+/*
+Stands in for the header pioasm generates from src/rom_emulation.pio.
+All three programs are run by sim_pio.c on pio1 against the DMA
+(sim_dma.c) and the ECU's ROM reads (sim_bus.c). The *_init()
+functions are the c-sdk blocks of rom_emulation.pio word for word,
+keep the two in step.
+*/
+#define rom_address_wrap_target 0
+#define rom_address_wrap 3
+#define rom_address_pio_version 1
+
+static const uint16_t rom_address_program_instructions[] = {
+            //     .wrap_target
+    0x4051, //  0: in     y, 17
+    0x400f, //  1: in     pins, 15
+    0x8020, //  2: push   block
+    0x20c1, //  3: wait   1 irq, 1
+            //     .wrap
+};
+
+static const struct pio_program rom_address_program = {
+    .instructions = rom_address_program_instructions,
+    .length = 4,
+    .origin = -1,
+    .pio_version = rom_address_pio_version,
+};
+
+static inline pio_sm_config rom_address_program_get_default_config(uint offset) {
+    pio_sm_config c = pio_get_default_sm_config();
+    sm_config_set_wrap(&c, offset + rom_address_wrap_target, offset + rom_address_wrap);
+    return c;
+}
+
+// Samples the 15 address pins from address_pin up, image must be 32kb aligned.
+
+void rom_address_program_init(PIO pio, uint state_machine, uint offset, uint address_pin, const void* image){
+    pio_sm_config c = rom_address_program_get_default_config(offset);
+    sm_config_set_in_pins(&c, address_pin);
+    sm_config_set_in_shift(&c, false, false, 32);
+    for (uint i = 0; i < 15; i++){
+        pio_gpio_init(pio, address_pin + i);
+    }
+    pio_sm_set_consecutive_pindirs(pio, state_machine, address_pin, 15, false);
+    pio_sm_init(pio, state_machine, offset, &c);
+    pio_sm_put(pio, state_machine, (uint32_t)((uintptr_t)image >> 15));
+    pio_sm_exec(pio, state_machine, pio_encode_pull(false, false));
+    pio_sm_exec(pio, state_machine, pio_encode_mov(pio_y, pio_osr));
+}
+
+#define rom_data_wrap_target 0
+#define rom_data_wrap 2
+#define rom_data_pio_version 1
+
+static const uint16_t rom_data_program_instructions[] = {
+            //     .wrap_target
+    0x80a0, //  0: pull   block
+    0x6008, //  1: out    pins, 8
+    0xc001, //  2: irq    nowait 1
+            //     .wrap
+};
+
+static const struct pio_program rom_data_program = {
+    .instructions = rom_data_program_instructions,
+    .length = 3,
+    .origin = -1,
+    .pio_version = rom_data_pio_version,
+};
+
+static inline pio_sm_config rom_data_program_get_default_config(uint offset) {
+    pio_sm_config c = pio_get_default_sm_config();
+    sm_config_set_wrap(&c, offset + rom_data_wrap_target, offset + rom_data_wrap);
+    return c;
+}
+
+// Drives the 8 data pins from data_pin up, their direction belongs to rom_enable.
+
+void rom_data_program_init(PIO pio, uint state_machine, uint offset, uint data_pin){
+    pio_sm_config c = rom_data_program_get_default_config(offset);
+    sm_config_set_out_pins(&c, data_pin, 8);
+    sm_config_set_out_shift(&c, true, false, 32);
+    for (uint i = 0; i < 8; i++){
+        pio_gpio_init(pio, data_pin + i);
+    }
+    pio_sm_set_consecutive_pindirs(pio, state_machine, data_pin, 8, false);
+    pio_sm_init(pio, state_machine, offset, &c);
+}
+
+#define rom_enable_wrap_target 0
+#define rom_enable_wrap 3
+#define rom_enable_pio_version 1
+
+static const uint16_t rom_enable_program_instructions[] = {
+            //     .wrap_target
+    0x2020, //  0: wait   0 pin, 0
+    0xa06b, //  1: mov    pindirs, ~null
+    0x20a0, //  2: wait   1 pin, 0
+    0xa063, //  3: mov    pindirs, null
+            //     .wrap
+};
+
+static const struct pio_program rom_enable_program = {
+    .instructions = rom_enable_program_instructions,
+    .length = 4,
+    .origin = -1,
+    .pio_version = rom_enable_pio_version,
+};
+
+static inline pio_sm_config rom_enable_program_get_default_config(uint offset) {
+    pio_sm_config c = pio_get_default_sm_config();
+    sm_config_set_wrap(&c, offset + rom_enable_wrap_target, offset + rom_enable_wrap);
+    return c;
+}
+
+// Follows the ECU's select on select_pin, owns the direction of the 8 data pins from data_pin up.
+
+void rom_enable_program_init(PIO pio, uint state_machine, uint offset, uint select_pin, uint data_pin){
+    pio_sm_config c = rom_enable_program_get_default_config(offset);
+    sm_config_set_in_pins(&c, select_pin);
+    sm_config_set_out_pins(&c, data_pin, 8);
+    pio_gpio_init(pio, select_pin);
+    gpio_pull_up(select_pin);
+    pio_sm_set_consecutive_pindirs(pio, state_machine, select_pin, 1, false);
+    pio_sm_init(pio, state_machine, offset, &c);
+}
+
+#endif
@@ -0,0 +1,133 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#ifndef SIM_TUSB_H
+#define SIM_TUSB_H
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "contexts.h"
+
+/*
+Host stand-in for the TinyUSB device API. Every CDC interface is
+a PTY (names printed at boot) with the same FIFO sizes as the
+firmware's tusb_config.h. The vendor bulk interface is never
+mounted, bulk.c just sees an unplugged cable.
+Every emulation context after the first adds a CDC interface.
+*/
+#define CFG_TUD_CDC                 (2 + 1 + EMULATION_CONTEXTS - 1)
+#define CFG_TUD_CDC_RX_BUFSIZE      (4096 * 2)
+#define CFG_TUD_CDC_TX_BUFSIZE      (4096 * 2)
+#define CFG_TUD_CDC_EP_BUFSIZE      (64)
+#define CFG_TUD_VENDOR              (1)
+#define CFG_TUD_ENDPOINT0_SIZE      (64)
+
+// Descriptor constants (tusb_types.h, cdc.h and pico's usb_reset_interface.h)
+#define TUSB_DESC_DEVICE                    (0x01)
+#define TUSB_DESC_CONFIGURATION             (0x02)
+#define TUSB_DESC_STRING                    (0x03)
+#define TUSB_DESC_INTERFACE                 (0x04)
+#define TUSB_DESC_ENDPOINT                  (0x05)
+#define TUSB_DESC_INTERFACE_ASSOCIATION     (0x0B)
+#define TUSB_DESC_CS_INTERFACE              (0x24)
+#define TUSB_CLASS_CDC                      (0x02)
+#define TUSB_CLASS_CDC_DATA                 (0x0A)
+#define TUSB_CLASS_MISC                     (0xEF)
+#define TUSB_CLASS_VENDOR_SPECIFIC          (0xFF)
+#define TUSB_XFER_BULK                      (0x02)
+#define TUSB_XFER_INTERRUPT                 (0x03)
+#define TUSB_DESC_CONFIG_ATT_SELF_POWERED   (1u << 6)
+#define MISC_SUBCLASS_COMMON                (0x02)
+#define MISC_PROTOCOL_IAD                   (0x01)
+#define CDC_COMM_SUBCLASS_ABSTRACT_CONTROL_MODEL    (0x02)
+#define CDC_COMM_PROTOCOL_NONE              (0x00)
+#define CDC_FUNC_DESC_HEADER                (0x00)
+#define CDC_FUNC_DESC_CALL_MANAGEMENT       (0x01)
+#define CDC_FUNC_DESC_ABSTRACT_CONTROL_MANAGEMENT   (0x02)
+#define CDC_FUNC_DESC_UNION                 (0x06)
+#define RESET_INTERFACE_SUBCLASS            (0x00)
+#define RESET_INTERFACE_PROTOCOL            (0x01)
+
+#define U16_TO_U8S_LE(u16)  ((uint8_t)((u16) & 0xFF)), ((uint8_t)(((u16) >> 8) & 0xFF))
+
+#define TUD_CONFIG_DESC_LEN (9)
+#define TUD_CDC_DESC_LEN    (8 + 9 + 5 + 5 + 4 + 5 + 7 + 9 + 7 + 7)
+#define TUD_VENDOR_DESC_LEN (9 + 7 + 7)
+
+#define TUD_CONFIG_DESCRIPTOR(config_num, _itfcount, _stridx, _total_len, _attribute, _power_ma) \
+  9, TUSB_DESC_CONFIGURATION, U16_TO_U8S_LE(_total_len), _itfcount, config_num, _stridx, (1u << 7) | (_attribute), (_power_ma) / 2
+
+#define TUD_CDC_DESCRIPTOR(_itfnum, _stridx, _ep_notif, _ep_notif_size, _epout, _epin, _epsize) \
+  8, TUSB_DESC_INTERFACE_ASSOCIATION, _itfnum, 2, TUSB_CLASS_CDC, CDC_COMM_SUBCLASS_ABSTRACT_CONTROL_MODEL, CDC_COMM_PROTOCOL_NONE, 0, \
+  9, TUSB_DESC_INTERFACE, _itfnum, 0, 1, TUSB_CLASS_CDC, CDC_COMM_SUBCLASS_ABSTRACT_CONTROL_MODEL, CDC_COMM_PROTOCOL_NONE, _stridx, \
+  5, TUSB_DESC_CS_INTERFACE, CDC_FUNC_DESC_HEADER, U16_TO_U8S_LE(0x0120), \
+  5, TUSB_DESC_CS_INTERFACE, CDC_FUNC_DESC_CALL_MANAGEMENT, 0, (uint8_t)((_itfnum) + 1), \
+  4, TUSB_DESC_CS_INTERFACE, CDC_FUNC_DESC_ABSTRACT_CONTROL_MANAGEMENT, 6, \
+  5, TUSB_DESC_CS_INTERFACE, CDC_FUNC_DESC_UNION, _itfnum, (uint8_t)((_itfnum) + 1), \
+  7, TUSB_DESC_ENDPOINT, _ep_notif, TUSB_XFER_INTERRUPT, U16_TO_U8S_LE(_ep_notif_size), 16, \
+  9, TUSB_DESC_INTERFACE, (uint8_t)((_itfnum) + 1), 0, 2, TUSB_CLASS_CDC_DATA, 0, 0, 0, \
+  7, TUSB_DESC_ENDPOINT, _epout, TUSB_XFER_BULK, U16_TO_U8S_LE(_epsize), 0, \
+  7, TUSB_DESC_ENDPOINT, _epin, TUSB_XFER_BULK, U16_TO_U8S_LE(_epsize), 0
+
+#define TUD_VENDOR_DESCRIPTOR(_itfnum, _stridx, _epout, _epin, _epsize) \
+  9, TUSB_DESC_INTERFACE, _itfnum, 0, 2, TUSB_CLASS_VENDOR_SPECIFIC, 0x00, 0x00, _stridx, \
+  7, TUSB_DESC_ENDPOINT, _epout, TUSB_XFER_BULK, U16_TO_U8S_LE(_epsize), 0, \
+  7, TUSB_DESC_ENDPOINT, _epin, TUSB_XFER_BULK, U16_TO_U8S_LE(_epsize), 0
+
+typedef struct __attribute__((packed)) {
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    uint16_t bcdUSB;
+    uint8_t bDeviceClass;
+    uint8_t bDeviceSubClass;
+    uint8_t bDeviceProtocol;
+    uint8_t bMaxPacketSize0;
+    uint16_t idVendor;
+    uint16_t idProduct;
+    uint16_t bcdDevice;
+    uint8_t iManufacturer;
+    uint8_t iProduct;
+    uint8_t iSerialNumber;
+    uint8_t bNumConfigurations;
+} tusb_desc_device_t;
+
+// Descriptor callbacks, descriptors.c provides these
+const uint8_t* tud_descriptor_device_cb(void);
+const uint8_t* tud_descriptor_configuration_cb(uint8_t index);
+const uint16_t* tud_descriptor_string_cb(uint8_t index, uint16_t langid);
+
+bool tusb_init(void);
+void tud_task(void);
+bool tud_mounted(void);
+
+bool tud_cdc_n_connected(uint8_t itf);
+uint32_t tud_cdc_n_available(uint8_t itf);
+uint32_t tud_cdc_n_read(uint8_t itf, void* buffer, uint32_t bufsize);
+bool tud_cdc_n_peek(uint8_t itf, uint8_t* u8);
+uint32_t tud_cdc_n_write(uint8_t itf, const void* buffer, uint32_t bufsize);
+uint32_t tud_cdc_n_write_char(uint8_t itf, char ch);
+uint32_t tud_cdc_n_write_flush(uint8_t itf);
+uint32_t tud_cdc_n_write_available(uint8_t itf);
+
+static inline bool tud_cdc_connected(void){return tud_cdc_n_connected(0);}
+static inline uint32_t tud_cdc_available(void){return tud_cdc_n_available(0);}
+static inline uint32_t tud_cdc_read(void* buffer, uint32_t bufsize){return tud_cdc_n_read(0, buffer, bufsize);}
+static inline uint32_t tud_cdc_write(const void* buffer, uint32_t bufsize){return tud_cdc_n_write(0, buffer, bufsize);}
+static inline uint32_t tud_cdc_write_char(char ch){return tud_cdc_n_write_char(0, ch);}
+static inline uint32_t tud_cdc_write_flush(void){return tud_cdc_n_write_flush(0);}
+static inline uint32_t tud_cdc_write_available(void){return tud_cdc_n_write_available(0);}
+
+bool tud_vendor_mounted(void);
+uint32_t tud_vendor_available(void);
+uint32_t tud_vendor_read(void* buffer, uint32_t bufsize);
+uint32_t tud_vendor_write(const void* buffer, uint32_t bufsize);
+uint32_t tud_vendor_write_flush(void);
+uint32_t tud_vendor_write_available(void);
+
+#endif
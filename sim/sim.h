@@ -0,0 +1,85 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#ifndef SIM_H
+#define SIM_H
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+/*
+Shared by the sim/ stand-ins only, firmware code never includes this.
+
+The sim is the firmware built for Linux (cmake -DAETHERION_HOST_SIM=ON):
+
+    core 0          the thread main() runs on
+    core 1          a thread started by multicore_launch_core1()
+    interrupts      sim_interrupts, held by save_and_disable_interrupts()
+                    and by the threads that run IRQ handlers and timers
+    flash           a file mapped at XIP_BASE (AETHERION_FLASH), every
+                    sector erase takes AETHERION_ERASE_US (default 0)
+    PIO + SRAM      pushes to the injection state machine land in a
+                    64kb SRAM model (AETHERION_SRAM to map it to a file)
+    ECU bus         the ECU's chip select to that SRAM, driven from
+                    AETHERION_ECU_DUTY / AETHERION_ECU_PERIOD_NS for the
+                    snoop state machine (sim_bus.c), and the ROM reads
+                    pio1 answers in ROM_EMULATION builds
+    DMA             sim_dma.c, clocked with pio1 (UART RX channels run
+                    from the UART's thread)
+    uart0           the "ecu" PTY, a 32 byte RX FIFO that overruns
+                    when nothing empties it
+    CDC 0, 1, 2     the "emulation", "datalog" and "developer" PTYs
+    CDC 3, 4        "emulation1" and "emulation2" with EMULATION_CONTEXTS 2 or 3
+
+aetherion_bench links sim_usb_memory.c instead of sim_usb.c, its CDC
+interfaces are in-memory buffers the benchmark feeds (no PTYs).
+journal_test links it too and cuts the power between flash operations
+with sim_flash_cut(). rom_test boots a ROM_EMULATION build and checks
+what the ECU read with sim_bus_latched().
+
+PTY names are printed at boot, with AETHERION_SIM_DIR set they are
+also linked into that directory under those names.
+*/
+extern pthread_mutex_t sim_interrupts;
+extern __thread unsigned sim_core;
+
+int sim_pty(const char* role);
+bool sim_pty_connected(int fd);
+void sim_safepoint();
+bool sim_core1_stopped();
+void sim_irq_fire(unsigned num);
+bool sim_irq_armed(unsigned num);
+bool sim_irq_try(unsigned num);
+void sim_thread(void* (*entry)(void*), void* argument);
+
+void sim_flash_boot();
+void sim_flash_report();
+void sim_flash_cut(uint32_t operations, void (*cut)(void));
+void sim_pio_boot();
+void sim_pio_report();
+void sim_bus_boot();
+void sim_bus_report();
+uint32_t sim_bus_pins(uint64_t cycle);
+void sim_bus_write(unsigned pio, uint64_t cycle, uint32_t cycles);
+void sim_bus_read(uint64_t cycle, uint32_t pins, uint32_t pindirs, int32_t tag);
+int16_t sim_bus_latched(uint16_t address);
+void sim_dma_step();
+bool sim_pio_dreq(unsigned dreq);
+bool sim_pio_dma_read(uintptr_t address, uint32_t* value);
+bool sim_pio_dma_write(uintptr_t address, uint32_t value, int32_t tag);
+void sim_dma_serve(unsigned dreq);
+void sim_uart_boot();
+bool sim_uart_dreq(unsigned dreq);
+bool sim_uart_dma_read(uintptr_t address, uint32_t* value);
+void sim_usb_boot();
+void sim_usb_report();
+void sim_usb_feed(uint8_t itf, const void* data, uint32_t length);
+uint64_t sim_usb_sent(uint8_t itf);
+
+#endif
@@ -0,0 +1,158 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+#include "hardware/pio.h"
+#include "injection.h"
+#include "rom_emulation.h"
+#include "sim.h"
+
+/*
+ECU side of the SRAM bus, what the snoop state machine in injection.pio
+watches. The ECU selects the SRAM (ECU_SELECT_PIN low) at the start of
+every bus cycle of AETHERION_ECU_PERIOD_NS (default 500) and holds it
+for AETHERION_ECU_DUTY percent of it (default 0, a switched off ECU).
+Every injected write is checked against that pattern, a write that is
+on the bus while the ECU has the SRAM selected counts as an overlap.
+At exit the achieved write throughput is reported next to the overlaps:
+
+    AETHERION_ECU_DUTY=40 AETHERION_ECU_PERIOD_NS=500 ./aetherion-sim
+
+The same select is the ROM's chip enable in ROM_EMULATION builds
+(rom_emulation.h). Each bus cycle the ECU then also puts a new address
+on A0-A14 and expects the byte at that address on D0-D7, driven, before
+it lets go of the select. sim_bus_read() checks that against pio1 every
+cycle and reports how long the ECU had to wait for it.
+*/
+static uint32_t duty;                                                                   // Percent of each bus cycle the ECU holds the SRAM
+static uint32_t period_ns = 500;                                                        // ECU bus cycle
+static uint32_t period;                                                                 // Bus cycle in PIO cycles, set at the first use
+static uint32_t access;                                                                 // PIO cycles of each bus cycle the ECU holds the SRAM
+static uint64_t writes[NUM_PIOS];                                                       // Writes checked, per PIO (one per emulation context)
+static uint64_t overlaps[NUM_PIOS];                                                     // Writes that ran into an ECU access
+static uint64_t first[NUM_PIOS];                                                        // Cycle of the first write
+static uint64_t last[NUM_PIOS];                                                         // Cycle the last write ended
+static uint64_t reads;                                                                  // ROM reads answered in time
+static uint64_t late;                                                                   // ROM reads still wrong when the select went high
+static uint32_t valid_at;                                                               // Cycle of the bus cycle the byte went valid, access if not
+static uint32_t worst;                                                                  // Slowest answered read in cycles
+static int16_t latched[0x8000];                                                         // Byte the ECU last latched per ROM address, -1 never
+
+/*
+Reads the ECU pattern from the environment.
+*/
+void sim_bus_boot(){
+    memset(latched, 0xFF, sizeof(latched));                                             // -1, nothing read yet
+    const char* value = getenv("AETHERION_ECU_DUTY");
+    if (value){duty = strtoul(value, NULL, 0);}
+    value = getenv("AETHERION_ECU_PERIOD_NS");
+    if (value){period_ns = strtoul(value, NULL, 0);}
+    if (duty >= 100 || !period_ns){panic("AETHERION_ECU_DUTY must be 0-99 and AETHERION_ECU_PERIOD_NS above 0");}
+    if (duty){fprintf(stderr, "aetherion-sim: %-10s ECU %u%% of %uns\n", "bus", duty, period_ns);}
+}
+
+/*
+Works out the pattern in PIO cycles. Done at the first use because
+main() sets the system clock after the sim has booted.
+*/
+static void timing(){
+    if (period){return;}
+    period = (uint32_t)(((uint64_t)period_ns * clock_get_hz(clk_sys)) / 1000000000u);
+    if (!period){period = 1;}
+    access = (uint32_t)(((uint64_t)period * duty) / 100u);
+}
+
+/*
+ROM address the ECU reads in a bus cycle, scattered over the whole image.
+*/
+static uint16_t rom_address(uint64_t cycle){
+    return (uint16_t)(((cycle / period) * 2654435761u) >> 7) & 0x7FFF;
+}
+
+/*
+Levels of the GPIOs the ECU drives at a cycle, as the PIO sees them:
+the select low for the first access cycles of every period and the
+address on A0-A14 (only while the ECU is on). Everything else reads
+high like a pulled up pin.
+*/
+uint32_t sim_bus_pins(uint64_t cycle){
+    uint32_t pins = 0xFFFFFFFFu;
+    if (!duty){return pins;}                                                            // ECU switched off, select stays high
+    timing();
+    if ((cycle % period) < access){pins &= ~(1u << ECU_SELECT_PIN);}                    // ECU selects the SRAM / ROM
+    pins &= ~(0x7FFFu << ROM_ADDRESS_PIN);
+    pins |= (uint32_t)rom_address(cycle) << ROM_ADDRESS_PIN;
+    return pins;
+}
+
+/*
+Checks the ROM data pins of pio1 at a cycle. A read is answered once all
+of D0-D7 are driven with the byte tagged with the address of this bus
+cycle (see sim_dma.c), it has to stay that way until the select goes high.
+*/
+void sim_bus_read(uint64_t cycle, uint32_t pins, uint32_t pindirs, int32_t tag){
+    if (!duty){return;}
+    timing();
+    uint32_t phase = cycle % period;
+    if (phase >= access){return;}                                                       // Select high, nobody is reading
+    if (!phase){valid_at = access;}                                                     // New bus cycle, nothing valid yet
+    uint32_t data = 0xFFu << ROM_DATA_PIN;
+    bool valid = ((pindirs & data) == data) && tag == rom_address(cycle);
+    if (!valid){valid_at = access;}                                                     // Not (or no longer) the right byte
+    else if (valid_at == access){valid_at = phase;}                                     // Just went valid
+    if (phase != access - 1){return;}                                                   // The ECU latches at the end
+    if (valid_at == access){late++; return;}
+    reads++;
+    if (valid_at > worst){worst = valid_at;}
+    latched[tag] = (pins >> ROM_DATA_PIN) & 0xFF;                                       // What the ECU got
+}
+
+/*
+Returns the byte the ECU last latched from a ROM address, -1 if it has
+not read that address in time yet.
+*/
+int16_t sim_bus_latched(uint16_t address){
+    return latched[address & 0x7FFF];
+}
+/*
+Checks a write that holds the bus from cycle for cycles against the ECU.
+Every PIO drives its own SRAM and counts its own cycles, each one is
+checked against an ECU with the same timing.
+*/
+void sim_bus_write(unsigned pio, uint64_t cycle, uint32_t cycles){
+    timing();
+    if (!writes[pio]){first[pio] = cycle;}
+    writes[pio]++;
+    last[pio] = cycle + cycles;
+    if (!access){return;}                                                               // Nothing to run into
+    uint64_t phase = cycle % period;                                                    // Where in the ECU bus cycle the write starts
+    if (phase < access || phase + cycles > period){overlaps[pio]++;}                    // Starts inside an access or runs into the next one
+}
+
+void sim_bus_report(){
+    if (reads || late){
+        double ns = 1e9 / clock_get_hz(clk_sys);
+        fprintf(stderr, "aetherion-sim: %-10s ECU %u%% of %uns, %llu ROM reads, worst response %.0fns of a %.0fns window, %llu late\n",
+                "rom", duty, period_ns, (unsigned long long)reads, (worst + 1) * ns, access * ns, (unsigned long long)late);
+    }
+    for (unsigned pio = 0; pio < NUM_PIOS; pio++){
+        if (!writes[pio]){continue;}
+        char label[16];
+        snprintf(label, sizeof(label), pio ? "bus pio%u" : "bus", pio);
+        double seconds = (double)(last[pio] - first[pio]) / clock_get_hz(clk_sys);
+        fprintf(stderr, "aetherion-sim: %-10s ECU %u%% of %uns, %llu writes at %.2f MB/s, %llu overlapping an ECU access\n",
+                label, duty, period_ns, (unsigned long long)writes[pio], seconds > 0 ? writes[pio] / seconds / 1e6 : 0.0,
+                (unsigned long long)overlaps[pio]);
+    }
+}
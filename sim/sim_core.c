@@ -0,0 +1,425 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sched.h>
+#include <signal.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include "pico/stdlib.h"
+#include "pico/sync.h"
+#include "pico/multicore.h"
+#include "pico/bootrom.h"
+#include "pico/unique_id.h"
+#include "hardware/clocks.h"
+#include "hardware/irq.h"
+#include "hardware/vreg.h"
+#include "sim.h"
+
+#define SIM_LINKS       (8)                                                             // PTY roles we may link into AETHERION_SIM_DIR
+#define VICTIM_CYCLES   (100u)                                                          // Rough cost on the chip of the work between two victim calls
+#define PACE_NS         (1000000u)                                                      // Core 1 checks its pace once per 1ms of chip time
+
+pthread_mutex_t sim_interrupts = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;                // Held while core 0 has interrupts off or a handler runs
+__thread unsigned sim_core;                                                             // Which core the calling thread plays
+
+static struct timespec boot;                                                            // time_us_64() counts from here
+static uint32_t sys_khz = 150000;                                                       // RP2350 boots at 150MHz
+static bool gpio_level[NUM_BANK0_GPIOS];                                                // Last value put on each pin
+static irq_handler_t handlers[SIM_NUM_IRQS];                                            // irq_set_exclusive_handler()
+static volatile bool irq_enabled[SIM_NUM_IRQS];                                         // irq_set_enabled()
+static void (*core1_entry)(void);                                                       // What multicore_launch_core1() runs
+static pthread_mutex_t lockout_lock = PTHREAD_MUTEX_INITIALIZER;                        // Guards the lockout handshake
+static pthread_cond_t lockout_cond = PTHREAD_COND_INITIALIZER;
+static volatile bool lockout_requested;                                                 // Core 0 wants core 1 parked
+static volatile bool core1_parked;                                                      // Core 1 is parked
+static volatile bool core1_victim;                                                      // Core 1 has called multicore_lockout_victim_init()
+static uint64_t core1_budget;                                                           // Chip time core 1 has used since its last pace check (ns)
+static uint64_t core1_checked;                                                          // When that was (us)
+static char links[SIM_LINKS][256];                                                      // Symlinks to remove at exit
+static uint8_t link_count;
+
+/*
+Thread that owns SIGINT and SIGTERM so Ctrl+C ends the sim through
+exit() and the atexit() report, whatever the cores are doing.
+*/
+static void* signal_thread(void* argument){
+    sigset_t* signals = argument;
+    int signal_number;
+    sigwait(signals, &signal_number);
+    exit(0);
+}
+
+/*
+Prints what the stand-ins counted and removes the PTY links.
+*/
+static void sim_exit(){
+    fprintf(stderr, "aetherion-sim: ran %.3fs\n", time_us_64() / 1e6);
+    sim_flash_report();
+    sim_pio_report();
+    sim_bus_report();
+    sim_usb_report();
+    for (uint8_t i = 0; i < link_count; i++){unlink(links[i]);}
+}
+
+/*
+Runs before main(): maps the flash image and opens every PTY so their
+names are known before the firmware starts talking.
+*/
+__attribute__((constructor))
+static void sim_boot(){
+    static sigset_t signals;
+    clock_gettime(CLOCK_MONOTONIC, &boot);
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);                                         // Every thread created from here on inherits this
+    sim_thread(signal_thread, &signals);
+    sim_flash_boot();
+    sim_pio_boot();
+    sim_bus_boot();
+    sim_uart_boot();
+    sim_usb_boot();
+    atexit(sim_exit);
+}
+
+/*
+Starts a detached thread, the sim never joins any of them.
+*/
+void sim_thread(void* (*entry)(void*), void* argument){
+    pthread_t thread;
+    pthread_attr_t attributes;
+    pthread_attr_init(&attributes);
+    pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+    if (pthread_create(&thread, &attributes, entry, argument)){panic("pthread_create failed");}
+    pthread_attr_destroy(&attributes);
+}
+
+/*
+Opens a raw PTY for a role and returns the master side, non-blocking.
+*/
+int sim_pty(const char* role){
+    int fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (fd < 0 || grantpt(fd) || unlockpt(fd)){panic("no PTY for %s: %s", role, strerror(errno));}
+    const char* name = ptsname(fd);
+    int slave = open(name, O_RDWR | O_NOCTTY);                                          // Raw mode sticks to the PTY, not the open file
+    struct termios mode;
+    if (slave >= 0 && !tcgetattr(slave, &mode)){
+        cfmakeraw(&mode);
+        tcsetattr(slave, TCSANOW, &mode);
+    }
+    if (slave >= 0){close(slave);}
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    fprintf(stderr, "aetherion-sim: %-10s %s\n", role, name);
+    const char* directory = getenv("AETHERION_SIM_DIR");
+    if (directory && link_count < SIM_LINKS){
+        char* path = links[link_count];
+        snprintf(path, sizeof(links[0]), "%s/%s", directory, role);
+        unlink(path);                                                                   // Left over from a sim that was killed
+        if (!symlink(name, path)){link_count++;}
+    }
+    return fd;
+}
+
+/*
+Returns true while something has the slave side of a PTY open.
+*/
+bool sim_pty_connected(int fd){
+    struct pollfd entry = {.fd = fd, .events = 0};
+    return poll(&entry, 1, 0) >= 0 && !(entry.revents & POLLHUP);
+}
+
+/*
+Time.
+*/
+uint64_t time_us_64(void){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)(now.tv_sec - boot.tv_sec) * 1000000u + (now.tv_nsec - boot.tv_nsec) / 1000;
+}
+
+uint32_t time_us_32(void){
+    return (uint32_t)time_us_64();
+}
+
+void sleep_us(uint64_t us){
+    sim_safepoint();                                                                    // A sleeping core 1 can still be locked out
+    struct timespec delay = {.tv_sec = us / 1000000u, .tv_nsec = (us % 1000000u) * 1000};
+    while (nanosleep(&delay, &delay) && errno == EINTR){}
+}
+
+void sleep_ms(uint32_t ms){
+    sleep_us((uint64_t)ms * 1000);
+}
+
+void busy_wait_us_32(uint32_t us){
+    uint64_t until = time_us_64() + us;
+    while (time_us_64() < until){tight_loop_contents();}
+}
+
+void tight_loop_contents(void){
+    sim_safepoint();
+}
+
+bool set_sys_clock_khz(uint32_t freq_khz, bool required){
+    sys_khz = freq_khz;
+    return true;
+}
+
+uint32_t clock_get_hz(enum clock_index clk_index){
+    return (clk_index == clk_sys) ? sys_khz * 1000u : 12000000u;
+}
+
+void vreg_set_voltage(enum vreg_voltage voltage){
+}
+
+uint get_core_num(void){
+    return sim_core;
+}
+
+void panic(const char* fmt, ...){
+    va_list arguments;
+    va_start(arguments, fmt);
+    fprintf(stderr, "aetherion-sim: PANIC on core %u: ", sim_core);
+    vfprintf(stderr, fmt, arguments);
+    fputc('\n', stderr);
+    va_end(arguments);
+    abort();
+}
+
+void reset_usb_boot(uint32_t usb_activity_gpio_pin_mask, uint32_t disable_interface_mask){
+    fprintf(stderr, "aetherion-sim: reset to BOOTSEL requested\n");
+    exit(0);
+}
+
+void pico_get_unique_board_id_string(char* id_out, unsigned len){
+    snprintf(id_out, len, "%016llX", 0x5349410000000000ull | (unsigned long long)(uint32_t)gethostid());
+}
+
+/*
+GPIO only remembers levels, nothing on the host is wired to the LEDs.
+*/
+void gpio_init(uint gpio){
+    gpio_level[gpio % NUM_BANK0_GPIOS] = false;
+}
+
+void gpio_deinit(uint gpio){
+    gpio_level[gpio % NUM_BANK0_GPIOS] = false;
+}
+
+void gpio_set_dir(uint gpio, bool out){
+}
+
+void gpio_put(uint gpio, bool value){
+    gpio_level[gpio % NUM_BANK0_GPIOS] = value;
+}
+
+bool gpio_get(uint gpio){
+    return gpio_level[gpio % NUM_BANK0_GPIOS];
+}
+
+void gpio_set_function(uint gpio, enum gpio_function fn){
+}
+
+void gpio_pull_up(uint gpio){
+}
+
+/*
+Interrupts. Handlers run on whichever sim thread raised them
+while holding sim_interrupts, so they never overlap with core 0
+code between save_and_disable_interrupts() and restore_interrupts().
+*/
+uint32_t save_and_disable_interrupts(void){
+    pthread_mutex_lock(&sim_interrupts);
+    return 0;
+}
+
+void restore_interrupts(uint32_t status){
+    pthread_mutex_unlock(&sim_interrupts);
+}
+
+void irq_set_exclusive_handler(unsigned num, irq_handler_t handler){
+    if (num >= SIM_NUM_IRQS){panic("bad IRQ %u", num);}
+    handlers[num] = handler;
+}
+
+void irq_set_enabled(unsigned num, bool enabled){
+    if (num >= SIM_NUM_IRQS){panic("bad IRQ %u", num);}
+    irq_enabled[num] = enabled;
+}
+
+bool irq_is_enabled(unsigned num){
+    return num < SIM_NUM_IRQS && irq_enabled[num];
+}
+
+bool sim_irq_armed(unsigned num){
+    return irq_is_enabled(num) && handlers[num];
+}
+
+void sim_irq_fire(unsigned num){
+    if (!sim_irq_armed(num)){return;}
+    pthread_mutex_lock(&sim_interrupts);
+    handlers[num]();
+    pthread_mutex_unlock(&sim_interrupts);
+}
+
+/*
+Runs the handler of num unless interrupts are off right now (core 0
+holds sim_interrupts). Returns false if it could not, the IRQ stays
+pending and the caller tries again later.
+*/
+bool sim_irq_try(unsigned num){
+    if (!sim_irq_armed(num)){return true;}
+    if (pthread_mutex_trylock(&sim_interrupts)){return false;}
+    handlers[num]();
+    pthread_mutex_unlock(&sim_interrupts);
+    return true;
+}
+
+/*
+Repeating timers: one thread each, a negative delay is measured
+start to start like the SDK.
+*/
+static void* timer_thread(void* argument){
+    repeating_timer_t* timer = argument;
+    int64_t period = (timer->delay_us < 0) ? -timer->delay_us : timer->delay_us;
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while (!timer->cancelled){
+        next.tv_nsec += (period % 1000000) * 1000;
+        next.tv_sec += period / 1000000 + next.tv_nsec / 1000000000;
+        next.tv_nsec %= 1000000000;
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+        if (timer->cancelled){break;}
+        pthread_mutex_lock(&sim_interrupts);
+        bool again = timer->callback(timer);
+        pthread_mutex_unlock(&sim_interrupts);
+        if (!again){break;}
+        if (timer->delay_us >= 0){clock_gettime(CLOCK_MONOTONIC, &next);}               // Positive delays count from the end of the callback
+    }
+    return NULL;
+}
+
+bool add_repeating_timer_us(int64_t delay_us, repeating_timer_callback_t callback, void* user_data, repeating_timer_t* out){
+    out->delay_us = delay_us;
+    out->user_data = user_data;
+    out->callback = callback;
+    out->cancelled = false;
+    sim_thread(timer_thread, out);
+    return true;
+}
+
+bool cancel_repeating_timer(repeating_timer_t* timer){
+    timer->cancelled = true;
+    return true;
+}
+
+/*
+Mutexes.
+*/
+void mutex_init(mutex_t* mtx){
+    pthread_mutex_init(&mtx->lock, NULL);
+}
+
+void mutex_enter_blocking(mutex_t* mtx){
+    pthread_mutex_lock(&mtx->lock);
+}
+
+bool mutex_try_enter(mutex_t* mtx, uint32_t* owner_out){
+    if (pthread_mutex_trylock(&mtx->lock)){return false;}
+    if (owner_out){*owner_out = sim_core;}
+    return true;
+}
+
+void mutex_exit(mutex_t* mtx){
+    pthread_mutex_unlock(&mtx->lock);
+}
+
+/*
+Core 1 and the lockout handshake. Core 1 parks at its next safepoint
+(multicore_lockout_victim_init(), sleeps and tight loops) and stays
+there until core 0 ends the lockout.
+*/
+static void* core1_thread(void* argument){
+    sim_core = 1;
+    core1_entry();
+    return NULL;
+}
+
+void multicore_launch_core1(void (*entry)(void)){
+    core1_entry = entry;
+    sim_thread(core1_thread, NULL);
+}
+
+/*
+Core 1 calls this on every pass of every loop, so it is also where core 1
+is held back to roughly chip speed. Without that the core alive counters
+(counted in loop passes) run out long before core 0 comes back around.
+*/
+static void core1_pace(){
+    core1_budget += (uint64_t)VICTIM_CYCLES * 1000000u / sys_khz;                       // ns this pass would take at sys_khz
+    if (core1_budget < PACE_NS){return;}
+    uint64_t elapsed = time_us_64() - core1_checked;                                    // How long the host actually took
+    if (elapsed * 1000 < core1_budget){sleep_us((core1_budget - elapsed * 1000) / 1000);}  // Ahead of the chip, wait for it
+    core1_budget = 0;
+    core1_checked = time_us_64();
+}
+
+void multicore_lockout_victim_init(void){
+    if (sim_core != 1){return;}
+    core1_victim = true;
+    sim_safepoint();
+    core1_pace();
+}
+
+bool multicore_lockout_victim_is_initialized(uint core_num){
+    return core_num == 1 && core1_victim;
+}
+
+void sim_safepoint(){
+    if (sim_core != 1 || !__atomic_load_n(&lockout_requested, __ATOMIC_ACQUIRE)){return;}
+    pthread_mutex_lock(&lockout_lock);
+    core1_parked = true;
+    pthread_cond_broadcast(&lockout_cond);
+    while (lockout_requested){pthread_cond_wait(&lockout_cond, &lockout_lock);}
+    core1_parked = false;
+    pthread_cond_broadcast(&lockout_cond);
+    pthread_mutex_unlock(&lockout_lock);
+}
+
+void multicore_lockout_start_blocking(void){
+    if (!core1_victim){return;}                                                         // Core 1 is not running anything we could disturb
+    pthread_mutex_lock(&lockout_lock);
+    __atomic_store_n(&lockout_requested, true, __ATOMIC_RELEASE);
+    while (!core1_parked){pthread_cond_wait(&lockout_cond, &lockout_lock);}
+    pthread_mutex_unlock(&lockout_lock);
+}
+
+void multicore_lockout_end_blocking(void){
+    if (!core1_victim){return;}
+    pthread_mutex_lock(&lockout_lock);
+    __atomic_store_n(&lockout_requested, false, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&lockout_cond);
+    while (core1_parked){pthread_cond_wait(&lockout_cond, &lockout_lock);}
+    pthread_mutex_unlock(&lockout_lock);
+}
+
+/*
+Returns true if core 1 cannot be reading flash right now.
+*/
+bool sim_core1_stopped(){
+    return !core1_entry || core1_parked;
+}
@@ -0,0 +1,217 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/dma.h"
+#include "hardware/uart.h"
+#include "hardware/structs/bus_ctrl.h"
+#include "sim.h"
+
+/*
+DMA on pio1's clock (sim_pio.c calls sim_dma_step() once per cycle).
+A transfer reads as soon as its DREQ is asserted and writes SIM_DMA_CYCLES
+later, about what a read and a write through the bus fabric cost with
+the DMA ahead of the cores. Only what rom_emulation.c uses is modelled:
+one transfer in flight per channel, non incrementing, FIFO registers,
+memory and the read address trigger of another channel.
+
+Channels paced by a UART RX DREQ (datalog.c) are not on pio1's clock,
+the UART's thread runs them with sim_dma_serve() whenever it has put
+bytes in the RX FIFO, interrupts or not. Those may increment their
+writes, wrapped on a ring, and may run endless.
+
+Addresses written through a trigger are 32 bit like on the chip, the
+upper half of a host address is taken from the sim's own static data.
+Every word read from memory is tagged with the low 15 bits of where it
+came from, sim_bus.c uses that to check a byte on the ROM data pins.
+*/
+#define SIM_DMA_CYCLES      (4u)                                                        // Read to write of one transfer
+
+struct sim_channel {
+    bool claimed;
+    bool busy;                                                                          // Triggered, transfers left
+    dma_channel_config config;
+    uintptr_t read;
+    uintptr_t write;
+    uint32_t count;                                                                     // Transfers per trigger, DMA_ENDLESS never runs out
+    uint32_t remaining;
+    uint32_t pending;                                                                   // Cycles until the write of the transfer in flight
+    uint32_t value;
+    int32_t tag;
+};
+
+static dma_hw_t registers;
+dma_hw_t* const dma_hw = &registers;
+static bus_ctrl_hw_t bus_ctrl;
+bus_ctrl_hw_t* const bus_ctrl_hw = &bus_ctrl;
+static struct sim_channel channels[NUM_DMA_CHANNELS];
+
+int dma_claim_unused_channel(bool required){
+    for (uint i = 0; i < NUM_DMA_CHANNELS; i++){
+        if (!channels[i].claimed){
+            channels[i].claimed = true;
+            return i;
+        }
+    }
+    if (required){panic("no DMA channel left");}
+    return -1;
+}
+
+dma_channel_config dma_channel_get_default_config(uint channel){
+    dma_channel_config c = {.size = DMA_SIZE_32, .read_increment = true, .write_increment = false,
+                            .dreq = DREQ_FORCE, .chain_to = channel, .high_priority = false,
+                            .ring_write = false, .ring_bits = 0};
+    return c;
+}
+
+void channel_config_set_transfer_data_size(dma_channel_config* c, enum dma_channel_transfer_size size){
+    c->size = size;
+}
+
+void channel_config_set_read_increment(dma_channel_config* c, bool increment){
+    c->read_increment = increment;
+}
+
+void channel_config_set_write_increment(dma_channel_config* c, bool increment){
+    c->write_increment = increment;
+}
+
+void channel_config_set_dreq(dma_channel_config* c, uint dreq){
+    c->dreq = dreq;
+}
+
+void channel_config_set_chain_to(dma_channel_config* c, uint chain_to){
+    c->chain_to = chain_to;
+}
+
+void channel_config_set_high_priority(dma_channel_config* c, bool high_priority){
+    c->high_priority = high_priority;
+}
+
+void channel_config_set_ring(dma_channel_config* c, bool write, uint size_bits){
+    c->ring_write = write;
+    c->ring_bits = size_bits;
+}
+
+uint32_t dma_encode_endless_transfer_count(void){
+    return DMA_ENDLESS;
+}
+
+dma_channel_hw_t* dma_channel_hw_addr(uint channel){
+    return &registers.ch[channel];
+}
+
+/*
+Returns true for the DREQs sim_dma_serve() runs instead of pio1's clock.
+*/
+static bool uart_paced(uint dreq){
+    return dreq >= DREQ_UART0_TX && dreq <= DREQ_UART1_RX;
+}
+
+static void trigger(uint channel){
+    channels[channel].remaining = channels[channel].count;
+    channels[channel].busy = channels[channel].count > 0;
+}
+
+void dma_channel_configure(uint channel, const dma_channel_config* config, volatile void* write_addr,
+                           const volatile void* read_addr, uint transfer_count, bool start){
+    struct sim_channel* c = &channels[channel];
+    c->config = *config;
+    if (config->read_increment){panic("incrementing DMA reads are not modelled");}
+    if (config->write_increment && !uart_paced(config->dreq)){panic("incrementing DMA writes are only modelled from a UART");}
+    if (config->ring_bits && !config->ring_write){panic("DMA read rings are not modelled");}
+    c->write = (uintptr_t)write_addr;
+    registers.ch[channel].write_addr = (uint32_t)c->write;
+    c->read = (uintptr_t)read_addr;
+    c->count = transfer_count;
+    if (start){trigger(channel);}
+}
+
+void dma_channel_start(uint channel){
+    trigger(channel);
+}
+
+/*
+Reads one transfer, from a PIO RX FIFO or from memory.
+*/
+static void transfer_read(struct sim_channel* c){
+    c->tag = c->read & 0x7FFF;
+    if (sim_pio_dma_read(c->read, &c->value)){return;}
+    if (sim_uart_dma_read(c->read, &c->value)){return;}
+    switch (c->config.size){
+        case DMA_SIZE_8:  c->value = *(volatile uint8_t *)c->read; break;
+        case DMA_SIZE_16: c->value = *(volatile uint16_t *)c->read; break;
+        case DMA_SIZE_32: c->value = *(volatile uint32_t *)c->read; break;
+    }
+}
+
+/*
+Writes one transfer, to another channel's read address trigger, to a PIO
+TX FIFO or to memory.
+*/
+static void transfer_write(struct sim_channel* c){
+    for (uint i = 0; i < NUM_DMA_CHANNELS; i++){
+        if (c->write == (uintptr_t)&dma_hw->ch[i].al3_read_addr_trig){
+            channels[i].read = ((uintptr_t)&registers & ~(uintptr_t)0xFFFFFFFFu) | c->value;  // Widen the 32 bit bus address
+            trigger(i);
+            return;
+        }
+    }
+    if (sim_pio_dma_write(c->write, c->value, c->tag)){return;}
+    switch (c->config.size){
+        case DMA_SIZE_8:  *(volatile uint8_t *)c->write = c->value; break;
+        case DMA_SIZE_16: *(volatile uint16_t *)c->write = c->value; break;
+        case DMA_SIZE_32: *(volatile uint32_t *)c->write = c->value; break;
+    }
+    if (!c->config.write_increment){return;}
+    uintptr_t wrap = c->config.ring_bits ? ((uintptr_t)1 << c->config.ring_bits) - 1 : UINTPTR_MAX;
+    c->write = (c->write & ~wrap) | ((c->write + ((uintptr_t)1 << c->config.size)) & wrap);
+    registers.ch[c - channels].write_addr = (uint32_t)c->write;                         // After the data, like the chip
+}
+
+/*
+Runs every busy channel paced by dreq (a UART RX DREQ) until the UART
+has nothing left. Called from the UART's thread.
+*/
+void sim_dma_serve(unsigned dreq){
+    for (uint i = 0; i < NUM_DMA_CHANNELS; i++){
+        struct sim_channel* c = &channels[i];
+        if (!c->busy || c->config.dreq != dreq){continue;}
+        while (c->busy && sim_uart_dreq(dreq)){
+            transfer_read(c);
+            transfer_write(c);
+            if (c->count == DMA_ENDLESS || --c->remaining){continue;}                   // More to come on this trigger
+            c->busy = false;
+            if (c->config.chain_to != i){trigger(c->config.chain_to);}
+        }
+    }
+}
+
+/*
+One cycle of every busy channel.
+*/
+void sim_dma_step(){
+    for (uint i = 0; i < NUM_DMA_CHANNELS; i++){
+        struct sim_channel* c = &channels[i];
+        if (!c->busy || uart_paced(c->config.dreq)){continue;}                         // UART channels run from sim_dma_serve()
+        if (c->pending){
+            if (--c->pending){continue;}                                                // Still on the bus
+            transfer_write(c);
+            if (--c->remaining){continue;}                                              // More to come on this trigger
+            c->busy = false;
+            if (c->config.chain_to != i){trigger(c->config.chain_to);}                  // Hand over
+            continue;
+        }
+        if (c->config.dreq != DREQ_FORCE && !sim_pio_dreq(c->config.dreq)){continue;}   // Paced, nothing to do yet
+        transfer_read(c);
+        c->pending = SIM_DMA_CYCLES;
+    }
+}
@@ -0,0 +1,120 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "pico/stdlib.h"
+#include "hardware/flash.h"
+#include "hardware/structs/xip_ctrl.h"
+#include "flash_memory.h"
+#include "sim.h"
+
+#ifndef PICO_FLASH_SIZE_BYTES
+    #define PICO_FLASH_SIZE_BYTES (4u * 1024u * 1024u)
+#endif
+
+uint8_t* sim_xip;                                                                       // XIP_BASE, the mapped flash image
+static xip_ctrl_hw_t xip_ctrl;                                                          // No XIP cache, counters stay zero
+xip_ctrl_hw_t* const xip_ctrl_hw = &xip_ctrl;
+static uint32_t erases;                                                                 // Sectors erased
+static uint32_t programs;                                                               // Pages programmed
+static uint32_t unsafe;                                                                 // Erases/programs while core 1 could read XIP
+static uint32_t cut_after;                                                              // Erases/programs left before the power cut, 0 = never
+static void (*cut_power)(void);                                                         // Where the power cut goes
+static uint32_t erase_us;                                                               // How long a sector erase takes (AETHERION_ERASE_US)
+
+/*
+Maps the flash image (AETHERION_FLASH, default aetherion-flash.bin).
+A new image is erased except for the persist bytes at FLASH_USER_OFFSET,
+which start out on bank 0 like a deployed device. Erases are instant
+unless AETHERION_ERASE_US is set (a 4kb sector takes ~45ms on the chip).
+*/
+void sim_flash_boot(){
+    const char* path = getenv("AETHERION_FLASH");
+    if (!path){path = "aetherion-flash.bin";}
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info)){panic("cannot open flash image %s: %s", path, strerror(errno));}
+    bool fresh = (info.st_size == 0);
+    if (info.st_size < PICO_FLASH_SIZE_BYTES && ftruncate(fd, PICO_FLASH_SIZE_BYTES)){
+        panic("cannot size flash image %s: %s", path, strerror(errno));
+    }
+    sim_xip = mmap(NULL, PICO_FLASH_SIZE_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (sim_xip == MAP_FAILED){panic("cannot map flash image %s: %s", path, strerror(errno));}
+    close(fd);
+    if (fresh){
+        memset(sim_xip, 0xFF, PICO_FLASH_SIZE_BYTES);                                   // Erased flash
+        sim_xip[FLASH_USER_OFFSET] = 0;                                                 // persist_bank
+        sim_xip[FLASH_USER_OFFSET + 1] = 0;                                             // volitile_bank
+    }
+    const char* erase = getenv("AETHERION_ERASE_US");
+    if (erase){erase_us = (uint32_t)strtoul(erase, NULL, 0);}
+    fprintf(stderr, "aetherion-sim: %-10s %s%s, %uus per sector erase\n", "flash", path, fresh ? " (new)" : "", (unsigned)erase_us);
+}
+
+/*
+Counts flash writes that core 1 could have seen half done. On the
+chip those read garbage (or fault) instead of the tune.
+*/
+static void check_lockout(const char* what, uint32_t flash_offs){
+    if (sim_core1_stopped()){return;}
+    if (!unsafe++){
+        fprintf(stderr, "aetherion-sim: %s at 0x%06X without core 1 locked out\n", what, (unsigned)flash_offs);
+    }
+}
+
+/*
+Cuts the power once operations more erases/programs have completed:
+cut() is called right after the last one and must not return (the
+journal test longjmps back to its boot). 0 disarms it.
+*/
+void sim_flash_cut(uint32_t operations, void (*cut)(void)){
+    cut_after = operations;
+    cut_power = cut;
+}
+
+/*
+Counts down to the power cut after every erase/program.
+*/
+static void operation_done(){
+    if (cut_after && !--cut_after){cut_power();}
+}
+
+void flash_range_erase(uint32_t flash_offs, size_t count){
+    if ((flash_offs | count) % FLASH_SECTOR_SIZE){panic("flash_range_erase(0x%X, %zu) not sector aligned", flash_offs, count);}
+    if (flash_offs + count > PICO_FLASH_SIZE_BYTES){panic("flash_range_erase(0x%X, %zu) past the end of flash", flash_offs, count);}
+    check_lockout("erase", flash_offs);
+    memset(sim_xip + flash_offs, 0xFF, count);
+    if (erase_us){usleep(erase_us * (count / FLASH_SECTOR_SIZE));}                      // Caller holds the interrupts off for all of it
+    erases += count / FLASH_SECTOR_SIZE;
+    operation_done();
+}
+
+void flash_range_program(uint32_t flash_offs, const uint8_t* data, size_t count){
+    if ((flash_offs | count) % FLASH_PAGE_SIZE){panic("flash_range_program(0x%X, %zu) not page aligned", flash_offs, count);}
+    if (flash_offs + count > PICO_FLASH_SIZE_BYTES){panic("flash_range_program(0x%X, %zu) past the end of flash", flash_offs, count);}
+    if (data + count > sim_xip && data < sim_xip + PICO_FLASH_SIZE_BYTES){panic("flash_range_program(0x%X) from a buffer in flash", flash_offs);}
+    check_lockout("program", flash_offs);
+    for (size_t i = 0; i < count; i++){
+        sim_xip[flash_offs + i] &= data[i];                                             // NOR flash only clears bits
+    }
+    programs += count / FLASH_PAGE_SIZE;
+    operation_done();
+}
+
+void sim_flash_report(){
+    fprintf(stderr, "aetherion-sim: flash %lu sectors erased, %lu pages programmed, %lu unlocked\n",
+            (unsigned long)erases, (unsigned long)programs, (unsigned long)unsafe);
+}
@@ -0,0 +1,508 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "pico/stdlib.h"
+#include "hardware/pio.h"
+#include "rom_emulation.h"
+#include "sim.h"
+
+/*
+SRAM wiring of the board (what injection_program_init() sets up):
+D0-D7 on GPIO 2-9, A0-A14 on GPIO 10-24 and A15 (bank) on GPIO 25.
+Every PIO drives an SRAM of its own wired the same way (one per
+emulation context, see contexts.h), they follow each other in sim_sram.
+*/
+
+#define SRAM_DATA_PIN       (2u)
+#define SRAM_ADDRESS_PIN    (10u)
+#define SRAM_BANK_PIN       (25u)
+#define SRAM_SIZE           (0x10000u)                                                  // 2 banks of 32kb per PIO
+
+#define INJECTION_LEAD      (4u)                                                        // set, pull, out, out before wait 1 irq 0
+#define INJECTION_WRITE     (10u)                                                       // mov pins, x through set pins, 0b011 (nop[5] is 6)
+#define INJECTION_STALL     (1u << 28)                                                  // Cycles without IRQ 0 before we call it a hang
+#define FIFO_DEPTH          (4u)                                                        // Words per FIFO, not joined
+
+/*
+A FIFO entry carries a tag next to the word: where the DMA read it from
+(0-0x7FFF within the image, see sim_dma.c) or -1 for anything else. It
+follows the word through the OSR onto the out pins so sim_bus.c can tell
+which ROM address the byte on the data pins belongs to.
+*/
+struct sim_fifo {
+    uint32_t words[FIFO_DEPTH];
+    int32_t tags[FIFO_DEPTH];
+    uint8_t head;
+    uint8_t count;
+};
+
+struct sim_sm {
+    pio_sm_config config;
+    volatile bool enabled;
+    uint8_t pc;
+    uint8_t delay;                                                                      // Cycles left on the current [delay]
+    uint32_t x, y, isr, osr;
+    int32_t osr_tag;                                                                    // Tag of the word last pulled into the OSR
+    struct sim_fifo tx, rx;
+    uint64_t words;                                                                     // Words injected (sm0 of a core 1 clocked PIO)
+};
+
+struct sim_pio {
+    pio_hw_t hw;                                                                        // First, PIO points here
+    uint16_t used;                                                                      // Instruction memory handed out
+    uint16_t instructions[PIO_INSTRUCTION_COUNT];                                       // Loaded programs, jumps relocated
+    uint8_t irq;                                                                        // IRQ flags 0-7
+    uint64_t cycle;                                                                     // Cycles run so far
+    uint32_t pins;                                                                      // Levels this PIO drives
+    uint32_t pindirs;                                                                   // Pins it drives at all
+    int32_t pin_tag;                                                                    // Tag of the last word put on the out pins
+    bool clocked;                                                                       // ROM_PIO: the clock thread is running
+    struct sim_sm sm[NUM_PIO_STATE_MACHINES];
+};
+
+static struct sim_pio pios[NUM_PIOS];
+PIO pio0 = &pios[0].hw;
+PIO pio1 = &pios[1].hw;
+PIO pio2 = &pios[2].hw;
+uint8_t* sim_sram;                                                                      // What the ECUs would read, SRAM_SIZE per PIO
+
+/*
+The model behind a PIO.
+*/
+static struct sim_pio* model(PIO pio){
+    return (struct sim_pio *)pio;
+}
+
+/*
+Sets up the SRAM model, mapped to AETHERION_SRAM if it is set
+so scripts can look at what the ECU sees while the sim runs.
+*/
+void sim_pio_boot(){
+    const char* path = getenv("AETHERION_SRAM");
+    if (!path){
+        sim_sram = calloc(NUM_PIOS, SRAM_SIZE);
+        return;
+    }
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || ftruncate(fd, NUM_PIOS * SRAM_SIZE)){panic("cannot create SRAM image %s: %s", path, strerror(errno));}
+    sim_sram = mmap(NULL, NUM_PIOS * SRAM_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (sim_sram == MAP_FAILED){panic("cannot map SRAM image %s: %s", path, strerror(errno));}
+    close(fd);
+    fprintf(stderr, "aetherion-sim: %-10s %s\n", "sram", path);
+}
+
+static bool fifo_push(struct sim_fifo* fifo, uint32_t word, int32_t tag){
+    if (fifo->count == FIFO_DEPTH){return false;}
+    uint8_t slot = (fifo->head + fifo->count) % FIFO_DEPTH;
+    fifo->words[slot] = word;
+    fifo->tags[slot] = tag;
+    fifo->count++;
+    return true;
+}
+
+static bool fifo_pop(struct sim_fifo* fifo, uint32_t* word, int32_t* tag){
+    if (!fifo->count){return false;}
+    *word = fifo->words[fifo->head];
+    *tag = fifo->tags[fifo->head];
+    fifo->head = (fifo->head + 1) % FIFO_DEPTH;
+    fifo->count--;
+    return true;
+}
+
+pio_sm_config pio_get_default_sm_config(void){
+    pio_sm_config c = {.in_right = true, .out_right = true, .pull_threshold = 32, .clkdiv = 1.0f,
+                       .wrap = PIO_INSTRUCTION_COUNT - 1};
+    return c;
+}
+
+void sm_config_set_wrap(pio_sm_config* c, uint wrap_target, uint wrap){
+    c->wrap_target = wrap_target;
+    c->wrap = wrap;
+}
+
+void sm_config_set_out_shift(pio_sm_config* c, bool shift_right, bool autopull, uint pull_threshold){
+    c->out_right = shift_right;
+    c->pull_threshold = pull_threshold;
+}
+
+void sm_config_set_in_shift(pio_sm_config* c, bool shift_right, bool autopush, uint push_threshold){
+    c->in_right = shift_right;
+}
+
+void sm_config_set_in_pins(pio_sm_config* c, uint in_base){
+    c->in_base = in_base;
+}
+
+void sm_config_set_jmp_pin(pio_sm_config* c, uint pin){
+    c->jmp_pin = pin;
+}
+
+void sm_config_set_out_pins(pio_sm_config* c, uint out_base, uint out_count){
+    c->out_base = out_base;
+    c->out_count = out_count;
+}
+
+void sm_config_set_set_pins(pio_sm_config* c, uint set_base, uint set_count){
+    c->set_base = set_base;
+    c->set_count = set_count;
+}
+
+void sm_config_set_clkdiv(pio_sm_config* c, float div){
+    c->clkdiv = div;
+}
+
+/*
+Loads a program after the ones already there and relocates its
+jumps, like the SDK does for programs with origin -1.
+*/
+uint pio_add_program(PIO pio, const pio_program_t* program){
+    struct sim_pio* p = model(pio);
+    if (p->used + program->length > PIO_INSTRUCTION_COUNT){panic("PIO instruction memory full");}
+    uint offset = p->used;
+    for (uint i = 0; i < program->length; i++){
+        uint16_t instruction = program->instructions[i];
+        if (!(instruction >> 13)){instruction += offset;}                               // JMP: the address is the low 5 bits
+        p->instructions[offset + i] = instruction;
+    }
+    p->used += program->length;
+    return offset;
+}
+
+uint pio_get_index(PIO pio){
+    return model(pio) - pios;
+}
+
+PIO pio_get_instance(uint instance){
+    return &pios[instance].hw;
+}
+
+/*
+DREQ numbers as on the chip: 8 per PIO, TX 0-3 then RX 4-7.
+*/
+uint pio_get_dreq(PIO pio, uint sm, bool is_tx){
+    return (pio_get_index(pio) * 8u) + (is_tx ? 0u : 4u) + sm;
+}
+
+void pio_gpio_init(PIO pio, uint pin){
+}
+
+void pio_sm_set_consecutive_pindirs(PIO pio, uint sm, uint pin_base, uint pin_count, bool is_out){
+    uint32_t mask = (uint32_t)(((1ull << pin_count) - 1) << pin_base);
+    if (is_out){model(pio)->pindirs |= mask;}
+    else {model(pio)->pindirs &= ~mask;}
+}
+
+void pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config* config){
+    struct sim_sm* s = &model(pio)->sm[sm];
+    s->config = *config;
+    s->enabled = false;
+    s->pc = initial_pc;
+    s->delay = 0;
+    s->x = s->y = s->isr = s->osr = 0;
+    s->osr_tag = -1;
+    s->tx.count = s->rx.count = 0;
+}
+
+/*
+Level of every GPIO as a PIO sees it at a cycle: its own pins where it
+drives them, the ECU (sim_bus.c) everywhere else.
+*/
+static uint32_t levels(struct sim_pio* p, uint64_t cycle){
+    return (sim_bus_pins(cycle) & ~p->pindirs) | (p->pins & p->pindirs);
+}
+
+static bool level(struct sim_pio* p, uint pin, uint64_t cycle){
+    return (levels(p, cycle) >> (pin & 31)) & 1;
+}
+
+/*
+Value of a MOV source.
+*/
+static uint32_t mov_source(struct sim_pio* p, uint sm, uint source, uint64_t cycle){
+    switch (source){
+        case pio_pins:  return levels(p, cycle) >> p->sm[sm].config.in_base;
+        case pio_x:     return p->sm[sm].x;
+        case pio_y:     return p->sm[sm].y;
+        case pio_null:  return 0;
+        case pio_isr:   return p->sm[sm].isr;
+        case pio_osr:   return p->sm[sm].osr;
+    }
+    panic("PIO mov from source %u is not modelled", source);
+    return 0;
+}
+
+/*
+Writes value to the out pins of a state machine, or their directions.
+*/
+static void out_pins(struct sim_pio* p, uint sm, uint32_t value, uint count, bool directions){
+    const pio_sm_config* c = &p->sm[sm].config;
+    if (count > c->out_count){count = c->out_count;}
+    uint32_t mask = (uint32_t)(((1ull << count) - 1) << c->out_base);
+    uint32_t bits = (value << c->out_base) & mask;
+    if (directions){p->pindirs = (p->pindirs & ~mask) | bits;}
+    else {
+        p->pins = (p->pins & ~mask) | bits;
+        p->pin_tag = p->sm[sm].osr_tag;                                                 // Which byte of the image is on the pins
+    }
+}
+
+/*
+Runs one instruction on a state machine. Returns false if it stalls
+(a wait that is not met, a blocking pull on an empty FIFO or push to a
+full one), the instruction is then run again on the next cycle. Only
+what injection.pio and rom_emulation.pio use is modelled, anything else
+stops the sim.
+*/
+static bool execute(struct sim_pio* p, uint sm, uint16_t instruction, uint64_t cycle){
+    struct sim_sm* s = &p->sm[sm];
+    uint8_t next = (s->pc == s->config.wrap) ? s->config.wrap_target : s->pc + 1;
+    uint index = instruction & 0x1F;
+    uint count = index ? index : 32;                                                    // Bit counts of IN and OUT, 0 is 32
+    uint64_t mask = (1ull << count) - 1;
+    switch (instruction >> 13){
+        case 0: {                                                                       // JMP
+            bool jump = false;
+            switch ((instruction >> 5) & 7){
+                case 0: jump = true; break;
+                case 1: jump = !s->x; break;
+                case 2: jump = s->x != 0; s->x--; break;
+                case 3: jump = !s->y; break;
+                case 4: jump = s->y != 0; s->y--; break;
+                case 5: jump = s->x != s->y; break;
+                case 6: jump = level(p, s->config.jmp_pin, cycle); break;
+                default: panic("PIO jmp !osre is not modelled");
+            }
+            if (jump){next = index;}
+            break;
+        }
+        case 1: {                                                                       // WAIT
+            bool polarity = instruction & 0x80;
+            bool met = false;
+            switch ((instruction >> 5) & 3){
+                case 0: met = level(p, index, cycle); break;
+                case 1: met = level(p, s->config.in_base + index, cycle); break;
+                case 2: met = p->irq & (1u << (index & 7)); break;
+                default: panic("PIO wait jmppin is not modelled");
+            }
+            if (met != polarity){return false;}                                         // Stall
+            if (((instruction >> 5) & 3) == 2 && polarity){p->irq &= ~(1u << (index & 7));}  // wait 1 irq clears the flag
+            break;
+        }
+        case 2: {                                                                       // IN
+            uint32_t data = (uint32_t)(mov_source(p, sm, (instruction >> 5) & 7, cycle) & mask);
+            if (count == 32){s->isr = data;}
+            else if (s->config.in_right){s->isr = (s->isr >> count) | (data << (32 - count));}
+            else {s->isr = (s->isr << count) | data;}
+            break;
+        }
+        case 3: {                                                                       // OUT
+            uint32_t data;
+            if (count == 32){data = s->osr; s->osr = 0;}
+            else if (s->config.out_right){data = s->osr & (uint32_t)mask; s->osr >>= count;}
+            else {data = s->osr >> (32 - count); s->osr <<= count;}
+            switch ((instruction >> 5) & 7){
+                case 0: out_pins(p, sm, data, count, false); break;
+                case 1: s->x = data; break;
+                case 2: s->y = data; break;
+                case 3: break;                                                          // null
+                case 4: out_pins(p, sm, data, count, true); break;
+                default: panic("PIO out to destination %u is not modelled", (instruction >> 5) & 7);
+            }
+            break;
+        }
+        case 4: {                                                                       // PUSH / PULL
+            if (!(instruction & 0x80)){                                                 // PUSH
+                if (!fifo_push(&s->rx, s->isr, -1)){
+                    if (instruction & 0x20){return false;}                              // Blocking push on a full FIFO
+                }
+                s->isr = 0;
+            }
+            else if (fifo_pop(&s->tx, &s->osr, &s->osr_tag)){}                          // PULL
+            else if (instruction & 0x20){return false;}                                 // Blocking pull on an empty FIFO
+            else {s->osr = s->x; s->osr_tag = -1;}                                      // Non-blocking pull copies X
+            break;
+        }
+        case 5: {                                                                       // MOV
+            uint32_t value = mov_source(p, sm, instruction & 7, cycle);
+            if (((instruction >> 3) & 3) == 1){value = ~value;}
+            switch ((instruction >> 5) & 7){
+                case pio_pins: out_pins(p, sm, value, 32, false); break;
+                case pio_x: s->x = value; break;
+                case pio_y: s->y = value; break;
+                case pio_pindirs: out_pins(p, sm, value, 32, true); break;
+                case pio_isr: s->isr = value; break;
+                case pio_osr: s->osr = value; break;
+                default: panic("PIO mov to destination %u is not modelled", (instruction >> 5) & 7);
+            }
+            break;
+        }
+        case 6: {                                                                       // IRQ
+            if (instruction & 0x40){p->irq &= ~(1u << (index & 7));}
+            else {p->irq |= (1u << (index & 7));}
+            break;
+        }
+        case 7: {                                                                       // SET
+            if (((instruction >> 5) & 7) == pio_x){s->x = index;}
+            if (((instruction >> 5) & 7) == pio_y){s->y = index;}
+            break;
+        }
+    }
+    s->pc = next;
+    s->delay = (instruction >> 8) & 0x1F;                                               // No side set, all 5 bits are delay
+    return true;
+}
+
+/*
+Runs every enabled state machine except the one being fed for a number of cycles.
+*/
+static void run(struct sim_pio* p, uint fed, uint32_t cycles){
+    while (cycles--){
+        for (uint sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++){
+            if (sm == fed || !p->sm[sm].enabled){continue;}
+            if (p->sm[sm].delay){p->sm[sm].delay--; continue;}
+            execute(p, sm, p->instructions[p->sm[sm].pc], p->cycle);
+        }
+        p->cycle++;
+    }
+}
+
+/*
+pio1's clock: every cycle its state machines run, then the DMA, then
+the ECU checks what is on the data pins. Runs as fast as the host lets
+it, time is counted in PIO cycles.
+*/
+static void* clock_thread(void* argument){
+    struct sim_pio* p = argument;
+    while (1){
+        run(p, NUM_PIO_STATE_MACHINES, 1);
+        sim_dma_step();
+        sim_bus_read(p->cycle, p->pins, p->pindirs, p->pin_tag);
+        if (!(p->cycle & 0xFFFFF)){sched_yield();}                                      // Let the cores in now and then
+    }
+    return NULL;
+}
+
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled){
+    struct sim_pio* p = model(pio);
+    p->sm[sm].enabled = enabled;
+    if (ROM_EMULATION && pio == ROM_PIO && enabled && !p->clocked){
+        p->clocked = true;
+        sim_thread(clock_thread, p);
+    }
+}
+
+void pio_enable_sm_mask_in_sync(PIO pio, uint32_t mask){
+    for (uint sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++){
+        if (mask & (1u << sm)){pio_sm_set_enabled(pio, sm, true);}
+    }
+}
+
+void pio_sm_put(PIO pio, uint sm, uint32_t data){
+    if (!fifo_push(&model(pio)->sm[sm].tx, data, -1)){panic("pio_sm_put to a full TX FIFO");}
+}
+
+/*
+Runs one instruction right away, outside the program (pio_sm_exec).
+*/
+void pio_sm_exec(PIO pio, uint sm, uint instr){
+    struct sim_pio* p = model(pio);
+    uint8_t pc = p->sm[sm].pc;
+    if (!execute(p, sm, instr, p->cycle)){panic("PIO exec of %04x would stall", instr);}
+    if (instr >> 13){p->sm[sm].pc = pc;}                                                // Only a JMP moves the program counter
+    p->sm[sm].delay = 0;
+}
+
+/*
+One word is one write cycle: out null, 8 then out x, 24 leave the low
+24 bits of the word on the out pins, which are then decoded against
+the SRAM wiring above. Before that the word waits on IRQ 0 while the
+other state machines (the snoop) run, and the write is checked against
+the ECU bus model. The word itself lands in the SRAM model either way.
+*/
+void pio_sm_put_blocking(PIO pio, uint sm, uint32_t data){
+    struct sim_pio* p = model(pio);
+    while (!p->sm[sm].enabled){sim_safepoint(); sched_yield();}                         // A stopped state machine never drains its FIFO
+    run(p, sm, INJECTION_LEAD);                                                         // Up to wait 1 irq 0
+    uint64_t waited = 0;
+    while (!(p->irq & 1u)){                                                             // Until the snoop lets us on the bus
+        if (++waited > INJECTION_STALL){panic("injection waits on IRQ 0 but nothing raises it");}
+        run(p, sm, 1);
+    }
+    p->irq &= ~1u;                                                                      // wait 1 irq 0 clears it
+    run(p, sm, 1);
+    sim_bus_write(pio_get_index(pio), p->cycle, INJECTION_WRITE);                       // Check the write against the ECU
+    run(p, sm, INJECTION_WRITE + 1);                                                    // Through the last mov pins, x
+    const pio_sm_config* c = &p->sm[sm].config;
+    uint64_t pins = ((uint64_t)(data & 0xFFFFFFu)) << c->out_base;                      // GPIO levels after mov pins, x
+    uint8_t value = (pins >> SRAM_DATA_PIN) & 0xFF;
+    uint16_t address = (pins >> SRAM_ADDRESS_PIN) & 0x7FFF;
+    uint32_t bank = (pins >> SRAM_BANK_PIN) & 1;
+    sim_sram[(pio_get_index(pio) * SRAM_SIZE) + ((bank << 15) | address)] = value;
+    p->sm[sm].words++;
+}
+
+bool pio_sm_is_tx_fifo_full(PIO pio, uint sm){
+    return model(pio)->sm[sm].tx.count == FIFO_DEPTH;
+}
+
+bool pio_sm_is_tx_fifo_empty(PIO pio, uint sm){
+    return !model(pio)->sm[sm].tx.count;
+}
+
+/*
+Finds the state machine whose FIFO register is at a bus address.
+*/
+static struct sim_sm* fifo_at(uintptr_t address, bool tx){
+    for (uint i = 0; i < NUM_PIOS; i++){
+        for (uint sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++){
+            volatile uint32_t* reg = tx ? &pios[i].hw.txf[sm] : &pios[i].hw.rxf[sm];
+            if ((uintptr_t)reg == address){return &pios[i].sm[sm];}
+        }
+    }
+    return NULL;
+}
+
+/*
+DMA side (sim_dma.c): is a DREQ asserted, and reads and writes that
+land on a FIFO register. The reads and writes return false for any
+other address, the DMA then goes to memory.
+*/
+bool sim_pio_dreq(unsigned dreq){
+    struct sim_sm* s = &pios[(dreq / 8) % NUM_PIOS].sm[dreq % 4];
+    return (dreq % 8 < 4) ? s->tx.count < FIFO_DEPTH : s->rx.count > 0;
+}
+
+bool sim_pio_dma_read(uintptr_t address, uint32_t* value){
+    struct sim_sm* s = fifo_at(address, false);
+    int32_t tag;
+    if (!s){return false;}
+    if (!fifo_pop(&s->rx, value, &tag)){*value = 0;}                                    // Empty RX FIFO reads 0 like the chip
+    return true;
+}
+
+bool sim_pio_dma_write(uintptr_t address, uint32_t value, int32_t tag){
+    struct sim_sm* s = fifo_at(address, true);
+    if (!s){return false;}
+    fifo_push(&s->tx, value, tag);                                                      // A full TX FIFO drops it like the chip
+    return true;
+}
+
+void sim_pio_report(){
+    for (uint i = 0; i < NUM_PIOS; i++){
+        if (!i || pios[i].sm[0].words){fprintf(stderr, "aetherion-sim: pio%u sm0 %llu words injected\n", i, (unsigned long long)pios[i].sm[0].words);}
+    }
+}
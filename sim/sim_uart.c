@@ -0,0 +1,168 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <poll.h>
+#include <unistd.h>
+#include "pico/stdlib.h"
+#include "hardware/uart.h"
+#include "sim.h"
+
+#define UART_FIFO   (32u)                                                               // RP2350 UART RX FIFO depth
+
+struct uart_inst {
+    int fd;                                                                             // PTY master, -1 if not wired
+    unsigned irq;
+    unsigned baudrate;
+    volatile bool rx_irq;                                                               // uart_set_irq_enables(rx_has_data)
+    uint16_t fifo[UART_FIFO];                                                           // Received bytes with their error bits, like the data register
+    uint8_t head;
+    uint8_t count;
+    bool overrun;                                                                       // A byte was lost, flag the next one
+    uart_hw_t hw;                                                                       // uart_get_hw()
+};
+
+static struct uart_inst uarts[2] = {
+    {.fd = -1, .irq = UART0_IRQ},
+    {.fd = -1, .irq = UART1_IRQ}
+};
+uart_inst_t* uart0 = &uarts[0];
+uart_inst_t* uart1 = &uarts[1];
+
+/*
+Moves what the ECU side has sent from the PTY into the RX FIFO. Bytes
+that find the FIFO full are lost like on the chip (the ECU sends at
+line rate, so what waits in the PTY is what arrived since last time).
+*/
+static void receive(uart_inst_t* uart){
+    uint8_t bytes[256];
+    ssize_t got = read(uart->fd, bytes, sizeof(bytes));
+    for (ssize_t i = 0; i < got; i++){
+        if (uart->count == UART_FIFO){uart->overrun = true; continue;}                  // Full, the byte is gone
+        uart->fifo[(uart->head + uart->count++) % UART_FIFO] = bytes[i] | (uart->overrun ? UART_UARTDR_OE_BITS : 0);
+        uart->overrun = false;
+    }
+}
+
+/*
+Fills the RX FIFO, lets a DMA channel on the RX DREQ empty it (it
+does not care about interrupts) and raises the RX interrupt unless
+interrupts are off, then the FIFO has to hold until they are back.
+The FIFO is only ever touched from this thread (handlers run on it).
+With nobody on the PTY it just waits.
+*/
+static void* rx_thread(void* argument){
+    uart_inst_t* uart = argument;
+    sim_core = 0;                                                                       // UART IRQs are served by core 0
+    while (1){
+        struct pollfd entry = {.fd = uart->fd, .events = POLLIN};
+        poll(&entry, 1, 1);
+        if (entry.revents & POLLIN){receive(uart);}
+        sim_dma_serve(uart_get_dreq(uart, false));
+        if (uart->count && uart->rx_irq){sim_irq_try(uart->irq);}
+        if (entry.revents & POLLHUP){
+            usleep(1000);                                                               // Unplugged, do not spin
+        }
+    }
+    return NULL;
+}
+
+void sim_uart_boot(){
+    uart0->fd = sim_pty("ecu");
+    sim_thread(rx_thread, uart0);
+}
+
+unsigned uart_init(uart_inst_t* uart, unsigned baudrate){
+    uart->baudrate = baudrate;
+    uart->head = uart->count = 0;
+    return baudrate;
+}
+
+void uart_set_format(uart_inst_t* uart, unsigned data_bits, unsigned stop_bits, uart_parity_t parity){
+}
+
+void uart_set_fifo_enabled(uart_inst_t* uart, bool enabled){
+}
+
+void uart_set_irq_enables(uart_inst_t* uart, bool rx_has_data, bool tx_needs_data){
+    uart->rx_irq = rx_has_data;
+}
+
+bool uart_is_readable(uart_inst_t* uart){
+    return uart->count > 0;
+}
+
+bool uart_is_writable(uart_inst_t* uart){
+    return true;
+}
+
+/*
+Pops the RX FIFO, the error bits of the byte go to the receive status
+(reads of the data register through the DMA keep them).
+*/
+static uint16_t pop(uart_inst_t* uart){
+    uint16_t entry = uart->fifo[uart->head];
+    uart->head = (uart->head + 1) % UART_FIFO;
+    uart->count--;
+    uart->hw.rsr = entry >> 8;
+    return entry;
+}
+
+char uart_getc(uart_inst_t* uart){
+    while (!uart_is_readable(uart)){tight_loop_contents();}
+    return (char)pop(uart);
+}
+
+void uart_write_blocking(uart_inst_t* uart, const uint8_t* src, size_t len){
+    if (uart->fd < 0 || !sim_pty_connected(uart->fd)){return;}                          // Nobody on the wire, the bytes are gone
+    while (len){
+        ssize_t put = write(uart->fd, src, len);
+        if (put <= 0){usleep(100); continue;}
+        src += put;
+        len -= put;
+    }
+}
+
+void uart_putc_raw(uart_inst_t* uart, char c){
+    uart_write_blocking(uart, (const uint8_t *)&c, 1);
+}
+
+unsigned uart_get_index(uart_inst_t* uart){
+    return (unsigned)(uart - uarts);
+}
+
+uart_hw_t* uart_get_hw(uart_inst_t* uart){
+    return &uart->hw;
+}
+
+unsigned uart_get_dreq(uart_inst_t* uart, bool is_tx){
+    return DREQ_UART0_TX + 2 * uart_get_index(uart) + (is_tx ? 0 : 1);
+}
+
+/*
+RX DREQ: the FIFO has a byte. The TX side is never paced (writes go
+straight to the PTY).
+*/
+bool sim_uart_dreq(unsigned dreq){
+    uart_inst_t* uart = &uarts[((dreq - DREQ_UART0_TX) / 2) % 2];
+    return ((dreq - DREQ_UART0_TX) % 2) && uart->count;
+}
+
+/*
+DMA read of a data register: pops the RX FIFO, byte and error bits.
+*/
+bool sim_uart_dma_read(uintptr_t address, uint32_t* value){
+    for (uint8_t i = 0; i < 2; i++){
+        if (address != (uintptr_t)&uarts[i].hw.dr){continue;}
+        *value = uarts[i].count ? pop(&uarts[i]) : 0;                                   // Empty FIFO reads 0
+        return true;
+    }
+    return false;
+}
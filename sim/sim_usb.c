@@ -0,0 +1,192 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <poll.h>
+#include <unistd.h>
+#include "pico/stdlib.h"
+#include "tusb.h"
+#include "sim.h"
+
+/*
+One PTY per CDC interface. Like TinyUSB, writes collect in the TX FIFO
+and go out on tud_cdc_n_write_flush() or once a full packet is waiting,
+reads come from the RX FIFO that tud_task() fills. Whatever is written
+while the port is closed is dropped, the same as an unopened COMPORT.
+*/
+typedef struct {
+    int fd;                                                                             // PTY master
+    bool connected;                                                                     // Slave side open (DTR)
+    uint8_t rx[CFG_TUD_CDC_RX_BUFSIZE];                                                 // Ring filled by tud_task()
+    uint32_t rx_head;
+    uint32_t rx_count;
+    uint8_t tx[CFG_TUD_CDC_TX_BUFSIZE];                                                 // Waiting for a flush
+    uint32_t tx_count;
+    uint64_t received;                                                                  // Bytes from the host
+    uint64_t sent;                                                                      // Bytes to the host
+    uint64_t flushes;                                                                   // Writes to the PTY
+    uint64_t packets;                                                                   // 64 byte USB packets those would take
+} cdc_t;
+
+static cdc_t cdc[CFG_TUD_CDC];
+static const char* const roles[] = {"emulation", "datalog", "developer", "emulation1", "emulation2"};
+
+void sim_usb_boot(){
+    for (uint8_t i = 0; i < CFG_TUD_CDC; i++){
+        cdc[i].fd = sim_pty(roles[i]);
+    }
+}
+
+/*
+Walks the configuration descriptor from descriptors.c so a length or
+interface count that does not add up shows here instead of as a
+device Windows refuses to enumerate.
+*/
+bool tusb_init(void){
+    const uint8_t* config = tud_descriptor_configuration_cb(0);
+    uint16_t total = config[2] | (config[3] << 8);
+    uint16_t walked = 0;
+    uint8_t interfaces = 0;
+    while (walked < total && config[walked]){
+        if (config[walked + 1] == TUSB_DESC_INTERFACE && !config[walked + 3]){interfaces++;}  // Alternate setting 0 only
+        walked += config[walked];
+    }
+    fprintf(stderr, "aetherion-sim: usb        %u byte configuration, %u interfaces\n", total, interfaces);
+    if (walked != total || interfaces != config[4]){
+        fprintf(stderr, "aetherion-sim: usb        descriptor mismatch: walked %u bytes, header says %u interfaces\n",
+                walked, config[4]);
+    }
+    return true;
+}
+
+/*
+Moves whatever the host sent into the RX FIFOs and notices ports
+being opened and closed.
+*/
+void tud_task(void){
+    struct pollfd entries[CFG_TUD_CDC];
+    for (uint8_t i = 0; i < CFG_TUD_CDC; i++){
+        entries[i] = (struct pollfd){.fd = cdc[i].fd, .events = POLLIN};
+    }
+    if (poll(entries, CFG_TUD_CDC, 0) <= 0){
+        for (uint8_t i = 0; i < CFG_TUD_CDC; i++){cdc[i].connected = true;}             // Nothing pending and nobody hung up
+        return;
+    }
+    for (uint8_t i = 0; i < CFG_TUD_CDC; i++){
+        cdc_t* port = &cdc[i];
+        port->connected = !(entries[i].revents & POLLHUP);
+        if (!port->connected){port->tx_count = 0; continue;}
+        while ((entries[i].revents & POLLIN) && port->rx_count < CFG_TUD_CDC_RX_BUFSIZE){
+            uint32_t tail = (port->rx_head + port->rx_count) % CFG_TUD_CDC_RX_BUFSIZE;
+            uint32_t space = CFG_TUD_CDC_RX_BUFSIZE - port->rx_count;
+            if (space > CFG_TUD_CDC_RX_BUFSIZE - tail){space = CFG_TUD_CDC_RX_BUFSIZE - tail;}  // Up to the end of the ring
+            ssize_t got = read(port->fd, port->rx + tail, space);
+            if (got <= 0){break;}
+            port->rx_count += got;
+            port->received += got;
+        }
+    }
+}
+
+bool tud_mounted(void){
+    return true;
+}
+
+bool tud_cdc_n_connected(uint8_t itf){
+    return cdc[itf].connected;
+}
+
+uint32_t tud_cdc_n_available(uint8_t itf){
+    return cdc[itf].rx_count;
+}
+
+uint32_t tud_cdc_n_read(uint8_t itf, void* buffer, uint32_t bufsize){
+    cdc_t* port = &cdc[itf];
+    uint32_t count = (bufsize < port->rx_count) ? bufsize : port->rx_count;
+    for (uint32_t i = 0; i < count; i++){
+        ((uint8_t *)buffer)[i] = port->rx[port->rx_head];
+        port->rx_head = (port->rx_head + 1) % CFG_TUD_CDC_RX_BUFSIZE;
+    }
+    port->rx_count -= count;
+    return count;
+}
+
+bool tud_cdc_n_peek(uint8_t itf, uint8_t* u8){
+    if (!cdc[itf].rx_count){return false;}
+    *u8 = cdc[itf].rx[cdc[itf].rx_head];
+    return true;
+}
+
+uint32_t tud_cdc_n_write(uint8_t itf, const void* buffer, uint32_t bufsize){
+    cdc_t* port = &cdc[itf];
+    uint32_t space = CFG_TUD_CDC_TX_BUFSIZE - port->tx_count;
+    uint32_t count = (bufsize < space) ? bufsize : space;
+    memcpy(port->tx + port->tx_count, buffer, count);
+    port->tx_count += count;
+    if (port->tx_count >= CFG_TUD_CDC_EP_BUFSIZE){tud_cdc_n_write_flush(itf);}          // TinyUSB starts a transfer once a packet is full
+    return count;
+}
+
+uint32_t tud_cdc_n_write_char(uint8_t itf, char ch){
+    return tud_cdc_n_write(itf, &ch, 1);
+}
+
+uint32_t tud_cdc_n_write_flush(uint8_t itf){
+    cdc_t* port = &cdc[itf];
+    if (!port->tx_count){return 0;}
+    if (!port->connected){port->tx_count = 0; return 0;}
+    ssize_t put = write(port->fd, port->tx, port->tx_count);
+    if (put <= 0){return 0;}                                                            // Host is not reading, try again later
+    memmove(port->tx, port->tx + put, port->tx_count - put);
+    port->tx_count -= put;
+    port->sent += put;
+    port->flushes++;
+    port->packets += (put + CFG_TUD_CDC_EP_BUFSIZE - 1) / CFG_TUD_CDC_EP_BUFSIZE;       // Full ones and one short one
+    return (uint32_t)put;
+}
+
+uint32_t tud_cdc_n_write_available(uint8_t itf){
+    return CFG_TUD_CDC_TX_BUFSIZE - cdc[itf].tx_count;
+}
+
+/*
+The vendor bulk interface is never mounted on the host.
+*/
+bool tud_vendor_mounted(void){
+    return false;
+}
+
+uint32_t tud_vendor_available(void){
+    return 0;
+}
+
+uint32_t tud_vendor_read(void* buffer, uint32_t bufsize){
+    return 0;
+}
+
+uint32_t tud_vendor_write(const void* buffer, uint32_t bufsize){
+    return 0;
+}
+
+uint32_t tud_vendor_write_flush(void){
+    return 0;
+}
+
+uint32_t tud_vendor_write_available(void){
+    return 0;
+}
+
+void sim_usb_report(){
+    for (uint8_t i = 0; i < CFG_TUD_CDC; i++){
+        fprintf(stderr, "aetherion-sim: %-10s %llu bytes in, %llu bytes out in %llu writes (%llu packets)\n", roles[i],
+                (unsigned long long)cdc[i].received, (unsigned long long)cdc[i].sent, (unsigned long long)cdc[i].flushes,
+                (unsigned long long)cdc[i].packets);
+    }
+}
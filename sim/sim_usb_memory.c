@@ -0,0 +1,148 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "tusb.h"
+#include "sim.h"
+
+/*
+In-memory stand-in for sim_usb.c, linked into aetherion_bench instead.
+Every CDC interface is a pair of buffers: sim_usb_feed() plays the host
+sending bytes, whatever the firmware writes is counted and dropped on
+tud_cdc_n_write_flush() (or once a full packet is waiting, like TinyUSB).
+Every port is always connected, no PTYs are opened and tud_task() has
+nothing to do. The vendor bulk interface is never mounted.
+*/
+typedef struct {
+    uint8_t rx[CFG_TUD_CDC_RX_BUFSIZE];                                                 // Ring filled by sim_usb_feed()
+    uint32_t rx_head;
+    uint32_t rx_count;
+    uint32_t tx_count;                                                                  // Waiting for a flush
+    uint64_t received;                                                                  // Bytes from the host
+    uint64_t sent;                                                                      // Bytes to the host
+} memory_port_t;
+
+static memory_port_t ports[CFG_TUD_CDC];
+
+void sim_usb_boot(){
+}
+
+/*
+Plays the host: queues bytes on an interface for the firmware to read.
+Panics if they do not fit, a benchmark feeding more than a FIFO is broken.
+*/
+void sim_usb_feed(uint8_t itf, const void* data, uint32_t length){
+    memory_port_t* port = &ports[itf];
+    if (length > CFG_TUD_CDC_RX_BUFSIZE - port->rx_count){panic("sim_usb_feed(%u, %u) overflows the RX FIFO", itf, length);}
+    for (uint32_t i = 0; i < length; i++){
+        port->rx[(port->rx_head + port->rx_count + i) % CFG_TUD_CDC_RX_BUFSIZE] = ((const uint8_t *)data)[i];
+    }
+    port->rx_count += length;
+    port->received += length;
+}
+
+/*
+Returns how many bytes the firmware has sent on an interface so far.
+*/
+uint64_t sim_usb_sent(uint8_t itf){
+    return ports[itf].sent + ports[itf].tx_count;
+}
+
+bool tusb_init(void){
+    return true;
+}
+
+void tud_task(void){
+}
+
+bool tud_mounted(void){
+    return true;
+}
+
+bool tud_cdc_n_connected(uint8_t itf){
+    return true;
+}
+
+uint32_t tud_cdc_n_available(uint8_t itf){
+    return ports[itf].rx_count;
+}
+
+uint32_t tud_cdc_n_read(uint8_t itf, void* buffer, uint32_t bufsize){
+    memory_port_t* port = &ports[itf];
+    uint32_t count = (bufsize < port->rx_count) ? bufsize : port->rx_count;
+    for (uint32_t i = 0; i < count; i++){
+        ((uint8_t *)buffer)[i] = port->rx[port->rx_head];
+        port->rx_head = (port->rx_head + 1) % CFG_TUD_CDC_RX_BUFSIZE;
+    }
+    port->rx_count -= count;
+    return count;
+}
+
+bool tud_cdc_n_peek(uint8_t itf, uint8_t* u8){
+    if (!ports[itf].rx_count){return false;}
+    *u8 = ports[itf].rx[ports[itf].rx_head];
+    return true;
+}
+
+uint32_t tud_cdc_n_write(uint8_t itf, const void* buffer, uint32_t bufsize){
+    memory_port_t* port = &ports[itf];
+    uint32_t space = CFG_TUD_CDC_TX_BUFSIZE - port->tx_count;
+    uint32_t count = (bufsize < space) ? bufsize : space;
+    port->tx_count += count;
+    if (port->tx_count >= CFG_TUD_CDC_EP_BUFSIZE){tud_cdc_n_write_flush(itf);}          // TinyUSB starts a transfer once a packet is full
+    return count;
+}
+
+uint32_t tud_cdc_n_write_char(uint8_t itf, char ch){
+    return tud_cdc_n_write(itf, &ch, 1);
+}
+
+uint32_t tud_cdc_n_write_flush(uint8_t itf){
+    memory_port_t* port = &ports[itf];
+    uint32_t put = port->tx_count;
+    port->sent += put;
+    port->tx_count = 0;
+    return put;
+}
+
+uint32_t tud_cdc_n_write_available(uint8_t itf){
+    return CFG_TUD_CDC_TX_BUFSIZE - ports[itf].tx_count;
+}
+
+bool tud_vendor_mounted(void){
+    return false;
+}
+
+uint32_t tud_vendor_available(void){
+    return 0;
+}
+
+uint32_t tud_vendor_read(void* buffer, uint32_t bufsize){
+    return 0;
+}
+
+uint32_t tud_vendor_write(const void* buffer, uint32_t bufsize){
+    return 0;
+}
+
+uint32_t tud_vendor_write_flush(void){
+    return 0;
+}
+
+uint32_t tud_vendor_write_available(void){
+    return 0;
+}
+
+void sim_usb_report(){
+    for (uint8_t i = 0; i < CFG_TUD_CDC; i++){
+        fprintf(stderr, "aetherion-sim: cdc %u      %llu bytes in, %llu bytes out\n", i,
+                (unsigned long long)ports[i].received, (unsigned long long)sim_usb_sent(i));
+    }
+}
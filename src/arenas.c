@@ -0,0 +1,79 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "arenas.h"
+#include "rom_emulation.h"
+#include "developer_tools.h"
+
+uint8_t command_arena[COMMAND_SIZE];                                                    // Core 0, striped
+#if ROM_EMULATION
+uint8_t __aligned(TUNE_SIZE) payload_arena[EMULATION_CONTEXTS][TUNE_SIZE];              // Core 1, striped, the DMA takes its address bits
+#else
+uint8_t payload_arena[EMULATION_CONTEXTS][TUNE_SIZE];                                   // Core 1, striped
+#endif
+uint8_t __scratch_x("arenas") micro_arena[MICRO_SIZE];                                  // Core 1, SRAM8 next to its stack
+
+/*
+Linker symbols (memmap_default.ld) for the scratch banks and both stacks.
+*/
+extern char __scratch_x_start__;
+extern char __scratch_x_end__;
+extern char __scratch_y_start__;
+extern char __scratch_y_end__;
+extern char __StackOneBottom;
+extern char __StackOneTop;
+extern char __StackBottom;
+extern char __StackTop;
+
+/*
+Returns true if at is in [start, end). One unsigned compare, so bounds
+that are 0 (the host sim has no SRAM banks) are no special case.
+*/
+static bool within(uintptr_t at, uintptr_t start, uintptr_t end){
+    return at - start < end - start;
+}
+
+/*
+Names the SRAM bank an address is in.
+*/
+const char* sram_bank(const void* address){
+    uintptr_t at = (uintptr_t)address;
+    if (within(at, SRAM_STRIPED_BASE, SRAM_STRIPED_END)){return "SRAM0-7 (striped)";}
+    if (within(at, SRAM8_BASE, SRAM9_BASE)){return "SRAM8 (scratch X)";}
+    if (within(at, SRAM9_BASE, SRAM_END)){return "SRAM9 (scratch Y)";}
+    return "not SRAM";
+}
+
+/*
+Prints one region of the memory map.
+*/
+static void map_line(const char* name, const void* start, uint32_t size){
+    char line[96];
+    snprintf(line, sizeof(line), "  %-13s 0x%08lX %6lu bytes  %s", name, (unsigned long)(uintptr_t)start,
+             (unsigned long)size, sram_bank(start));
+    print(line, -1, false);
+}
+
+/*
+Prints where the arenas, the scratch data and both stacks ended up.
+Part of CMD_MM, so it also goes out once at boot.
+*/
+void post_memory_map(){
+    if (!DEVELOPER_CONSOLE){return;}                                                    // Perform security check
+    print("Memory map:", -1, false);
+    map_line("scratch X", &__scratch_x_start__, &__scratch_x_end__ - &__scratch_x_start__);
+    map_line("core 1 stack", &__StackOneBottom, &__StackOneTop - &__StackOneBottom);
+    map_line("scratch Y", &__scratch_y_start__, &__scratch_y_end__ - &__scratch_y_start__);
+    map_line("core 0 stack", &__StackBottom, &__StackTop - &__StackBottom);
+    map_line("micro", micro_arena, MICRO_SIZE);
+    map_line("payload", payload_arena, sizeof(payload_arena));
+    map_line("command", command_arena, COMMAND_SIZE);
+}
@@ -0,0 +1,52 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#ifndef ARENAS_H
+#define ARENAS_H
+#include "pico/stdlib.h"
+#include "tune_shadow.h"
+#include "contexts.h"
+
+/*
+Buffers that live for the whole run are fixed arenas instead of
+mallocs, so the linker decides which SRAM bank each one sits in.
+
+The RP2350 has 8 striped 64kb banks (SRAM0-7, consecutive words go
+to consecutive banks) and two 4kb banks that are not striped: SRAM8
+(scratch X) and SRAM9 (scratch Y). memmap_default.ld puts the core 1
+stack at the top of scratch X and the core 0 stack at the top of
+scratch Y.
+
+    scratch X   core 1: stack, injection loop state, micro buffer
+    scratch Y   core 0: stack
+    striped     payload mirror (core 1), command buffer (core 0), heap
+
+Core 1's per byte work then stays on its own bank port and only
+the payload reads go out to the striped banks, where core 0's USB
+and protocol traffic is spread over the other 7 ports.
+payload_arena has a 32kb mirror per emulation context (contexts.h). In
+ROM_EMULATION builds each is 32kb aligned so ROM emulation
+(rom_emulation.h) can serve context 0's to the ECU by putting the
+address bus in the low 15 bits, other builds do not pay for the hole.
+*/
+#define COMMAND_SIZE    (8192u)           // Ostrich command buffer (core 0)
+#define MICRO_SIZE      (256u)            // Largest micro injection (core 1)
+
+extern uint8_t command_arena[COMMAND_SIZE];
+extern uint8_t payload_arena[EMULATION_CONTEXTS][TUNE_SIZE];
+extern uint8_t micro_arena[MICRO_SIZE];
+
+/*
+function abstraction in arenas.c
+*/
+
+const char* sram_bank(const void* address);
+void post_memory_map();
+
+#endif
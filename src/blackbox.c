@@ -0,0 +1,276 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+#include "tusb.h"
+#include "flash_memory.h"
+#include "datalog.h"
+#include "blackbox.h"
+#include "developer_tools.h"
+#include "stats.h"
+
+#define PAGES_PER_SECTOR  (FLASH_SECTOR_SIZE / FLASH_PAGE_SIZE)                          // 16 pages per sector
+
+static uint8_t page[FLASH_PAGE_SIZE];                                                   // Page being filled
+static uint16_t page_used;                                                              // Bytes used in page (0 = no page open)
+static uint8_t previous[DATALOG_FRAME_SIZE];                                            // Last frame recorded, deltas are against it
+static uint32_t previous_ms;                                                            // When it was captured
+static uint8_t queue[BLACKBOX_QUEUE][FLASH_PAGE_SIZE];                                  // Sealed pages waiting for flash
+static uint8_t queue_head;                                                              // Next slot to fill
+static uint8_t queue_count;                                                             // Pages waiting
+static uint16_t write_page;                                                             // Next page of the ring to program
+static bool sector_ready;                                                               // Sector of write_page is erased
+static uint32_t next_sequence;                                                          // Sequence number of the next page
+static uint32_t frames;                                                                 // Frames recorded since boot
+static uint32_t dropped;                                                                // Pages dropped because the queue was full
+static bool downloading;                                                                // A download is streaming
+static uint16_t download_page;                                                          // Ring page being streamed
+static uint16_t download_left;                                                          // Ring pages left to look at
+static uint16_t download_offset;                                                        // Bytes of download_page already sent
+
+/*
+Returns the XIP address of a ring page.
+*/
+static const uint8_t* ring_page(uint16_t index){
+    return (const uint8_t *)(XIP_BASE + BLACKBOX_OFFSET + ((uint32_t)index * FLASH_PAGE_SIZE));
+}
+
+/*
+FNV-1a over a page minus its header.
+*/
+static uint32_t page_hash(const uint8_t* data){
+    uint32_t hash = 0x811C9DC5u;                                                        // FNV offset basis
+    for (uint32_t i = sizeof(blackbox_page_t); i < FLASH_PAGE_SIZE; i++){
+        hash = (hash ^ data[i]) * 0x01000193u;                                          // FNV prime
+    }
+    return hash;
+}
+
+/*
+Returns the header of a ring page if it holds a complete page, otherwise NULL.
+*/
+static const blackbox_page_t* page_at(uint16_t index){
+    const blackbox_page_t* header = (const blackbox_page_t *)ring_page(index);
+    if (header->magic != BLACKBOX_MAGIC){return NULL;}                                  // Erased or torn
+    if (page_hash(ring_page(index)) != header->hash){return NULL;}                      // Torn program
+    return header;
+}
+
+/*
+Returns true if a ring page was never programmed since its sector was erased.
+*/
+static bool page_blank(uint16_t index){
+    const uint32_t* words = (const uint32_t *)ring_page(index);                         // Check a word at a time
+    for (uint32_t i = 0; i < FLASH_PAGE_SIZE / 4; i++){
+        if (words[i] != 0xFFFFFFFFu){return false;}
+    }
+    return true;
+}
+
+/*
+Finds the newest page of the ring and carries on after it. Call once at boot.
+With BLACKBOX_RECORD the ECU is polled in the background whenever the
+datalog COMPORT is closed, so drives without a laptop are recorded too.
+*/
+void blackbox_init(){
+    datalog_background(BLACKBOX_RECORD);                                                // Poll the ECU when nobody else does
+    uint32_t newest = 0;                                                                // Highest sequence seen
+    int32_t newest_page = -1;                                                           // Where it lives
+    for (uint16_t index = 0; index < BLACKBOX_PAGES; index++){                          // Every page of the ring
+        const blackbox_page_t* header = page_at(index);
+        if (header && (newest_page < 0 || header->sequence > newest)){
+            newest = header->sequence;
+            newest_page = index;
+        }
+    }
+    next_sequence = (newest_page < 0) ? 1 : newest + 1;                                 // Keep counting from where we left off
+    write_page = (newest_page < 0) ? 0 : (uint16_t)((newest_page + 1) % BLACKBOX_PAGES);
+    sector_ready = (write_page % PAGES_PER_SECTOR) && page_blank(write_page);           // Mid sector and clean, carry on
+    if ((write_page % PAGES_PER_SECTOR) && !sector_ready){                              // Torn page, skip to the next sector
+        write_page = ((write_page / PAGES_PER_SECTOR) + 1) * PAGES_PER_SECTOR % BLACKBOX_PAGES;
+    }
+}
+
+/*
+Closes the page being filled and queues it for flash.
+*/
+static void seal_page(){
+    if (!page_used){return;}                                                            // Nothing open
+    blackbox_page_t* header = (blackbox_page_t *)page;
+    header->hash = page_hash(page);                                                     // Rest of the page is final now
+    if (queue_count == BLACKBOX_QUEUE){                                                 // Flash has not kept up
+        dropped++;
+    } else {
+        memcpy(queue[queue_head], page, FLASH_PAGE_SIZE);
+        queue_head = (queue_head + 1) % BLACKBOX_QUEUE;
+        queue_count++;
+    }
+    page_used = 0;                                                                      // Next frame opens a new page
+}
+
+/*
+Records a complete datalog frame captured at timestamp (us since boot).
+Only touches RAM, the flash work happens in blackbox_service().
+*/
+void blackbox_record(const uint8_t* frame, uint64_t timestamp){
+    uint32_t now = (uint32_t)(timestamp / 1000);                                        // Milliseconds since boot
+    uint8_t mask[BLACKBOX_MASK_BYTES] = {0};                                            // Bytes that changed
+    uint8_t changed = 0;
+    for (uint8_t i = 0; i < DATALOG_FRAME_SIZE; i++){                                   // Delta against the last frame
+        if (page_used && frame[i] == previous[i]){continue;}                            // First frame of a page is always whole
+        mask[i / 8] |= (1u << (i % 8));
+        changed++;
+    }
+    uint16_t size = 2 + BLACKBOX_MASK_BYTES + changed;                                  // dt + mask + bytes
+    if (page_used && page_used + size > FLASH_PAGE_SIZE){                               // Does not fit, start a new page
+        seal_page();
+        blackbox_record(frame, timestamp);                                              // Goes in whole this time
+        return;
+    }
+    if (!page_used){                                                                    // Open a new page
+        memset(page, 0xFF, FLASH_PAGE_SIZE);                                            // Unused bytes stay erased
+        blackbox_page_t header = {
+            .magic = BLACKBOX_MAGIC,
+            .sequence = next_sequence++,
+            .timestamp = now,
+            .hash = 0
+        };
+        memcpy(page, &header, sizeof(header));
+        page_used = sizeof(header);
+        previous_ms = now;                                                              // First dt of a page is 0
+    }
+    uint32_t dt = now - previous_ms;                                                    // Time since the last frame
+    if (dt > 0xFFFE){dt = 0xFFFE;}                                                      // 0xFFFF marks the end of a page
+    page[page_used++] = dt & 0xFF;
+    page[page_used++] = dt >> 8;
+    memcpy(&page[page_used], mask, BLACKBOX_MASK_BYTES);
+    page_used += BLACKBOX_MASK_BYTES;
+    for (uint8_t i = 0; i < DATALOG_FRAME_SIZE; i++){                                   // Changed bytes in order
+        if (mask[i / 8] & (1u << (i % 8))){page[page_used++] = frame[i];}
+    }
+    memcpy(previous, frame, DATALOG_FRAME_SIZE);
+    previous_ms = now;
+    frames++;
+}
+
+/*
+Erases the ring sector write_page is in.
+*/
+__not_in_flash("blackbox")
+static void ring_erase(){
+    uint32_t offset = BLACKBOX_OFFSET + ((uint32_t)(write_page / PAGES_PER_SECTOR) * FLASH_SECTOR_SIZE);
+    uint32_t interrupts = save_and_disable_interrupts();                                // Lock out XIP while the flash is busy
+    flash_range_erase(offset, FLASH_SECTOR_SIZE);
+    restore_interrupts(interrupts);                                                     // Unlock XIP
+    stat_add(STAT_ERASES_OTHER, 1);
+}
+
+/*
+Programs the oldest queued page into write_page.
+*/
+__not_in_flash("blackbox")
+static void ring_program(const uint8_t* data){
+    uint32_t offset = BLACKBOX_OFFSET + ((uint32_t)write_page * FLASH_PAGE_SIZE);
+    uint32_t interrupts = save_and_disable_interrupts();                                // Lock out XIP while the flash is busy
+    flash_range_program(offset, data, FLASH_PAGE_SIZE);
+    restore_interrupts(interrupts);                                                     // Unlock XIP
+}
+
+/*
+Streams as much of the download as the developer COMPORT will take.
+*/
+static void download_service(){
+    while (download_left){                                                              // Pages left to look at
+        if (!page_at(download_page)){                                                   // Empty or torn, skip it
+            download_page = (download_page + 1) % BLACKBOX_PAGES;
+            download_left--;
+            continue;
+        }
+        uint32_t room = tud_cdc_n_write_available(2);                                   // What USB can take right now
+        if (!room){break;}                                                              // Come back next pass
+        uint32_t chunk = FLASH_PAGE_SIZE - download_offset;
+        if (chunk > room){chunk = room;}
+        tud_cdc_n_write(2, ring_page(download_page) + download_offset, chunk);          // Straight out of XIP
+        download_offset += chunk;
+        if (download_offset == FLASH_PAGE_SIZE){                                        // Page done
+            download_offset = 0;
+            download_page = (download_page + 1) % BLACKBOX_PAGES;
+            download_left--;
+        }
+    }
+    tud_cdc_n_write_flush(2);                                                           // Push it out
+    if (!download_left){                                                                // All sent
+        downloading = false;
+        console_mute(false);                                                            // Developer prints are back
+    }
+}
+
+/*
+Moves the black box along, called from the core 0 loop. Does at most one
+flash operation per call and only when Ostrich has been quiet for
+BLACKBOX_IDLE_US and no ECU frame is in flight (the UART interrupt is off
+while flash is busy). Background polls are paused while that happens.
+*/
+void blackbox_service(uint64_t last_command){
+    if (downloading){download_service(); return;}                                       // Ring must stand still while streaming
+    if (!queue_count || time_us_64() - last_command < BLACKBOX_IDLE_US){                // Nothing to write or tuning software is busy
+        datalog_pause(false);                                                           // Background polls carry on
+        return;
+    }
+    datalog_pause(true);                                                                // Let the ECU link go quiet for us
+    if (datalog_busy()){return;}                                                        // Frame on the wire
+    multicore_lockout_start_blocking();                                                 // Blocks core 1 from XIP operations
+    if (!sector_ready){                                                                 // Entering a sector, erase it first
+        ring_erase();
+        sector_ready = true;
+    } else {
+        uint8_t oldest = (queue_head + BLACKBOX_QUEUE - queue_count) % BLACKBOX_QUEUE;
+        ring_program(queue[oldest]);
+        queue_count--;
+        write_page = (write_page + 1) % BLACKBOX_PAGES;
+        sector_ready = (write_page % PAGES_PER_SECTOR) != 0;                            // Next sector needs an erase
+    }
+    multicore_lockout_end_blocking();                                                   // Lifts block on core 1
+}
+
+/*
+CMD_XD: streams every complete page of the ring, oldest first, to the
+developer COMPORT. A 4 byte page count goes first, then the raw pages
+(decode with testing/blackbox_decode.py). Developer prints are muted
+while the download runs.
+*/
+void blackbox_download(uint8_t* command){
+    if (!DEVELOPER_CONSOLE){return;}                                                    // Perform security check
+    uint32_t count = 0;                                                                 // Complete pages in the ring
+    for (uint16_t index = 0; index < BLACKBOX_PAGES; index++){
+        if (page_at(index)){count++;}
+    }
+    console_mute(true);                                                                 // Nothing else goes on the port now
+    tud_cdc_n_write(2, &count, sizeof(count));                                          // Little endian page count
+    downloading = true;
+    download_page = write_page;                                                         // Oldest page sits right after the newest
+    download_left = BLACKBOX_PAGES;
+    download_offset = 0;
+    download_service();
+}
+
+/*
+CMD_XS: prints the black box state to the developer COMPORT.
+*/
+void post_blackbox(uint8_t* command){
+    if (!DEVELOPER_CONSOLE){return;}                                                    // Perform security check
+    print("Black box frames recorded: ", (int32_t)frames, false);
+    print("Black box next page: ", write_page, false);
+    print("Black box pages queued: ", queue_count, false);
+    print("Black box pages dropped: ", (int32_t)dropped, false);
+}
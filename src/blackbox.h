@@ -0,0 +1,66 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#ifndef BLACKBOX_H
+#define BLACKBOX_H
+#include "pico/stdlib.h"
+#include "hardware/flash.h"
+#include "datalog.h"
+
+/*
+The black box records every complete ECU datalog frame into a flash
+ring (BLACKBOX_OFFSET in flash_memory.h) so drives without a laptop
+still leave a log behind. Frames are packed into 256 byte pages in RAM
+and only written to flash while Ostrich is idle and no ECU frame is in
+flight, so recording never stalls injection or tuning software commands.
+
+Every page starts with a header and a full frame, the frames after it
+only carry the bytes that changed:
+
+    [header][dt][mask][52 bytes][dt][mask][changed bytes]...[0xFF]
+
+dt is milliseconds since the previous frame (0xFFFF = end of page),
+mask has a bit per frame byte that follows.
+*/
+#define BLACKBOX_RECORD         (1)             // Poll and record the ECU when no laptop is connected
+#define BLACKBOX_MAGIC          (0x31584242u)   // "BBX1"
+#define BLACKBOX_PAGES          (BLACKBOX_SECTORS * (FLASH_SECTOR_SIZE / FLASH_PAGE_SIZE))  // Pages in the whole ring
+#define BLACKBOX_MASK_BYTES     ((DATALOG_FRAME_SIZE + 7) / 8)  // 7 bytes of changed byte mask
+#define BLACKBOX_QUEUE          (4u)            // Sealed pages waiting for an idle moment
+#define BLACKBOX_IDLE_US        (50000u)        // Ostrich must be quiet this long before we touch flash
+
+/*
+Structure for the BLACKBOX PAGE HEADER:
+
+    uint32_t magic;
+    uint32_t sequence;
+    uint32_t timestamp;
+    uint32_t hash;
+
+timestamp is the ms since boot of the first frame in the page,
+hash is FNV-1a over the rest of the page.
+*/
+typedef struct {
+    uint32_t magic;
+    uint32_t sequence;
+    uint32_t timestamp;
+    uint32_t hash;
+} blackbox_page_t;
+
+/*
+function abstraction in blackbox.c
+*/
+
+void blackbox_init();
+void blackbox_record(const uint8_t* frame, uint64_t timestamp);
+void blackbox_service(uint64_t last_command);
+void blackbox_download(uint8_t* command);
+void post_blackbox(uint8_t* command);
+
+#endif
@@ -0,0 +1,254 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#include <stdlib.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "tusb.h"
+#include "bulk.h"
+#include "mutexes.h"
+#include "contexts.h"
+#include "tune_shadow.h"
+#include "ostrich.h"
+#include "stats.h"
+
+#if USB_VENDOR_BULK
+
+#if !CFG_TUD_VENDOR
+#error "USB_VENDOR_BULK needs CFG_TUD_VENDOR 1 in tusb_config.h (see descriptors.c)"
+#endif
+
+#define BULK_IDLE       (0u)
+#define BULK_RECEIVE    (1u)                                                            // Image coming in (BULK_WRITE)
+#define BULK_SEND       (2u)                                                            // Image going out (BULK_READ)
+
+static uint8_t state = BULK_IDLE;                                                       // What the interface is doing
+static bulk_header_t request;                                                           // Header that started it
+static uint8_t* stage[2];                                                               // BULK_SEND double buffer, sector n uses stage[n & 1]
+static uint8_t full;                                                                    // Bit per stage buffer holding a sector
+static uint8_t sector_in;                                                               // Next sector into a buffer
+static uint8_t sector_out;                                                              // Next sector out of a buffer
+static uint16_t offset;                                                                 // Bytes of the current sector moved over USB
+static uint8_t* image;                                                                  // BULK_RECEIVE buffer, the shadow only sees a checked image
+static uint32_t received;                                                               // Bytes of the image in it
+static uint32_t hash;                                                                   // FNV-1a of the received image
+static uint32_t* owner;                                                                 // Dummy place holder for mutex owner
+
+/*
+Continues an FNV-1a hash over length bytes.
+*/
+static uint32_t fnv(uint32_t value, const uint8_t* bytes, uint32_t length){
+    for (uint32_t i = 0; i < length; i++){
+        value = (value ^ bytes[i]) * 0x01000193u;                                       // FNV prime
+    }
+    return value;
+}
+
+/*
+FNV-1a over the whole image in the shadow, a sector per mutex hold.
+*/
+static uint32_t image_hash(){
+    uint32_t value = 0x811C9DC5u;                                                       // FNV offset basis
+    for (uint8_t sector = 0; sector < TUNE_SECTORS; sector++){
+        while (1){                                                                      // Loop until we get that mutex
+            if (mutex_try_enter(&context->tune_data.tune_flag, owner)){
+                value = fnv(value, shadow_ptr(&context->shadow, sector * TUNE_SECTOR_SIZE), TUNE_SECTOR_SIZE);  // A sector is contiguous
+                mutex_exit(&context->tune_data.tune_flag);
+                break;
+            }
+        }
+    }
+    return value;
+}
+
+/*
+Sends a reply header.
+*/
+static void reply(uint8_t status, uint32_t length, uint32_t value){
+    bulk_header_t header = {.magic = BULK_MAGIC, .op = request.op, .status = status, .length = length, .hash = value};
+    tud_vendor_write(&header, sizeof(header));
+    tud_vendor_write_flush();
+}
+
+/*
+Releases the buffers and goes back to waiting for a header. A half or
+bad image only ever was in its own buffer, so nothing else to undo.
+*/
+static void finish(){
+    free(stage[0]);                                                                     // free(NULL) is fine
+    free(stage[1]);
+    free(image);
+    stage[0] = stage[1] = image = NULL;
+    state = BULK_IDLE;
+}
+
+/*
+Sets up the buffers for a transfer: the double buffer to send, the
+whole image to receive. Returns false if out of RAM.
+*/
+static bool start(uint8_t next){
+    if (next == BULK_SEND){
+        stage[0] = malloc(TUNE_SECTOR_SIZE);
+        stage[1] = malloc(TUNE_SECTOR_SIZE);
+        if (!stage[0] || !stage[1]){finish(); return false;}
+    } else {
+        image = malloc(TUNE_SIZE);                                                      // W and ZW keep committing the shadow meanwhile
+        if (!image){return false;}
+    }
+    full = 0;
+    sector_in = 0;
+    sector_out = 0;
+    offset = 0;
+    received = 0;
+    hash = 0x811C9DC5u;                                                                 // FNV offset basis
+    state = next;
+    return true;
+}
+
+/*
+Copies the checked image into the shadow, a sector per mutex hold. Every
+sector gets its RAM copy before anything is copied, so running out of
+RAM leaves the shadow as it was. Returns false if it did.
+*/
+static bool install_image(){
+    for (uint8_t sector = 0; sector < TUNE_SECTORS; sector++){
+        bool ready;
+        while (1){                                                                      // Loop until we get that mutex
+            if (mutex_try_enter(&context->tune_data.tune_flag, owner)){
+                ready = (shadow_sector(&context->shadow, sector) != NULL);              // Same content, no copy yet
+                mutex_exit(&context->tune_data.tune_flag);
+                break;
+            }
+        }
+        if (!ready){return false;}
+    }
+    for (uint8_t sector = 0; sector < TUNE_SECTORS; sector++){
+        while (1){                                                                      // Loop until we get that mutex
+            if (mutex_try_enter(&context->tune_data.tune_flag, owner)){
+                shadow_write(&context->shadow, sector * TUNE_SECTOR_SIZE, image + (sector * TUNE_SECTOR_SIZE), TUNE_SECTOR_SIZE);
+                mutex_exit(&context->tune_data.tune_flag);
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+/*
+Ends a BULK_WRITE once the whole image is in its buffer. A good image
+goes into the shadow, is committed and core 1 re-injects it, a bad one
+never touches the shadow.
+*/
+static void receive_done(){
+    uint8_t status = BULK_OK;
+    if (hash != request.hash){status = BULK_BAD_HASH;}
+    else if (!install_image()){status = BULK_NO_RAM;}
+    if (status == BULK_OK){
+        stat_add(STAT_BYTES_UPLOADED, TUNE_SIZE);
+        commit_shadow();                                                                // Same commit as a ZW
+        while (1){                                                                      // Loop until we get that mutex
+            if (mutex_try_enter(&context->tune_data.tune_flag, owner)){
+                context->tune_data.sectors = (1u << TUNE_SECTORS) - 1;                  // Core 1 re-injects the whole image
+                mutex_exit(&context->tune_data.tune_flag);
+                break;
+            }
+        }
+    }
+    reply(status, 0, hash);
+    finish();
+}
+
+/*
+BULK_WRITE: fills the image buffer from USB and hashes it on the way.
+Nothing reaches the shadow before the last byte, so a W or ZW on the
+emulation COMPORT in the middle of a transfer commits only its own edit.
+*/
+static void receive_service(){
+    while (received < TUNE_SIZE && tud_vendor_available()){
+        uint32_t chunk = tud_vendor_read(image + received, TUNE_SIZE - received);
+        hash = fnv(hash, image + received, chunk);
+        received += chunk;
+    }
+    if (received == TUNE_SIZE){receive_done();}
+}
+
+/*
+BULK_READ: loads the next sector from the shadow into the idle buffer
+while the other one goes out in 64 byte packets as fast as USB takes them.
+*/
+static void send_service(){
+    uint8_t in = sector_in & 1;                                                         // Buffer to load next
+    if (sector_in < TUNE_SECTORS && !(full & (1u << in)) && mutex_try_enter(&context->tune_data.tune_flag, owner)){
+        shadow_read(&context->shadow, stage[in], sector_in * TUNE_SECTOR_SIZE, TUNE_SECTOR_SIZE);
+        mutex_exit(&context->tune_data.tune_flag);
+        full |= (1u << in);
+        sector_in++;
+    }
+    uint8_t out = sector_out & 1;                                                       // Buffer on the wire
+    while ((full & (1u << out)) && tud_vendor_write_available() >= BULK_PACKET){        // Whole packets only
+        tud_vendor_write(stage[out] + offset, BULK_PACKET);
+        offset += BULK_PACKET;
+        if (offset < TUNE_SECTOR_SIZE){continue;}
+        full &= ~(1u << out);                                                           // Free for sector + 2
+        stat_add(STAT_BYTES_DOWNLOADED, TUNE_SECTOR_SIZE);
+        offset = 0;
+        out = ++sector_out & 1;
+    }
+    tud_vendor_write_flush();
+    if (sector_out == TUNE_SECTORS){finish();}
+}
+
+/*
+Starts whatever the header asks for.
+*/
+static void dispatch(){
+    if (request.magic != BULK_MAGIC){                                                   // Out of step, throw the rest away
+        uint8_t junk[BULK_PACKET];
+        while (tud_vendor_available()){tud_vendor_read(junk, sizeof(junk));}
+        reply(BULK_BAD_REQUEST, 0, 0);
+        return;
+    }
+    if (request.op == BULK_VERIFY){
+        uint32_t value = image_hash();
+        reply((value == request.hash) ? BULK_OK : BULK_BAD_HASH, 0, value);           // No image follows
+        return;
+    }
+    if (request.op == BULK_READ){
+        if (!start(BULK_SEND)){reply(BULK_NO_RAM, 0, 0); return;}
+        reply(BULK_OK, TUNE_SIZE, image_hash());                                        // Host can check what it gets
+        return;
+    }
+    if (request.op == BULK_WRITE && request.length == TUNE_SIZE){
+        if (!start(BULK_RECEIVE)){reply(BULK_NO_RAM, 0, 0);}
+        return;
+    }
+    reply(BULK_BAD_REQUEST, 0, 0);
+}
+
+/*
+Moves the bulk interface along, called from the core 0 loop while it
+waits for Ostrich commands. Never waits on USB.
+*/
+void bulk_service(){
+    if (!tud_vendor_mounted()){                                                         // Host went away mid transfer
+        if (state != BULK_IDLE){finish();}                                              // Drops a half image with its buffer
+        return;
+    }
+    if (state == BULK_RECEIVE){receive_service(); return;}
+    if (state == BULK_SEND){send_service(); return;}
+    if (tud_vendor_available() < sizeof(request)){return;}                              // No whole header yet
+    tud_vendor_read(&request, sizeof(request));
+    dispatch();
+}
+
+#else
+
+void bulk_service(){}
+
+#endif
@@ -0,0 +1,77 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#ifndef BULK_H
+#define BULK_H
+#include "pico/stdlib.h"
+
+/*
+Optional vendor class bulk interface for whole tune transfers, a fast
+path next to the Ostrich COMPORT (which stays as it is for BMTune).
+Scripts and fleet tools read, write and verify the full 32kb image of
+the bank being emulated with one request each (testing/bulk_bench.py).
+
+Every request and reply starts with a bulk_header_t, image data follows
+in 64 byte packets. A read goes out through two 4kb sector buffers, one
+sector moves out of the shadow while the other is on the wire. A write
+comes into a 32kb buffer of its own.
+
+    BULK_READ     host: header                    device: header + 32kb
+    BULK_WRITE    host: header(hash) + 32kb       device: header(status)
+    BULK_VERIFY   host: header(hash)              device: header(status, hash)
+
+hash is FNV-1a over the whole image. A written image only goes into the
+shadow once the hash checks out, then it is committed and handed to
+core 1. Until then W and ZW on the emulation COMPORT work on the shadow
+as usual and never commit part of a transfer.
+
+Off by default, needs CFG_TUD_VENDOR 1 in tusb_config.h (see descriptors.c).
+*/
+#ifndef USB_VENDOR_BULK
+#define USB_VENDOR_BULK     (0)             // Add the vendor bulk interface to the descriptors
+#endif
+#define BULK_MAGIC          (0xAEu)         // First byte of every header
+#define BULK_PACKET         (64u)           // Full speed bulk packet
+#define BULK_READ           (0x01u)
+#define BULK_WRITE          (0x02u)
+#define BULK_VERIFY         (0x03u)
+#define BULK_OK             (0x00u)
+#define BULK_BAD_REQUEST    (0x01u)         // Unknown op or wrong length
+#define BULK_BAD_HASH       (0x02u)         // Image did not match the hash
+#define BULK_NO_RAM         (0x03u)         // No RAM for the buffers or the shadow
+
+/*
+Structure for the BULK HEADER (12 bytes, little endian):
+
+    uint8_t magic;
+    uint8_t op;
+    uint8_t status;
+    uint8_t reserved;
+    uint32_t length;
+    uint32_t hash;
+
+length is the number of image bytes following the header.
+status is only used in replies.
+*/
+typedef struct {
+    uint8_t magic;
+    uint8_t op;
+    uint8_t status;
+    uint8_t reserved;
+    uint32_t length;
+    uint32_t hash;
+} bulk_header_t;
+
+/*
+function abstraction in bulk.c
+*/
+
+void bulk_service();
+
+#endif
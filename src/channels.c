@@ -0,0 +1,153 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "tusb.h"
+#include "channels.h"
+#include "datalog.h"
+#include "ostrich.h"
+#include "developer_tools.h"
+#include "usb_batch.h"
+
+/*
+Has Value: the channels of the frame our bench ECU
+(testing/data_logging_RP2/lib/abstract.py) answers with that have a known
+conversion, the Honda OBD1 datalog ones (values x100):
+
+    o2      volts = raw * 5 / 256           (narrow band sensor, 0-5V ADC)
+    tps     percent = (raw - 25) / 2.04     (25 closed, 229 wide open)
+    rpm     rpm = 1875000 / raw             (bytes 6-7, crank pulse period)
+    vss     km/h = raw
+
+Coolant and intake temps go through the sensor curve and the remaining
+bytes have no settled conversion yet, they are left out until they do.
+*/
+static const channel_t channel_table[] = {
+    {.name = "o2",  .offset = 2,  .width = 1, .kind = CHANNEL_LINEAR, .scale = 500,       .divisor = 256, .bias = 0},
+    {.name = "tps", .offset = 5,  .width = 1, .kind = CHANNEL_LINEAR, .scale = 10000,     .divisor = 204, .bias = -1225},
+    {.name = "rpm", .offset = 6,  .width = 2, .kind = CHANNEL_PERIOD, .scale = 187500000, .divisor = 1,   .bias = 0},
+    {.name = "vss", .offset = 16, .width = 1, .kind = CHANNEL_LINEAR, .scale = 100,       .divisor = 1,   .bias = 0}
+};
+
+#define CHANNELS    (sizeof(channel_table) / sizeof(channel_table[0]))                  // Rows in the table
+
+_Static_assert(CHANNELS <= CHANNEL_MAX, "channel_table does not fit the summary packet");
+
+static channel_window_t current[CHANNELS];                                              // Window being filled
+static channel_window_t complete[CHANNELS];                                             // Last finished window
+static uint64_t window_start;                                                           // First frame of the current window (us)
+static uint16_t window_frames;                                                          // Frames in the current window
+static uint16_t complete_frames;                                                        // Frames in the last finished window
+static uint16_t complete_ms;                                                            // How long the last finished window was
+static uint32_t last_sequence;                                                          // Newest frame fed in
+
+/*
+Decodes one channel out of a frame, in hundredths of its unit.
+*/
+static int32_t channel_value(const channel_t* channel, const uint8_t* frame){
+    uint32_t raw = frame[channel->offset];                                              // Low byte
+    if (channel->width == 2){raw |= (uint32_t)frame[channel->offset + 1] << 8;}         // High byte
+    if (channel->kind == CHANNEL_PERIOD){                                               // Count between pulses
+        return (raw) ? channel->scale / (int32_t)raw : 0;                               // 0 is no pulses, stopped
+    }
+    return (((int32_t)raw * channel->scale) / channel->divisor) + channel->bias;
+}
+
+/*
+Decodes the channel called name out of a frame into value (hundredths
+of its unit). Returns false if there is no such channel.
+*/
+bool channel_decode(const char* name, const uint8_t* frame, int32_t* value){
+    for (uint8_t i = 0; i < CHANNELS; i++){
+        if (strcmp(channel_table[i].name, name)){continue;}
+        *value = channel_value(&channel_table[i], frame);
+        return true;
+    }
+    return false;
+}
+
+/*
+Finishes the current window and starts the next one at timestamp.
+*/
+static void window_roll(uint64_t timestamp){
+    memcpy(complete, current, sizeof(current));                                         // Keep the finished aggregates
+    complete_frames = window_frames;
+    complete_ms = (uint16_t)((timestamp - window_start) / 1000);
+    window_start = timestamp;
+    window_frames = 0;
+}
+
+/*
+Adds a validated frame to the current window. Called by the datalog
+subscriber (see datalog.c), never sees short or bad frames.
+*/
+void channels_feed(const uint8_t* frame, uint64_t timestamp, uint32_t sequence){
+    if (window_frames && timestamp - window_start >= CHANNEL_WINDOW_MS * 1000){window_roll(timestamp);}
+    if (!window_frames){window_start = timestamp;}                                      // First frame opens the window
+    for (uint8_t i = 0; i < CHANNELS; i++){                                             // Decode every channel
+        int32_t value = channel_value(&channel_table[i], frame);
+        if (!window_frames || value < current[i].min){current[i].min = value;}
+        if (!window_frames || value > current[i].max){current[i].max = value;}
+        current[i].sum = (window_frames) ? current[i].sum + value : value;
+    }
+    window_frames++;
+    last_sequence = sequence;
+}
+
+/*
+Appends a little endian value to a packet.
+*/
+static uint16_t put(uint8_t* packet, uint16_t length, uint32_t value, uint8_t size){
+    for (uint8_t i = 0; i < size; i++){packet[length++] = (uint8_t)(value >> (8 * i));}
+    return length;
+}
+
+/*
+CMD_CA: writes the aggregates of the last finished window to the developer
+COMPORT as one binary packet (layout in channels.h).
+*/
+void channel_summary(uint8_t* command){
+    if (!DEVELOPER_CONSOLE){return;}                                                    // Perform security check
+    uint8_t packet[CHANNEL_PACKET_HEADER + (CHANNEL_MAX * 12) + 1];                     // Largest summary
+    uint16_t length = 0;
+    packet[length++] = 'C';
+    packet[length++] = 'H';
+    packet[length++] = CHANNELS;
+    length = put(packet, length, complete_frames, 2);
+    length = put(packet, length, complete_ms, 2);
+    length = put(packet, length, last_sequence, 4);
+    for (uint8_t i = 0; i < CHANNELS; i++){                                             // min, max, mean per channel
+        int32_t mean = (complete_frames) ? (int32_t)(complete[i].sum / complete_frames) : 0;
+        length = put(packet, length, (uint32_t)complete[i].min, 4);
+        length = put(packet, length, (uint32_t)complete[i].max, 4);
+        length = put(packet, length, (uint32_t)mean, 4);
+    }
+    uint8_t sum = 0;                                                                    // Same sum as the Ostrich protocol
+    for (uint16_t i = 0; i < length; i++){sum += packet[i];}
+    packet[length] = sum;
+    usb_write(2, packet, length + 1);
+}
+
+/*
+CMD_CP: prints the last finished window to the developer COMPORT.
+*/
+void post_channels(uint8_t* command){
+    if (!DEVELOPER_CONSOLE){return;}                                                    // Perform security check
+    char line[96];                                                                      // One printed line
+    print("Channel window frames: ", complete_frames, false);
+    print("Channel window (ms): ", complete_ms, false);
+    for (uint8_t i = 0; i < CHANNELS; i++){                                             // One line per channel (x100)
+        int32_t mean = (complete_frames) ? (int32_t)(complete[i].sum / complete_frames) : 0;
+        snprintf(line, sizeof(line), "  -%s: min %ld max %ld mean %ld",
+                 channel_table[i].name, (long)complete[i].min, (long)complete[i].max, (long)mean);
+        print(line, -1, false);
+    }
+}
@@ -0,0 +1,93 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#ifndef CHANNELS_H
+#define CHANNELS_H
+#include "pico/stdlib.h"
+
+/*
+Decodes ECU datalog frames into channels on the device. Every channel
+is one row of channel_table in channels.c (offset, width, scale, bias)
+and every validated frame updates a running min/max/mean per channel.
+Once a window (CHANNEL_WINDOW_MS) is complete its aggregates are kept
+so monitoring tools can poll one small summary (CMD_CA) instead of
+pulling and decoding every raw frame on the host.
+
+Values are fixed point in hundredths of the channel unit, raw is width
+bytes, little endian:
+
+    CHANNEL_LINEAR      value = ((raw * scale) / divisor) + bias
+    CHANNEL_PERIOD      value = scale / raw     (0 while raw is 0)
+
+CHANNEL_PERIOD is for counts of a timer between two pulses, like the
+RPM bytes (higher count, slower engine).
+
+CMD_CA answers on the developer COMPORT with one binary packet (little endian):
+
+    "CH" | channels u8 | frames u16 | window ms u16 | sequence u32 |
+    channels x (min i32 | max i32 | mean i32) | sum u8
+
+sum is the 8 bit sum of every byte before it (like checksum()).
+*/
+#define CHANNEL_DECODE          (1)             // Feed every validated frame into the decoder
+#define CHANNEL_WINDOW_MS       (1000u)         // Aggregate window length
+#define CHANNEL_MAX             (16u)           // Room in the summary packet
+#define CHANNEL_PACKET_HEADER   (10u)           // "CH", count, frames, window, sequence
+#define CHANNEL_LINEAR          (0u)            // Scaled and shifted count
+#define CHANNEL_PERIOD          (1u)            // Count between pulses, scale / raw
+
+/*
+Structure for a CHANNEL:
+
+    const char* name;
+    uint8_t offset;
+    uint8_t width;
+    uint8_t kind;
+    int32_t scale;
+    int32_t divisor;
+    int32_t bias;
+
+offset is the first frame byte of the channel, width is 1 or 2 bytes,
+kind is CHANNEL_LINEAR or CHANNEL_PERIOD.
+*/
+typedef struct {
+    const char* name;
+    uint8_t offset;
+    uint8_t width;
+    uint8_t kind;
+    int32_t scale;
+    int32_t divisor;
+    int32_t bias;
+} channel_t;
+
+/*
+Structure for a CHANNEL WINDOW (aggregates of one channel):
+
+    int32_t min;
+    int32_t max;
+    int64_t sum;
+
+Frame count and span are kept once for all channels.
+*/
+typedef struct {
+    int32_t min;
+    int32_t max;
+    int64_t sum;
+} channel_window_t;
+
+/*
+function abstraction in channels.c
+*/
+
+void channels_feed(const uint8_t* frame, uint64_t timestamp, uint32_t sequence);
+bool channel_decode(const char* name, const uint8_t* frame, int32_t* value);
+void channel_summary(uint8_t* command);
+void post_channels(uint8_t* command);
+
+#endif
@@ -0,0 +1,72 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#include "pico/stdlib.h"
+#include "contexts.h"
+#include "arenas.h"
+#include "injection.h"
+#include "rom_emulation.h"
+#include "developer_tools.h"
+
+#if ROM_EMULATION && (EMULATION_CONTEXTS > 1)
+#error "ROM_EMULATION serves one ECU, build it with EMULATION_CONTEXTS 1"
+#endif
+#if (EMULATION_CONTEXTS < 1) || (EMULATION_CONTEXTS > 3)
+#error "EMULATION_CONTEXTS must be 1-3, one PIO block each"
+#endif
+#if (EMULATION_CONTEXTS > 1) && !defined(AETHERION_HOST_SIM)
+#error "context_pins has no real pins for contexts 1 and 2 yet (host sim only), route them before building more contexts"
+#endif
+
+/*
+Pin map of every context, see contexts.h before changing it.
+*/
+static const context_pins_t context_pins[3] = {
+    {.pio = 0, .data_pin = 2, .select_pin = ECU_SELECT_PIN},
+    {.pio = 1, .data_pin = 2, .select_pin = ECU_SELECT_PIN},                            // Host sim only, route your own
+    {.pio = 2, .data_pin = 2, .select_pin = ECU_SELECT_PIN}                             // Host sim only, route your own
+};
+
+/*
+Has Value: every emulation context, filled in by contexts_init().
+*/
+emulation_context_t contexts[EMULATION_CONTEXTS];
+
+/*
+Has Value: the context core 0 is serving right now.
+Only core 0 may move it, core 1 walks contexts[] itself.
+*/
+emulation_context_t* context = contexts;
+
+/*
+Holds the persistant user settings: persist and volitile bank of
+context n at [2n] and [2n + 1].
+DO NOT USE AS MUTEX OR STRUCT CALL
+*/
+uint8_t persist_data[(2 * EMULATION_CONTEXTS) + 1] = {0};
+
+/*
+Sets up the pins, COMPORT and payload slice of every context.
+Context 0 keeps interface 0, the others follow the datalog and
+developer COMPORTS (see descriptors.c).
+*/
+void contexts_init(){
+    for (uint8_t i = 0; i < EMULATION_CONTEXTS; i++){
+        contexts[i].pins = context_pins[i];
+        contexts[i].pins.itf = CONTEXT_ITF(i);                                          // CDC interface of its emulation COMPORT
+        contexts[i].payload = payload_arena[i];                                         // Its own 32kb mirror
+    }
+}
+
+/*
+Returns the index of a context in contexts[].
+*/
+uint8_t context_index(const emulation_context_t* target){
+    return (uint8_t)(target - contexts);
+}
@@ -0,0 +1,123 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#ifndef CONTEXTS_H
+#define CONTEXTS_H
+#include "pico/stdlib.h"
+#include "mutexes.h"
+#include "tune_shadow.h"
+#include "developer_tools.h"
+
+/*
+An emulation context is everything one ECU needs: its SRAM pins and
+PIO block, its tune shadow and bank, the tune_data / ostrich_usb /
+bank_number mutexes core 0 and core 1 share for it and its own
+emulation COMPORT. EMULATION_CONTEXTS of them run side by side.
+
+    context 0   the board as built: pio0, D0 on GPIO 2, ECU select on 29,
+                the first COMPORT. The datalog and developer COMPORTS,
+                the vendor bulk interface and ROM emulation belong to it.
+    context n   pio n with the same programs, one more emulation COMPORT
+                after the vendor interface (see descriptors.c)
+
+The injection and snoop programs fill a whole PIO block, so the RP2350
+runs 3 contexts at most. A full SRAM takes 28 GPIOs, more than an
+RP2350B has left after the first one, so a board with more contexts
+routes its own pins: set them in context_pins (contexts.c). The pins
+there for contexts 1 and 2 repeat context 0's and are only good for
+the host sim, a firmware build with more than one context stops with an
+#error until they are set.
+
+Core 1 takes the contexts in turn and does at most one 4kb sector or
+one micro write per context per turn (see injection.c), so a full
+injection on one context never holds up an edit on another.
+Core 0 takes commands from every emulation COMPORT in turn the same
+way, context points at the one being served.
+*/
+#ifndef EMULATION_CONTEXTS
+#define EMULATION_CONTEXTS  (1)             // ECUs served side by side (1-3)
+#endif
+#define CONTEXT_ITF_BASE    (2u + DEVELOPER_CONSOLE)    // CDC interface of context 1, after datalog (and developer)
+#define CONTEXT_ITF(n)      ((n) ? (CONTEXT_ITF_BASE + (n) - 1) : 0u)   // CDC interface of context n's emulation COMPORT
+
+/*
+Structure for the CONTEXT PINS:
+
+    uint8_t pio;
+    uint8_t data_pin;
+    uint8_t select_pin;
+    uint8_t itf;
+
+pio is the PIO block index, data_pin is D0 (A0-A14, A15 and CE/WE/OE
+follow it like injection_program_init() expects), select_pin is the
+ECU's select the snoop watches and itf is the CDC interface of the
+context's emulation COMPORT.
+*/
+typedef struct {
+    uint8_t pio;
+    uint8_t data_pin;
+    uint8_t select_pin;
+    uint8_t itf;
+} context_pins_t;
+
+/*
+Structure for an EMULATION CONTEXT:
+
+    context_pins_t pins;
+    shared_binary_t tune_data;
+    shared_bool_t ostrich_usb;
+    shared_bank_t bank_number;
+    tune_shadow_t shadow;
+    uint8_t persist_bank;
+    uint8_t volitile_bank;
+    bool connected;
+    uint8_t upload_count;
+    uint8_t* payload;
+    uint8_t pending;
+    bool macro;
+    uint64_t macro_start;
+    volatile uint32_t macro_time;
+
+tune_data, ostrich_usb and bank_number work exactly like the single
+ones did (mutexes.h), ostrich_usb.keep_alive is only used on context 0.
+persist_bank, volitile_bank, connected and upload_count are core 0's
+Ostrich session. payload is the context's slice of payload_arena, it
+and everything after it belong to core 1: the sectors still to inject,
+whether they make up a full (macro) injection, when it started and how
+long the last one took (read by core 0).
+*/
+typedef struct {
+    context_pins_t pins;
+    shared_binary_t tune_data;
+    shared_bool_t ostrich_usb;
+    shared_bank_t bank_number;
+    tune_shadow_t shadow;
+    uint8_t persist_bank;
+    uint8_t volitile_bank;
+    bool connected;
+    uint8_t upload_count;
+    uint8_t* payload;
+    uint8_t pending;
+    bool macro;
+    uint64_t macro_start;
+    volatile uint32_t macro_time;
+} emulation_context_t;
+
+extern emulation_context_t contexts[EMULATION_CONTEXTS];
+extern emulation_context_t* context;
+extern uint8_t persist_data[(2 * EMULATION_CONTEXTS) + 1];
+
+/*
+function abstraction in contexts.c
+*/
+
+void contexts_init();
+uint8_t context_index(const emulation_context_t* target);
+
+#endif
@@ -0,0 +1,535 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/uart.h"
+#include "hardware/gpio.h"
+#include "hardware/dma.h"
+#include "hardware/sync.h"
+#include "tusb.h"
+#include "datalog.h"
+#include "ostrich.h"
+#include "developer_tools.h"
+#include "blackbox.h"
+#include "channels.h"
+#include "usb_batch.h"
+#include "stats.h"
+
+static uint16_t __aligned(DATALOG_RING_BYTES) ring[DATALOG_RING_SIZE];                 // UART data register reads (byte and error bits), written by DMA
+static uint rx_channel;                                                                 // DMA channel draining the RX FIFO into the ring
+static uint16_t ring_tail;                                                              // Written by the engine only
+static volatile uint32_t ring_overruns;                                                 // Bytes the RX FIFO dropped because it was full
+static bool rx_armed;                                                                   // Next byte is the first of a frame
+static uint64_t rx_first;                                                               // When the engine saw the first byte of the frame
+static uint64_t rx_last;                                                                // When the engine saw the latest byte
+static uint32_t frame_average;                                                          // Average request to full frame time in us (0 = not measured yet)
+static datalog_transaction_t transaction;                                               // The request in flight (engine only)
+static datalog_transaction_t done[DATALOG_QUEUE];                                       // Finished transactions for core 0
+static volatile uint8_t done_head;                                                      // Written by the engine only
+static volatile uint8_t done_tail;                                                      // Written by core 0 only
+static volatile uint32_t queue_drops;                                                   // Answers lost because core 0 fell behind
+static repeating_timer_t tick;                                                          // Drives the engine when no bytes arrive
+static datalog_cache_t cache;                                                           // Newest validated frame
+static bool prefetch_enabled;                                                           // Poll the ECU in the background
+static uint8_t pending[2];                                                              // Host request waiting behind a prefetch
+static volatile bool pending_busy;                                                      // pending holds a request
+static bool background;                                                                 // Poll while the datalog COMPORT is closed (black box)
+static volatile bool paused;                                                            // No background polls (black box is writing flash)
+static volatile bool demand;                                                            // Some subscriber wants the ECU polled (set by core 0)
+static datalog_stats_t stats = {.round_trip_min = UINT32_MAX};                          // ECU round trip statistics
+static uint64_t window_start;                                                           // Start of the frames/s window
+static uint32_t window_frames;                                                          // Validated frames in the window
+static bool host_ready();
+static void host_deliver(const datalog_cache_t* frame);
+static bool developer_ready();
+static void developer_deliver(const datalog_cache_t* frame);
+static bool blackbox_ready();
+static void blackbox_deliver(const datalog_cache_t* frame);
+static bool channels_ready();
+static void channels_deliver(const datalog_cache_t* frame);
+
+/*
+Has Value: every consumer of the shared frame stream (see datalog.h).
+*/
+static datalog_subscriber_t subscribers[DATALOG_SUBSCRIBERS] = {
+    [DATALOG_SUB_HOST] = {.name = "datalog", .ready = host_ready, .deliver = host_deliver},
+    [DATALOG_SUB_DEVELOPER] = {.name = "developer", .ready = developer_ready, .deliver = developer_deliver},
+    [DATALOG_SUB_BLACKBOX] = {.name = "black box", .ready = blackbox_ready, .deliver = blackbox_deliver},
+    [DATALOG_SUB_CHANNELS] = {.name = "channels", .enabled = CHANNEL_DECODE, .ready = channels_ready, .deliver = channels_deliver}
+};
+
+static void engine_step();
+
+/*
+Returns where the DMA writes the next entry of the ring.
+*/
+static uint16_t ring_head(){
+    uint32_t offset = (uint32_t)dma_channel_hw_addr(rx_channel)->write_addr - (uint32_t)(uintptr_t)ring;
+    return (offset / sizeof(ring[0])) & (DATALOG_RING_SIZE - 1);
+}
+
+/*
+Engine timer: sends requests, starts polls and enforces the deadline
+while the ECU is quiet.
+*/
+static bool datalog_tick(repeating_timer_t* timer){
+    engine_step();
+    return true;                                                                        // Keep repeating
+}
+
+/*
+Initalizes uart0 for the ECU link and starts the DMA channel that empties
+its RX FIFO into the ring, interrupts or not.
+*/
+void datalog_init(){
+    uart_init(DATALOG_UART, DATALOG_BAUD_RATE);                                         // Initalize the UART zero with slow baud rate
+    gpio_set_function(DATALOG_TX_PIN, GPIO_FUNC_UART);                                  // Specify we are using TX pin 0
+    gpio_set_function(DATALOG_RX_PIN, GPIO_FUNC_UART);                                  // Using RX pin 1
+    uart_set_format(DATALOG_UART, 8, 1, UART_PARITY_NONE);                              // Set data bits, stop bits and parity
+    uart_set_fifo_enabled(DATALOG_UART, true);                                          // Enable it! (Datalogging is now available for reading)
+    rx_channel = dma_claim_unused_channel(true);                                        // Keeps draining while a flash erase holds the interrupts off
+    dma_channel_config config = dma_channel_get_default_config(rx_channel);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_16);                        // Byte plus its error bits
+    channel_config_set_read_increment(&config, false);                                  // Always the data register
+    channel_config_set_write_increment(&config, true);
+    channel_config_set_ring(&config, true, DATALOG_RING_BITS);                          // Writes wrap around the ring
+    channel_config_set_dreq(&config, uart_get_dreq(DATALOG_UART, false));               // One transfer per received byte
+    dma_channel_configure(rx_channel, &config, ring, &uart_get_hw(DATALOG_UART)->dr, dma_encode_endless_transfer_count(), true);
+    window_start = time_us_64();                                                        // frames/s counts from here
+    add_repeating_timer_us(-(int64_t)DATALOG_TICK_US, datalog_tick, NULL, &tick);       // Runs on core 0, moves the engine along
+}
+
+/*
+Returns how long to wait for a frame: twice the average frame time
+plus some slack, clamped. Until a frame has been measured the old
+100ms is used.
+*/
+static uint32_t frame_deadline(){
+    if (!frame_average){return DATALOG_TIMEOUT_MAX_US;}                                 // Nothing measured yet
+    uint32_t deadline = (frame_average * 2) + DATALOG_SLACK_US;
+    if (deadline < DATALOG_TIMEOUT_MIN_US){return DATALOG_TIMEOUT_MIN_US;}
+    if (deadline > DATALOG_TIMEOUT_MAX_US){return DATALOG_TIMEOUT_MAX_US;}
+    return deadline;
+}
+
+/*
+Checks the frame in flight: all 52 bytes and (DATALOG_CHECKSUM) the
+last byte is the sum of the others. Counts what was wrong with it.
+*/
+static bool frame_valid(const datalog_transaction_t* finished){
+    if (!finished->count){stats.no_response++; return false;}                           // ECU said nothing
+    if (finished->count != DATALOG_FRAME_SIZE){stats.short_frames++; return false;}     // Cut off at the deadline
+    if (DATALOG_CHECKSUM){
+        uint8_t sum = 0;                                                                // Zero out sum
+        for (uint8_t i = 0; i < DATALOG_FRAME_SIZE - 1; i++){sum += finished->frame[i];}
+        if (sum != finished->frame[DATALOG_FRAME_SIZE - 1]){stats.checksum_failures++; return false;}
+    }
+    return true;
+}
+
+/*
+Adds a finished round trip to the statistics.
+*/
+static void round_trip_stats(const datalog_transaction_t* finished, uint64_t now, bool valid){
+    if (finished->count){                                                               // Something came back
+        uint32_t ms = (uint32_t)((finished->first - finished->start) / 1000);           // Request to first byte
+        uint8_t bucket = 0;                                                             // log2 bucket of the latency
+        while (ms && bucket < DATALOG_BUCKETS - 1){ms >>= 1; bucket++;}
+        stats.latency[bucket]++;
+    }
+    if (valid){                                                                         // Only whole frames count for throughput
+        uint32_t round_trip = (uint32_t)(finished->last - finished->start);             // Request to last byte
+        if (round_trip < stats.round_trip_min){stats.round_trip_min = round_trip;}
+        if (round_trip > stats.round_trip_max){stats.round_trip_max = round_trip;}
+        window_frames++;
+    }
+    if (now - window_start >= 1000000){                                                 // Roll the frames/s window every second
+        stats.frames_per_second = (uint32_t)(((uint64_t)window_frames * 1000000) / (now - window_start));
+        window_start = now;
+        window_frames = 0;
+    }
+}
+
+/*
+The datalog COMPORT pulls: frames only go out when CMD_DR asks (datalog_cached).
+*/
+static bool host_ready(){
+    return false;
+}
+
+/*
+Writes the frame to the datalog COMPORT.
+*/
+static void host_deliver(const datalog_cache_t* frame){
+    usb_write(1, frame->frame, DATALOG_FRAME_SIZE);                                     // Newest frame straight out
+}
+
+/*
+The developer stream goes out while the port is open, has room for a
+whole line and is not busy with a download.
+*/
+static bool developer_ready(){
+    if (!tud_cdc_n_connected(2) || console_muted()){return false;}                      // Nobody listening or binary on the port
+    return tud_cdc_n_write_available(2) >= DATALOG_LINE_SIZE;                           // Never block on USB
+}
+
+/*
+Writes the frame to the developer COMPORT as one line:
+DL <sequence> <ms> <52 bytes of hex>
+*/
+static void developer_deliver(const datalog_cache_t* frame){
+    char line[DATALOG_LINE_SIZE + 16];                                                  // Header + hex + CRLF
+    int length = snprintf(line, sizeof(line), "DL %lu %lu ",
+                          (unsigned long)frame->sequence, (unsigned long)(frame->timestamp / 1000));
+    for (uint8_t i = 0; i < DATALOG_FRAME_SIZE; i++){                                   // Two hex digits per byte
+        length += snprintf(&line[length], sizeof(line) - length, "%02X", frame->frame[i]);
+    }
+    length += snprintf(&line[length], sizeof(line) - length, "\r\n");
+    usb_write(2, line, length);                                                         // Goes out with the next developer batch
+}
+
+/*
+The black box only touches RAM when recording, always ready.
+*/
+static bool blackbox_ready(){
+    return true;
+}
+
+/*
+Hands the frame to the black box recorder.
+*/
+static void blackbox_deliver(const datalog_cache_t* frame){
+    blackbox_record(frame->frame, frame->timestamp);
+}
+
+/*
+The channel decoder only touches RAM, always ready.
+*/
+static bool channels_ready(){
+    return true;
+}
+
+/*
+Hands the frame to the channel decoder.
+*/
+static void channels_deliver(const datalog_cache_t* frame){
+    channels_feed(frame->frame, frame->timestamp, frame->sequence);
+}
+
+/*
+Delivers the newest frame to one subscriber.
+*/
+static void subscriber_deliver(datalog_subscriber_t* subscriber, uint64_t now){
+    subscriber->deliver(&cache);
+    subscriber->pending = false;
+    subscriber->last = now;
+    subscriber->delivered++;
+}
+
+/*
+Marks the newest frame pending for every subscriber. A subscriber that
+had not taken the last one yet just loses it (latest frame wins).
+*/
+static void publish(){
+    for (uint8_t i = 0; i < DATALOG_SUBSCRIBERS; i++){
+        if (!subscribers[i].enabled){continue;}                                         // Not listening
+        if (subscribers[i].pending){subscribers[i].overwritten++;}                      // Never saw the older frame
+        subscribers[i].pending = true;
+    }
+}
+
+/*
+Delivers pending frames to every subscriber that is ready and due.
+*/
+static void dispatch(){
+    uint64_t now = time_us_64();
+    for (uint8_t i = 0; i < DATALOG_SUBSCRIBERS; i++){
+        datalog_subscriber_t* subscriber = &subscribers[i];
+        if (!subscriber->enabled || !subscriber->pending){continue;}                    // Nothing for this one
+        if (now - subscriber->last < subscriber->interval){continue;}                   // Rate limited
+        if (!subscriber->ready()){continue;}                                            // Try again next pass
+        subscriber_deliver(subscriber, now);
+    }
+}
+
+/*
+Returns true while any subscriber wants the ECU polled.
+*/
+static bool poll_wanted(){
+    bool host = tud_cdc_n_connected(1);                                                 // Is the tuning software datalogging
+    if (subscribers[DATALOG_SUB_HOST].enabled && host){return true;}
+    if (subscribers[DATALOG_SUB_DEVELOPER].enabled && tud_cdc_n_connected(2)){return true;}
+    return subscribers[DATALOG_SUB_BLACKBOX].enabled && background && !host;
+}
+
+/*
+Takes a finished transaction from the queue (core 0). Short or bad answers
+to a host request are forwarded as they arrived. Only validated frames
+update the average frame time, get a sequence number, become the newest
+frame and get published to the subscribers.
+*/
+static void datalog_finish(const datalog_transaction_t* finished){
+    uint64_t now = time_us_64();
+    bool frame = finished->expected == DATALOG_FRAME_SIZE;                              // CMD_DR, the others answer one ready byte
+    bool valid = frame && frame_valid(finished);                                        // Whole frame with a good sum
+    if (frame){round_trip_stats(finished, now, valid);}                                 // Ready answers are not round trips
+    if (valid){                                                                         // Good frame, measure it
+        uint32_t elapsed = (uint32_t)(finished->last - finished->start);
+        frame_average = (frame_average) ? ((frame_average * 7) + elapsed) / 8 : elapsed;  // Moving average (1/8 weight)
+        stats.frames++;                                                                 // Sequence number of this frame
+        stat_add(STAT_DATALOG_FRAMES, 1);                                               // Unlike stats, never cleared by CMD_DZ
+        memcpy(cache.frame, finished->frame, DATALOG_FRAME_SIZE);                       // Newest frame for everyone
+        cache.timestamp = finished->last;                                               // When the last byte arrived
+        cache.sequence = stats.frames;
+        cache.valid = true;
+        if (finished->prefetch){cache.prefetched++;}
+        publish();
+    }
+    if (!finished->prefetch){                                                           // Host request, answer it directly
+        usb_write(1, finished->frame, finished->count);                                 // Write the data from the ECU to the buffer
+        if (valid){subscribers[DATALOG_SUB_HOST].pending = false;}                      // The host already has this one
+    }
+}
+
+/*
+Ends the transaction in flight and queues it for core 0 (interrupts only).
+*/
+static void engine_finish(){
+    transaction.first = rx_first;                                                       // Stamps belong to this answer
+    transaction.last = rx_last;
+    transaction.busy = false;
+    uint8_t next = (done_head + 1) % DATALOG_QUEUE;                                     // Where the head goes next
+    if (next == done_tail){queue_drops++; return;}                                      // Core 0 is too far behind
+    done[done_head] = transaction;
+    done_head = next;                                                                   // Publish the answer
+}
+
+/*
+Puts a request on the wire and starts waiting for its frame (interrupts only).
+*/
+static void engine_start(const uint8_t* command, bool prefetch){
+    ring_tail = ring_head();                                                            // Late bytes from an old frame are not ours
+    memcpy(transaction.request, command, 2);
+    transaction.sent = 0;
+    transaction.count = 0;
+    transaction.expected = (((command[0] << 8) | command[1]) == CMD_DR) ? DATALOG_FRAME_SIZE : DATALOG_READY_SIZE;
+    transaction.start = time_us_64();
+    transaction.deadline = frame_deadline();
+    transaction.prefetch = prefetch;
+    transaction.busy = true;
+    rx_armed = true;                                                                    // Stamp the first byte of the answer
+    if (transaction.expected == DATALOG_FRAME_SIZE){stats.requests++;}                  // Frame requests only, like the rest of stats
+}
+
+/*
+Moves the ECU link along, called from the engine timer (or with interrupts
+off). Starts a waiting host request or a poll, feeds the
+request into the TX FIFO, copies received bytes out of the ring and finishes
+the transaction once its answer is in or the deadline passes. Never waits and
+never touches USB, so it keeps going whatever core 0 is busy with.
+*/
+static void engine_step(){
+    if (!transaction.busy && pending_busy){                                             // Host request waited behind a poll
+        pending_busy = false;
+        engine_start(pending, false);
+    }
+    bool room = ((done_head + 2) % DATALOG_QUEUE) != done_tail;                         // Leave a slot for a host answer
+    if (!transaction.busy && !paused && demand && room){                                // Keep the ECU link saturated
+        static const uint8_t poll[2] = {CMD_DR >> 8, CMD_DR & 0xFF};
+        engine_start(poll, true);
+    }
+    uint16_t head = ring_head();                                                        // Everything the DMA has written so far
+    if (!transaction.busy){                                                             // Nobody is waiting on the ECU
+        ring_tail = head;                                                               // Drop unsolicited bytes
+        return;
+    }
+    while (transaction.sent < 2 && uart_is_writable(DATALOG_UART)){                     // Request goes out as the FIFO allows
+        uart_putc_raw(DATALOG_UART, transaction.request[transaction.sent++]);
+    }
+    if (ring_tail != head){                                                             // Stamp new bytes (to the engine step)
+        uint64_t now = time_us_64();
+        if (rx_armed){rx_first = now; rx_armed = false;}                                // First byte of the frame
+        rx_last = now;
+    }
+    while (ring_tail != head && transaction.count < transaction.expected){              // Take what the DMA collected
+        uint16_t entry = ring[ring_tail];
+        if (entry & DATALOG_RX_ERROR_BITS){stat_add(STAT_UART_ERRORS, 1);}              // Framing, parity, break or overrun on that byte
+        if (entry & UART_UARTDR_OE_BITS){ring_overruns++;}                              // The FIFO was full and lost a byte before this one
+        transaction.frame[transaction.count++] = (uint8_t)entry;
+        ring_tail = (ring_tail + 1) & (DATALOG_RING_SIZE - 1);
+    }
+    bool late = time_us_64() - transaction.start >= transaction.deadline;               // ECU is late, send what we have
+    if (transaction.count == transaction.expected || late){                             // Whole answer in, or the ECU is late
+        engine_finish();
+        engine_step();                                                                  // Next request goes out right away
+    }
+}
+
+/*
+Answers CMD_DR from the cache if prefetching and the newest frame is fresh.
+*/
+static bool datalog_cached(const uint8_t* command){
+    if (!prefetch_enabled || !cache.valid){return false;}                               // Nothing to serve
+    if (((command[0] << 8) | command[1]) != CMD_DR){return false;}                      // Only datalog reads are prefetched
+    uint32_t age = (uint32_t)(time_us_64() - cache.timestamp);                          // How old the newest frame is
+    if (age > DATALOG_CACHE_MAX_AGE_US){return false;}                                  // ECU stopped answering, ask it directly
+    subscriber_deliver(&subscribers[DATALOG_SUB_HOST], time_us_64());                   // Newest frame straight out
+    cache.last_age = age;
+    cache.served++;
+    return true;
+}
+
+/*
+Queues a 2 byte request from the datalog COMPORT for the engine.
+A host request still in flight is finished as it is first, a background
+poll in flight is left to finish and the request goes out right after it.
+*/
+void datalog_request(const uint8_t* command){
+    usb_command(1);                                                                     // Round trip starts now
+    if (datalog_cached(command)){return;}                                               // Answered from the prefetch cache
+    uint32_t interrupts = save_and_disable_interrupts();                                // The engine owns the transaction
+    if (transaction.busy && !transaction.prefetch){engine_finish();}                    // Tuning software gave up on the last one
+    memcpy(pending, command, 2);
+    pending_busy = true;
+    engine_step();                                                                      // Get the request on the wire now
+    restore_interrupts(interrupts);
+}
+
+/*
+Core 0 side of the datalog link, called from the main loop and while
+read_bytes() waits. Tells the engine whether anybody wants polls, hands
+finished transactions to the tuning software and the subscribers and
+delivers to rate limited subscribers that are due. Never waits.
+*/
+void datalog_service(){
+    demand = poll_wanted();                                                             // Subscribers come and go with their ports
+    while (done_tail != done_head){                                                     // Everything the engine finished
+        datalog_finish(&done[done_tail]);
+        done_tail = (done_tail + 1) % DATALOG_QUEUE;                                    // Slot is free again
+    }
+    usb_flush(1);                                                                       // Every answer of the batch in one go
+    dispatch();                                                                         // Push the newest frame to whoever is due
+}
+
+/*
+Returns true while a request is waiting on the ECU.
+*/
+bool datalog_busy(){
+    return transaction.busy || pending_busy || (done_tail != done_head);
+}
+
+/*
+Holds off background polls (host requests still go out).
+*/
+void datalog_pause(bool pause){
+    paused = pause;
+}
+
+/*
+Subscribes the black box and polls the ECU for it while the datalog
+COMPORT is closed.
+*/
+void datalog_background(bool enable){
+    background = enable;
+    subscribers[DATALOG_SUB_BLACKBOX].enabled = enable;
+}
+
+/*
+CMD_DP: turns prefetch mode on (command[1] != 0) or off.
+*/
+void datalog_prefetch(uint8_t* command){
+    if (!DEVELOPER_CONSOLE){return;}                                                    // Perform security check
+    prefetch_enabled = (command[1] != 0);
+    subscribers[DATALOG_SUB_HOST].enabled = prefetch_enabled;                           // Host subscribes in prefetch mode
+    cache.valid = false;                                                                // Never serve a frame from before the switch
+    print("Datalog prefetch: ", prefetch_enabled, false);
+}
+
+/*
+CMD_DV: streams frames to the developer COMPORT at most every command[1] * 10ms
+(1 = every frame the ECU gives us), 0 turns the stream off.
+*/
+void datalog_stream(uint8_t* command){
+    if (!DEVELOPER_CONSOLE){return;}                                                    // Perform security check
+    subscribers[DATALOG_SUB_DEVELOPER].enabled = (command[1] != 0);
+    subscribers[DATALOG_SUB_DEVELOPER].interval = (command[1] > 1) ? command[1] * 10000u : 0;
+    print("Developer datalog stream (x10ms): ", command[1], false);
+}
+
+/*
+CMD_DB: records at most one frame every command[1] * 10ms in the black box
+(0 = every frame).
+*/
+void datalog_record_rate(uint8_t* command){
+    if (!DEVELOPER_CONSOLE){return;}                                                    // Perform security check
+    subscribers[DATALOG_SUB_BLACKBOX].interval = command[1] * 10000u;
+    print("Black box record interval (x10ms): ", command[1], false);
+}
+
+/*
+CMD_DL: prints the datalog link state to the developer COMPORT.
+*/
+void post_datalog(uint8_t* command){
+    if (!DEVELOPER_CONSOLE){return;}                                                    // Perform security check
+    print("Datalog prefetch: ", prefetch_enabled, false);
+    print("Frame time average (us): ", (int32_t)frame_average, false);
+    print("Frame deadline (us): ", (int32_t)frame_deadline(), false);
+    print("Frames prefetched: ", (int32_t)cache.prefetched, false);
+    print("Frames served from cache: ", (int32_t)cache.served, false);
+    print("Last served frame age (us): ", (int32_t)cache.last_age, false);
+    if (cache.valid){print("Newest frame age (us): ", (int32_t)(time_us_64() - cache.timestamp), false);}
+    print("RX FIFO overruns: ", (int32_t)ring_overruns, false);
+    print("Queue drops: ", (int32_t)queue_drops, false);
+    print("Requests: ", (int32_t)stats.requests, false);
+    print("Frames validated: ", (int32_t)stats.frames, false);
+    print("Frames per second: ", (int32_t)stats.frames_per_second, false);
+    print("Short frames: ", (int32_t)stats.short_frames, false);
+    print("No response: ", (int32_t)stats.no_response, false);
+    print("Checksum failures: ", (int32_t)stats.checksum_failures, false);
+    if (stats.frames){
+        print("Round trip min (us): ", (int32_t)stats.round_trip_min, false);
+        print("Round trip max (us): ", (int32_t)stats.round_trip_max, false);
+    }
+    char line[96];                                                                      // One printed line
+    print("Subscribers:", -1, false);
+    for (uint8_t i = 0; i < DATALOG_SUBSCRIBERS; i++){                                  // One line per subscriber
+        snprintf(line, sizeof(line), "  -%s: %s every %lums, delivered %lu, overwritten %lu",
+                 subscribers[i].name, (subscribers[i].enabled) ? "on" : "off",
+                 (unsigned long)(subscribers[i].interval / 1000),
+                 (unsigned long)subscribers[i].delivered, (unsigned long)subscribers[i].overwritten);
+        print(line, -1, false);
+    }
+    static const char* labels[DATALOG_BUCKETS] = {
+        "  <1ms: ", "  <2ms: ", "  <4ms: ", "  <8ms: ", "  <16ms: ", "  <32ms: ", "  <64ms: ", "  >=64ms: "
+    };
+    print("First byte latency:", -1, false);
+    for (uint8_t i = 0; i < DATALOG_BUCKETS; i++){                                      // One line per bucket
+        print((char *)labels[i], (int32_t)stats.latency[i], false);
+    }
+}
+
+/*
+CMD_DZ: clears the datalog statistics (sequence numbers keep counting).
+*/
+void reset_datalog(uint8_t* command){
+    if (!DEVELOPER_CONSOLE){return;}                                                    // Perform security check
+    uint32_t interrupts = save_and_disable_interrupts();                                // The engine counts requests
+    uint32_t frames = stats.frames;                                                     // Sequence numbers never go backwards
+    memset(&stats, 0, sizeof(stats));
+    stats.frames = frames;
+    stats.round_trip_min = UINT32_MAX;
+    ring_overruns = 0;
+    queue_drops = 0;
+    restore_interrupts(interrupts);
+    window_start = time_us_64();
+    window_frames = 0;
+    print("Datalog statistics cleared", -1, false);
+}
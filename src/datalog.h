@@ -0,0 +1,212 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#ifndef DATALOG_H
+#define DATALOG_H
+#include "pico/stdlib.h"
+
+/*
+The ECU datalog link on uart0. A DMA channel empties the RX FIFO into
+a ring (each entry is the data register: the byte and its error bits),
+a 1ms repeating timer moves the transaction along: it sends requests,
+starts polls, takes the bytes out of the ring and enforces the frame
+deadline. Finished transactions wait in a small queue until core 0
+picks them up in datalog_service(), which is called from the main loop
+and while read_bytes() waits on the emulation COMPORT.
+
+Flash erases and programs (flash_memory.c) run with interrupts off for
+tens of ms. The DMA keeps draining the 32 byte FIFO meanwhile, so an
+answer that arrives during an erase is never cut short by an overrun
+(at 38400 baud the FIFO alone lasts ~8ms). The timer is stalled as well
+though, so the next request only goes out once the erase is over: every
+sector erase still costs the datalog that much time, uploads lower the
+frame rate by the share of time spent erasing.
+The deadline follows the measured frame time instead of a fixed 100ms.
+A transaction ends as soon as the answer its request expects is in:
+a frame for CMD_DR, the one ready byte for CMD_DS and CMD_DM.
+Frames are validated (length and sum byte) and numbered, only valid
+frames are cached, recorded and measured. Only CMD_DR round trips go
+into the statistics, the ready answers are just forwarded. Short or bad frames are
+still forwarded to the tuning software as they arrived.
+
+One shared polling loop feeds every consumer. Each validated frame is
+published to the subscribers (datalog COMPORT, developer COMPORT stream,
+the black box and the channel decoder), each with its own rate limit. A subscriber that
+is not ready keeps only the newest frame (latest frame wins), so more
+subscribers never means more ECU round trips. The ECU is polled back
+to back while any subscriber wants frames:
+
+    datalog COMPORT     prefetch mode and the port is open, CMD_DR is
+                        answered straight from the newest frame
+    developer COMPORT   stream on (CMD_DV) and the port is open
+    black box           recording (blackbox.h) and no laptop datalogging
+*/
+#define DATALOG_UART            uart0
+#define DATALOG_BAUD_RATE       38400
+#define DATALOG_TX_PIN          0
+#define DATALOG_RX_PIN          1
+#define DATALOG_RING_BITS       (9u)            // log2 of the ring size in bytes, the DMA wraps its writes on it
+#define DATALOG_RING_BYTES      (1u << DATALOG_RING_BITS)
+#define DATALOG_RING_SIZE       (DATALOG_RING_BYTES / 2)    // 16 bit entries, ~66ms of bytes at 38400 baud
+#define DATALOG_RX_ERROR_BITS   (UART_UARTDR_OE_BITS | UART_UARTDR_BE_BITS | UART_UARTDR_PE_BITS | UART_UARTDR_FE_BITS)
+#define DATALOG_FRAME_SIZE      (52u)           // Bytes the ECU answers a datalog request with
+#define DATALOG_READY_SIZE      (1u)            // Bytes the ECU answers CMD_DS and CMD_DM with
+#define DATALOG_TIMEOUT_MIN_US  (5000u)         // Never give up on a frame sooner than this
+#define DATALOG_TIMEOUT_MAX_US  (100000u)       // Old fixed timeout, used until a frame has been measured
+#define DATALOG_SLACK_US        (2000u)         // Added on top of twice the average frame time
+#define DATALOG_CACHE_MAX_AGE_US (100000u)      // Older prefetched frames are not served, ask the ECU instead
+#define DATALOG_CHECKSUM        (1)             // Last frame byte is the 8 bit sum of the others (like checksum())
+#define DATALOG_BUCKETS         (8u)            // First byte latency histogram: <1, <2, <4 ... <64, >=64 ms
+#define DATALOG_SUBSCRIBERS     (4u)            // Consumers of the shared frame stream
+#define DATALOG_SUB_HOST        (0u)            // Datalog COMPORT (pulls with CMD_DR)
+#define DATALOG_SUB_DEVELOPER   (1u)            // Developer COMPORT stream (pushed as text lines)
+#define DATALOG_SUB_BLACKBOX    (2u)            // Black box recorder (pushed)
+#define DATALOG_SUB_CHANNELS    (3u)            // On-device channel decoder (pushed, channels.h)
+#define DATALOG_LINE_SIZE       (128u)          // One developer stream line
+#define DATALOG_QUEUE           (8u)            // Finished transactions waiting for core 0 (~100ms of frames)
+#define DATALOG_TICK_US         (1000u)         // Engine timer period
+
+/*
+Structure for the DATALOG TRANSACTION:
+
+    uint8_t request[2];
+    uint8_t sent;
+    uint8_t count;
+    uint8_t expected;
+    uint8_t frame[DATALOG_FRAME_SIZE];
+    uint64_t start;
+    uint64_t first;
+    uint64_t last;
+    uint32_t deadline;
+    bool busy;
+    bool prefetch;
+
+expected is how many bytes the request is answered with, the transaction
+ends when they are in (or at the deadline). prefetch is set for background polls, their frames only go to the
+subscribers instead of straight out to the datalog COMPORT. first and
+last are when the first and last byte of the answer arrived. The
+transaction in flight belongs to the interrupts, core 0 only sees
+finished copies from the queue.
+*/
+typedef struct {
+    uint8_t request[2];
+    uint8_t sent;
+    uint8_t count;
+    uint8_t expected;
+    uint8_t frame[DATALOG_FRAME_SIZE];
+    uint64_t start;
+    uint64_t first;
+    uint64_t last;
+    uint32_t deadline;
+    bool busy;
+    bool prefetch;
+} datalog_transaction_t;
+
+/*
+Structure for the DATALOG CACHE (newest validated frame):
+
+    uint8_t frame[DATALOG_FRAME_SIZE];
+    uint64_t timestamp;
+    uint32_t sequence;
+    bool valid;
+    uint32_t prefetched;
+    uint32_t served;
+    uint32_t last_age;
+
+timestamp is when the last byte of the frame arrived, sequence is
+the frame's number among validated frames. last_age is how old (us)
+the last frame served from the cache was.
+*/
+typedef struct {
+    uint8_t frame[DATALOG_FRAME_SIZE];
+    uint64_t timestamp;
+    uint32_t sequence;
+    bool valid;
+    uint32_t prefetched;
+    uint32_t served;
+    uint32_t last_age;
+} datalog_cache_t;
+
+/*
+Structure for a DATALOG SUBSCRIBER:
+
+    const char* name;
+    bool enabled;
+    bool pending;
+    uint32_t interval;
+    uint64_t last;
+    uint32_t delivered;
+    uint32_t overwritten;
+    bool (*ready)();
+    void (*deliver)(const datalog_cache_t* frame);
+
+pending means the newest frame has not been delivered yet, a new frame
+arriving while pending counts as overwritten (latest frame wins).
+interval is the shortest time in us between two deliveries.
+*/
+typedef struct {
+    const char* name;
+    bool enabled;
+    bool pending;
+    uint32_t interval;
+    uint64_t last;
+    uint32_t delivered;
+    uint32_t overwritten;
+    bool (*ready)();
+    void (*deliver)(const datalog_cache_t* frame);
+} datalog_subscriber_t;
+
+/*
+Structure for the DATALOG STATISTICS (ECU round trips):
+
+    uint32_t requests;
+    uint32_t frames;
+    uint32_t short_frames;
+    uint32_t no_response;
+    uint32_t checksum_failures;
+    uint32_t frames_per_second;
+    uint32_t round_trip_min;
+    uint32_t round_trip_max;
+    uint32_t latency[DATALOG_BUCKETS];
+
+Only CMD_DR round trips are counted, requests is how many went out.
+frames counts validated frames (it is also the last sequence number),
+short_frames ended at the deadline with some bytes, no_response with
+none. round_trip is request to last byte in us, latency is a histogram
+of request to first byte.
+*/
+typedef struct {
+    uint32_t requests;
+    uint32_t frames;
+    uint32_t short_frames;
+    uint32_t no_response;
+    uint32_t checksum_failures;
+    uint32_t frames_per_second;
+    uint32_t round_trip_min;
+    uint32_t round_trip_max;
+    uint32_t latency[DATALOG_BUCKETS];
+} datalog_stats_t;
+
+/*
+function abstraction in datalog.c
+*/
+
+void datalog_init();
+void datalog_request(const uint8_t* command);
+void datalog_service();
+bool datalog_busy();
+void datalog_pause(bool pause);
+void datalog_background(bool enable);
+void datalog_prefetch(uint8_t* command);
+void datalog_stream(uint8_t* command);
+void datalog_record_rate(uint8_t* command);
+void post_datalog(uint8_t* command);
+void reset_datalog(uint8_t* command);
+
+#endif
@@ -10,6 +10,8 @@
 #include "tusb.h"
 #include "pico/unique_id.h"
 #include "developer_tools.h" // needs ostrich.h for DEVELOPER_CONSOLE variable.
+#include "bulk.h"            // USB_VENDOR_BULK
+#include "contexts.h"        // EMULATION_CONTEXTS
 /*
 Values below can be changed at:
 pico-sdk\sdk\2.1.0\src\rp2_common\pico_stdio_usb\include\pico\stdio_usb.h
@@ -23,6 +25,16 @@ Change the values in this file: pico-sdk\sdk\2.1.0\lib\tinyusb\src\tusb_config.h
     #define CFG_TUD_CDC_TX_BUFSIZE (4096 * 2)
 
 This will give us more than enough stdin buffer for complex ostrich bulk commands.
+Add one to CFG_TUD_CDC for every emulation context after the first (contexts.h).
+
+With USB_VENDOR_BULK (bulk.h, off unless built with -DUSB_VENDOR_BULK=1)
+the vendor interface needs these too:
+
+    #define CFG_TUD_VENDOR 1
+    #define CFG_TUD_VENDOR_RX_BUFSIZE (64 * 8)
+    #define CFG_TUD_VENDOR_TX_BUFSIZE (64 * 8)
+
+8 packets each way keep the bulk pipe full while core 0 is busy.
 */
 
 /*
@@ -227,6 +239,39 @@ USBD_ITF_MAX                (n + 2) ("n" being the current number)
 End Statement.
 */
 
+/*
+The vendor bulk interface (bulk.h) goes after everything else so the
+COMPORT numbering BMTune knows never changes. One interface, two bulk
+endpoints after the last CDC ones.
+*/
+#if USB_VENDOR_BULK
+    #define USBD_ITF_VENDOR         (USBD_ITF_MAX)
+    #define USBD_ITF_TOTAL          (USBD_ITF_MAX + 1)
+    #define USBD_VENDOR_DESC_LEN    (TUD_VENDOR_DESC_LEN)
+    #define USBD_VENDOR_EP_OUT      (0x07)
+    #define USBD_VENDOR_EP_IN       (0x87)
+#else
+    #define USBD_ITF_TOTAL          (USBD_ITF_MAX)
+    #define USBD_VENDOR_DESC_LEN    (0)
+#endif
+
+/*
+Every emulation context after the first (contexts.h) gets one more
+emulation COMPORT, after the vendor interface for the same reason.
+Endpoints carry on after the vendor ones.
+*/
+#define USBD_CONTEXT_CDCS           (EMULATION_CONTEXTS - 1)
+#define USBD_ITF_CDC_4              (USBD_ITF_TOTAL)
+#define USBD_ITF_CDC_5              (USBD_ITF_TOTAL + 2)
+#define USBD_CDC4_EP_CMD            (0x88)
+#define USBD_CDC4_EP_OUT            (0x09)
+#define USBD_CDC4_EP_IN             (0x89)
+#define USBD_CDC5_EP_CMD            (0x8A)
+#define USBD_CDC5_EP_OUT            (0x0B)
+#define USBD_CDC5_EP_IN             (0x8B)
+#define USBD_ITF_ALL                (USBD_ITF_TOTAL + (2 * USBD_CONTEXT_CDCS))
+#define USBD_DESC_TOTAL_LEN         (USBD_DESC_LEN + USBD_VENDOR_DESC_LEN + (USBD_CONTEXT_CDCS * TUD_CDC_DESC_LEN))
+
 /*
 This means that the largest control command (not data packets)
 that the device will handle at once is 64 bytes.
@@ -257,6 +302,17 @@ USBD_STR_CDC_x + 1(HEX) of the previous USBD_STR_CDC_x
     #define USBD_STR_RPI_RESET      (0x07)
 #endif
 
+#if USB_VENDOR_BULK
+    #define USBD_STR_VENDOR         (0x08)
+#endif
+
+#if EMULATION_CONTEXTS > 1
+    #define USBD_STR_CDC_4          (0x09)
+#endif
+#if EMULATION_CONTEXTS > 2
+    #define USBD_STR_CDC_5          (0x0A)
+#endif
+
 // Set up of the device descriptor type array.
 static const tusb_desc_device_t usbd_desc_device = {
     .bLength = sizeof(tusb_desc_device_t),
@@ -284,8 +340,8 @@ If you wish to add or remove a specific COMPORT the TUD_CDC_DESCRIPTOR()
 and it contents need to be added here if you like things the way they are
 leave as is.
 */
-static const uint8_t usbd_desc_cfg[USBD_DESC_LEN] = {
-    TUD_CONFIG_DESCRIPTOR(1, USBD_ITF_MAX, USBD_STR_0, USBD_DESC_LEN,
+static const uint8_t usbd_desc_cfg[USBD_DESC_TOTAL_LEN] = {
+    TUD_CONFIG_DESCRIPTOR(1, USBD_ITF_ALL, USBD_STR_0, USBD_DESC_TOTAL_LEN,
         USBD_CONFIGURATION_DESCRIPTOR_ATTRIBUTE, USBD_MAX_POWER_MA),
 
     TUD_CDC_DESCRIPTOR(USBD_ITF_CDC_1, USBD_STR_CDC_1, USBD_CDC1_EP_CMD,
@@ -302,6 +358,21 @@ static const uint8_t usbd_desc_cfg[USBD_DESC_LEN] = {
 #if PICO_STDIO_USB_ENABLE_RESET_VIA_VENDOR_INTERFACE
     TUD_RPI_RESET_DESCRIPTOR(USBD_ITF_RPI_RESET, USBD_STR_RPI_RESET)
 #endif
+
+#if USB_VENDOR_BULK
+    TUD_VENDOR_DESCRIPTOR(USBD_ITF_VENDOR, USBD_STR_VENDOR, USBD_VENDOR_EP_OUT,
+        USBD_VENDOR_EP_IN, USBD_CDC_IN_OUT_MAX_SIZE),
+#endif
+
+#if EMULATION_CONTEXTS > 1
+    TUD_CDC_DESCRIPTOR(USBD_ITF_CDC_4, USBD_STR_CDC_4, USBD_CDC4_EP_CMD,
+        USBD_CDC_CMD_MAX_SIZE, USBD_CDC4_EP_OUT, USBD_CDC4_EP_IN, USBD_CDC_IN_OUT_MAX_SIZE),
+#endif
+
+#if EMULATION_CONTEXTS > 2
+    TUD_CDC_DESCRIPTOR(USBD_ITF_CDC_5, USBD_STR_CDC_5, USBD_CDC5_EP_CMD,
+        USBD_CDC_CMD_MAX_SIZE, USBD_CDC5_EP_OUT, USBD_CDC5_EP_IN, USBD_CDC_IN_OUT_MAX_SIZE),
+#endif
 };
 
 static char usbd_serial_str[PICO_UNIQUE_BOARD_ID_SIZE_BYTES * 2 + 1];
@@ -318,6 +389,15 @@ static const char *const usbd_desc_str[] = {
 #if PICO_STDIO_USB_ENABLE_RESET_VIA_VENDOR_INTERFACE
     [USBD_STR_RPI_RESET] = "Reset",
 #endif
+#if USB_VENDOR_BULK
+    [USBD_STR_VENDOR] = "Generic BULK",
+#endif
+#if EMULATION_CONTEXTS > 1
+    [USBD_STR_CDC_4] = "Generic RT-PROG 2",
+#endif
+#if EMULATION_CONTEXTS > 2
+    [USBD_STR_CDC_5] = "Generic RT-PROG 3",
+#endif
 };
 //***************************************************************************************************************************************************************************
 //                                                  everything below remains unchanged. (correct me if I am wrong)
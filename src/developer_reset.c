@@ -13,32 +13,37 @@
 #include "hardware/flash.h"
 #include "pico/bootrom.h"
 #include "mutexes.h"
+#include "contexts.h"
 #include "developer_reset.h"
 #include "developer_tools.h"
 
 uint32_t* mutex_holder; // create a 32bit unsigned int for holding mutex owner dummy variable
 // ensure that this is executing from RAM and not XIP on flash memory
 /*
-Obtains the binary in use mutex and holds it until device reset.
+Obtains the binary in use mutex of every context and holds it until device reset.
 This ensures that both cores are locked and non-functioning until reset.
 */
 void close_binary_in_use(){
-    while (1){                                                                          // Sets loop until break.
-        if (!mutex_try_enter(&tune_data.tune_flag, mutex_holder)){                      // Tries to obtain mutex (does not release)
-            break;                                                                      // If mutex is obtained break.
-        }                                                                               // Otherwise: keep trying to get mutex.        
+    for (uint8_t i = 0; i < EMULATION_CONTEXTS; i++){                                   // Every context
+        while (1){                                                                      // Sets loop until break.
+            if (!mutex_try_enter(&contexts[i].tune_data.tune_flag, mutex_holder)){      // Tries to obtain mutex (does not release)
+                break;                                                                  // If mutex is obtained break.
+            }                                                                           // Otherwise: keep trying to get mutex.        
+        }
     }
 }
 
 /*
-Obtains the bool in use mutex and holds it until device reset.
+Obtains the bool in use mutex of every context and holds it until device reset.
 This ensures that both cores are locked and non-functioning until reset.
 */
 void close_bool_in_use(){
-    while (1){                                                                          // Sets loop until break.
-        if (!mutex_try_enter(&ostrich_usb.data_flag, mutex_holder)){                    // Tries to obtain mutex (does not release)
-            break;                                                                      // If mutex is obtained break.
-        }                                                                               // otherwise: keep trying to get mutex.
+    for (uint8_t i = 0; i < EMULATION_CONTEXTS; i++){                                   // Every context
+        while (1){                                                                      // Sets loop until break.
+            if (!mutex_try_enter(&contexts[i].ostrich_usb.data_flag, mutex_holder)){    // Tries to obtain mutex (does not release)
+                break;                                                                  // If mutex is obtained break.
+            }                                                                           // otherwise: keep trying to get mutex.
+        }
     }
 }
 
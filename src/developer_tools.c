@@ -10,8 +10,17 @@
 #include "tusb.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <malloc.h>
 #include "pico/stdlib.h"
 #include "developer_tools.h"
+#include "tune_shadow.h"
+#include "contexts.h"
+#include "usb_batch.h"
+#include "arenas.h"
+#include "injection.h"
+
+static bool muted;                                                                      // Port is busy with binary data
+
 /*
 Developer print function to check data in the developer COMPORT.
 Is unused when DEVELOPER_CONSOLE is false.
@@ -19,36 +28,93 @@ Is unused when DEVELOPER_CONSOLE is false.
 
 void print(char* message, int32_t value, bool hex){
     if (!DEVELOPER_CONSOLE){return;}
+    if (muted){return;}                                                                 // Never mix text into a download
     tud_task();
     char buffer[128];
     if (value == -1 && message != ""){                                                  // For string messages only
         snprintf(buffer, sizeof(buffer), "%s\r\n", message);                            // format printable data together
-        tud_cdc_n_write(2, buffer, strlen(buffer));                                     // Write data for output
-        tud_cdc_n_write_flush(2);                                                       // Flush to tuning software
+        usb_write(2, buffer, strlen(buffer));                                           // Flushed with the next developer batch
         return;
     }
     if (message == "" && value != -1 && hex){                                           // for only hex values
         snprintf(buffer, sizeof(buffer), "0x%X\r\n", value);                            // format printable data together
-        tud_cdc_n_write(2, buffer, strlen(buffer));                                     // Write data for output
-        tud_cdc_n_write_flush(2);                                                       // Flush to tuning software
+        usb_write(2, buffer, strlen(buffer));                                           // Flushed with the next developer batch
         return;
     }
     if (message != "" && value != -1 && hex){                                           // for string and hex value -> "myvalue: 0x01"
         snprintf(buffer, sizeof(buffer), "%s0x%X\r\n", message, value);                 // format printable data together
-        tud_cdc_n_write(2, buffer, strlen(buffer));                                     // Write data for output
-        tud_cdc_n_write_flush(2);                                                       // Flush to tuning software
+        usb_write(2, buffer, strlen(buffer));                                           // Flushed with the next developer batch
         return;
     }
     if (message == "" && value != -1 && !hex){                                          // only for int values
         snprintf(buffer, sizeof(buffer), "%d\r\n", value);                              // format printable data together
-        tud_cdc_n_write(2, buffer, strlen(buffer));                                     // Write data for output
-        tud_cdc_n_write_flush(2);                                                       // Flush to tuning software
+        usb_write(2, buffer, strlen(buffer));                                           // Flushed with the next developer batch
         return;
     }
     if (message != "" && value != -1 && !hex){                                          // only for string and int values (not hex)
         snprintf(buffer, sizeof(buffer), "%s%d\r\n", message, value);                   // format printable data together
-        tud_cdc_n_write(2, buffer, strlen(buffer));                                     // Write data for output
-        tud_cdc_n_write_flush(2);                                                       // Flush to tuning software
+        usb_write(2, buffer, strlen(buffer));                                           // Flushed with the next developer batch
         return;
     }
-}
\ No newline at end of file
+}
+
+/*
+Mutes print() while the developer COMPORT carries binary data (downloads).
+*/
+void console_mute(bool mute){
+    muted = mute;
+}
+
+/*
+Returns true while print() is muted.
+*/
+bool console_muted(){
+    return muted;
+}
+
+/*
+Linker symbols (memmap_default.ld): the heap starts at __end__
+and malloc may grow it up to __StackLimit.
+*/
+extern char __end__;
+extern char __StackLimit;
+
+/*
+Labels a CMD_MM line with the context it is about, only when there is more than one.
+*/
+static char* context_label(char* line, size_t size, uint8_t index, const char* label){
+    if (EMULATION_CONTEXTS > 1){snprintf(line, size, "Context %u: %s", (unsigned)index, label);}
+    else {snprintf(line, size, "%s", label);}
+    return line;
+}
+
+/*
+CMD_MM: prints the RAM layout, heap use, the speed of the last
+full injection of every emulation context and the XIP misses per
+injection job to the developer COMPORT.
+Also printed once when the developer COMPORT first connects after boot.
+mallinfo().arena only ever grows so it is the peak heap use.
+*/
+void post_memory(uint8_t* command){
+    if (!DEVELOPER_CONSOLE){return;}                                                    // Perform security check
+    struct mallinfo heap = mallinfo();                                                  // Ask newlib how the heap looks
+    print("Static RAM (bytes): ", (int32_t)(&__end__ - (char *)SRAM_BASE), false);      // Vectors, data and bss
+    print("Heap size (bytes): ", (int32_t)(&__StackLimit - &__end__), false);           // Everything malloc can ever have
+    print("Heap peak (bytes): ", (int32_t)heap.arena, false);                           // High water mark
+    print("Heap in use (bytes): ", (int32_t)heap.uordblks, false);                      // Allocated right now
+    uint8_t resident = 0;
+    for (uint8_t i = 0; i < EMULATION_CONTEXTS; i++){resident += shadow_resident(&contexts[i].shadow);}
+    print("Shadow sectors in RAM: ", resident, false);                                  // 4kb each, copy on write
+    post_memory_map();                                                                  // Where the arenas and stacks ended up
+    char line[64];                                                                      // Label with the context number
+    for (uint8_t i = 0; i < EMULATION_CONTEXTS; i++){                                   // One pair of lines per context
+        uint32_t injection_us = injection_time(i);                                      // Last full 32kb injection on core 1
+        print(context_label(line, sizeof(line), i, "Last 32kb injection (us): "), (int32_t)injection_us, false);
+        if (injection_us){                                                              // 32kb * 1000000us / 1024
+            print(context_label(line, sizeof(line), i, "Injection rate (kb/s): "), (int32_t)(32000000u / injection_us), false);
+        }
+    }
+    print("Injection code in RAM: ", INJECTION_IN_RAM, false);                          // See injection.h
+    print("XIP misses last injection: ", (int32_t)injection_misses(), false);           // Both cores, during the last core 1 job
+    print("XIP misses worst injection: ", (int32_t)injection_worst_misses(), false);    // Since boot
+}
@@ -18,5 +18,8 @@ Provides abstraction for developer_tools.c
 so that these functions can be called later.
 */
 void print(char* message, int32_t value, bool hex);
+void post_memory(uint8_t* command);
+void console_mute(bool mute);
+bool console_muted();
 
 #endif
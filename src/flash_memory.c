@@ -9,12 +9,263 @@
 */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "pico/stdlib.h"
 #include "hardware/vreg.h"
 #include "hardware/flash.h"
 #include "hardware/sync.h"
 #include "flash_memory.h"
 #include "mutexes.h"
+#include "contexts.h"
+#include "stats.h"
+
+#define JOURNAL_RECORDS (FLASH_SECTOR_SIZE / sizeof(commit_record_t))  // Records per journal sector
+
+static uint8_t active_slot[2][BANK_SECTORS];                                                                            // Slot (0 = A, 1 = B) holding the newest copy of each sector
+static uint32_t bank_sequence[2];                                                                                       // Last commit sequence used per bank
+static uint32_t journal_epoch[2];                                                                                       // Epoch of the live journal per bank
+static uint8_t journal_live[2];                                                                                         // Which of the two journal sectors is live per bank
+static uint16_t journal_next[2];                                                                                        // Next free record in the live journal
+static uint8_t page_buffer[FLASH_PAGE_SIZE];                                                                            // Records are programmed a page at a time from RAM
+
+/*
+Returns the flash offset of a sector in slot A (bank region) or slot B.
+*/
+static uint32_t slot_offset(uint8_t bank, uint8_t sector, uint8_t slot){
+    uint32_t base = (bank) ? BANK_ONE_OFFSET : BANK_ZERO_OFFSET;                                                        // Slot A is the original bank
+    if (slot){base = (bank) ? BANK_ONE_B_OFFSET : BANK_ZERO_B_OFFSET;}                                                  // Slot B is the copy
+    return base + ((uint32_t)sector * FLASH_SECTOR_SIZE);                                                               // Sector inside the slot region
+}
+
+/*
+Returns the flash offset of one of the two journal sectors of a bank.
+*/
+static uint32_t journal_offset(uint8_t bank, uint8_t journal){
+    return COMMIT_JOURNAL_OFFSET + ((uint32_t)((bank * 2) + journal) * FLASH_SECTOR_SIZE);
+}
+
+/*
+Returns the XIP address of a journal record.
+*/
+static const commit_record_t* journal_record(uint8_t bank, uint8_t journal, uint16_t index){
+    return (const commit_record_t *)(XIP_BASE + journal_offset(bank, journal)) + index;
+}
+
+/*
+FNV-1a over a 4kb sector in flash.
+*/
+static uint32_t sector_hash(uint32_t offset){
+    const uint8_t* data = (const uint8_t *)(XIP_BASE + offset);                                                         // Read through XIP
+    uint32_t hash = 0x811C9DC5u;                                                                                        // FNV offset basis
+    for (uint32_t i = 0; i < FLASH_SECTOR_SIZE; i++){
+        hash = (hash ^ data[i]) * 0x01000193u;                                                                          // FNV prime
+    }
+    return hash;
+}
+
+/*
+Returns true if a record slot has never been programmed.
+*/
+static bool record_blank(const commit_record_t* record){
+    const uint32_t* words = (const uint32_t *)record;                                                                   // Check a word at a time
+    for (size_t i = 0; i < sizeof(commit_record_t) / 4; i++){
+        if (words[i] != 0xFFFFFFFFu){return false;}                                                                     // Something was programmed here
+    }
+    return true;
+}
+
+/*
+Programs a record into a journal. Everything else in the page is 0xFF,
+programming 0xFF leaves bytes that are already programmed alone.
+*/
+__not_in_flash("save_to_flash")
+static void program_record(uint8_t bank, uint8_t journal, uint16_t index, const commit_record_t* record){
+    uint32_t offset = journal_offset(bank, journal) + ((uint32_t)index * sizeof(commit_record_t));                      // Record location
+    uint32_t page = offset - (offset % FLASH_PAGE_SIZE);                                                                // Page it lives in
+    memset(page_buffer, 0xFF, FLASH_PAGE_SIZE);                                                                         // Leave the rest of the page alone
+    memcpy(page_buffer + (offset - page), record, sizeof(commit_record_t));                                             // Drop the record in
+    uint32_t interrupts = save_and_disable_interrupts();                                                                // Lock out flash for writing (will lock out XIP)
+    flash_range_program(page, page_buffer, FLASH_PAGE_SIZE);                                                            // Program the page
+    restore_interrupts(interrupts);                                                                                     // Exit lockout of flash data (will unlock XIP)
+}
+
+/*
+Programs only the commit marker of a record that was already programmed.
+*/
+static void seal_record(uint8_t bank, uint8_t journal, uint16_t index){
+    commit_record_t seal;                                                                                               // Everything 0xFF but the marker
+    memset(&seal, 0xFF, sizeof(seal));
+    seal.marker = COMMIT_MARKER;                                                                                        // The commit now exists
+    program_record(bank, journal, index, &seal);
+}
+
+/*
+Erases a journal sector.
+*/
+__not_in_flash("save_to_flash")
+static void erase_journal(uint8_t bank, uint8_t journal){
+    uint32_t interrupts = save_and_disable_interrupts();                                                                // Lock out flash for writing (will lock out XIP)
+    flash_range_erase(journal_offset(bank, journal), FLASH_SECTOR_SIZE);                                                // Erase the whole journal sector
+    restore_interrupts(interrupts);                                                                                     // Exit lockout of flash data (will unlock XIP)
+    stat_add(STAT_ERASES_OTHER, 1);
+}
+
+/*
+Starts a fresh journal in the spare (already erased) journal sector:
+header, a snapshot record for every sector, then the header marker.
+Only once the snapshot is sealed is the old journal erased, so a power
+loss during compaction still leaves one complete journal behind.
+*/
+static void journal_compact(uint8_t bank){
+    uint8_t next = !journal_live[bank];                                                                                 // The spare journal sector
+    commit_record_t record = {
+        .magic = COMMIT_MAGIC,
+        .sector = COMMIT_HEADER,
+        .slot = 0,
+        .reserved = 0xFFFF,
+        .sequence = journal_epoch[bank] + 1,
+        .hash = 0,
+        .marker = 0xFFFFFFFFu,
+        .padding = {0xFFFFFFFFu, 0xFFFFFFFFu, 0xFFFFFFFFu}
+    };
+    program_record(bank, next, 0, &record);                                                                             // Header first, not sealed yet
+    for (uint8_t sector = 0; sector < BANK_SECTORS; sector++){                                                          // Snapshot every sector
+        record.sector = sector;
+        record.slot = active_slot[bank][sector];
+        record.sequence = bank_sequence[bank];
+        record.hash = sector_hash(slot_offset(bank, sector, record.slot));
+        record.marker = COMMIT_MARKER;                                                                                  // Snapshot records are complete on their own
+        program_record(bank, next, 1 + sector, &record);
+    }
+    seal_record(bank, next, 0);                                                                                         // Snapshot complete, this journal is now live
+    erase_journal(bank, journal_live[bank]);                                                                            // Old journal becomes the spare
+    journal_live[bank] = next;
+    journal_epoch[bank]++;
+    journal_next[bank] = 1 + BANK_SECTORS;                                                                              // Append after the snapshot
+}
+
+/*
+Returns true and the epoch if a journal sector starts with a sealed header.
+*/
+static bool journal_sealed(uint8_t bank, uint8_t journal, uint32_t* epoch){
+    const commit_record_t* header = journal_record(bank, journal, 0);                                                   // Header is always record 0
+    if (header->magic != COMMIT_MAGIC || header->sector != COMMIT_HEADER){return false;}
+    if (header->marker != COMMIT_MARKER){return false;}                                                                 // Compaction never finished
+    *epoch = header->sequence;
+    return true;
+}
+
+/*
+Works out which slot holds the newest complete copy of every sector of a bank.
+Must run once at boot before anything reads the banks.
+*/
+static void bank_commits_init(uint8_t bank){
+    uint32_t epoch[2] = {0, 0};                                                                                         // Epoch of each journal
+    bool sealed[2];                                                                                                     // Which journals are usable
+    sealed[0] = journal_sealed(bank, 0, &epoch[0]);
+    sealed[1] = journal_sealed(bank, 1, &epoch[1]);
+    for (uint8_t sector = 0; sector < BANK_SECTORS; sector++){
+        active_slot[bank][sector] = 0;                                                                                  // No record means the original bank region (slot A)
+    }
+    bank_sequence[bank] = 0;
+    if (!sealed[0] && !sealed[1]){                                                                                      // First boot with a journal: everything lives in slot A
+        erase_journal(bank, 0);
+        erase_journal(bank, 1);
+        commit_record_t header = {
+            .magic = COMMIT_MAGIC,
+            .sector = COMMIT_HEADER,
+            .slot = 0,
+            .reserved = 0xFFFF,
+            .sequence = 1,
+            .hash = 0,
+            .marker = COMMIT_MARKER,
+            .padding = {0xFFFFFFFFu, 0xFFFFFFFFu, 0xFFFFFFFFu}
+        };
+        program_record(bank, 0, 0, &header);                                                                            // Empty journal, sealed
+        journal_live[bank] = 0;
+        journal_epoch[bank] = 1;
+        journal_next[bank] = 1;
+        return;
+    }
+    uint8_t live = (sealed[0] && (!sealed[1] || epoch[0] > epoch[1])) ? 0 : 1;                                          // Newest sealed journal wins
+    journal_live[bank] = live;
+    journal_epoch[bank] = epoch[live];
+    journal_next[bank] = JOURNAL_RECORDS;                                                                               // Assume full until a blank record shows up
+    for (uint16_t index = 1; index < JOURNAL_RECORDS; index++){                                                         // Find the end of the journal
+        if (record_blank(journal_record(bank, live, index))){
+            journal_next[bank] = index;
+            break;
+        }
+    }
+    uint8_t found = 0;                                                                                                  // Sectors resolved so far (bit mask)
+    for (uint16_t index = journal_next[bank]; index > 1; index--){                                                      // Newest record first
+        const commit_record_t* record = journal_record(bank, live, index - 1);
+        if (record->magic != COMMIT_MAGIC || record->sector >= BANK_SECTORS){continue;}                                 // Torn or not a sector record
+        if (record->sequence > bank_sequence[bank]){bank_sequence[bank] = record->sequence;}                            // Keep counting from here
+        if (found & (1u << record->sector)){continue;}                                                                  // Already have a newer copy
+        if (record->marker != COMMIT_MARKER || record->slot > 1){continue;}                                             // Commit never finished
+        if (sector_hash(slot_offset(bank, record->sector, record->slot)) != record->hash){continue;}                    // Slot data is not what was committed
+        active_slot[bank][record->sector] = record->slot;                                                               // Newest complete copy
+        found |= (1u << record->sector);
+    }
+    uint8_t spare = !live;                                                                                              // The other journal must be blank for the next compaction
+    for (uint16_t index = 0; index < JOURNAL_RECORDS; index++){
+        if (!record_blank(journal_record(bank, spare, index))){                                                         // Left over from an interrupted compaction
+            erase_journal(bank, spare);
+            break;
+        }
+    }
+}
+
+/*
+Resolves the A/B slots of both banks. Call once at boot.
+*/
+void flash_commits_init(){
+    bank_commits_init(0);                                                                                               // Bank zero
+    bank_commits_init(1);                                                                                               // Bank one
+}
+
+/*
+Returns the XIP address of the newest complete copy of a bank sector.
+*/
+const uint8_t* flash_sector(uint8_t bank, uint8_t sector){
+    return (const uint8_t *)(XIP_BASE + slot_offset(bank, sector, active_slot[bank][sector]));
+}
+
+/*
+Commits one tune sector power-loss safe:
+    1. erase the slot not in use
+    2. program the sector into it
+    3. program a journal record (sequence + hash)
+    4. program the record's commit marker
+Until step 4 completes boot still picks the old slot.
+*/
+__not_in_flash("save_to_flash")
+void save_sector(uint8_t bank, uint8_t sector, const uint8_t* data){
+    uint8_t target = !active_slot[bank][sector];                                                                        // Never touch the copy in use
+    uint32_t offset = slot_offset(bank, sector, target);                                                                // Where the new copy goes
+    if (journal_next[bank] >= JOURNAL_RECORDS){journal_compact(bank);}                                                  // Make room in the journal first
+    uint32_t interrupts = save_and_disable_interrupts();                                                                // Lock out flash for writing (will lock out XIP) (WARNING: Core 1)
+    flash_range_erase(offset, FLASH_SECTOR_SIZE);                                                                       // 1. Erase the spare slot
+    flash_range_program(offset, data, FLASH_SECTOR_SIZE);                                                               // 2. Write the new copy
+    restore_interrupts(interrupts);                                                                                     // Exit lockout of flash data (will unlock XIP)
+    stat_add(STAT_ERASES_SECTOR0 + sector, 1);                                                                          // Wear per tune sector
+    commit_record_t record = {
+        .magic = COMMIT_MAGIC,
+        .sector = sector,
+        .slot = target,
+        .reserved = 0xFFFF,
+        .sequence = bank_sequence[bank] + 1,
+        .hash = sector_hash(offset),
+        .marker = 0xFFFFFFFFu,
+        .padding = {0xFFFFFFFFu, 0xFFFFFFFFu, 0xFFFFFFFFu}
+    };
+    program_record(bank, journal_live[bank], journal_next[bank], &record);                                              // 3. Record the commit
+    seal_record(bank, journal_live[bank], journal_next[bank]);                                                          // 4. Mark it complete
+    journal_next[bank]++;
+    bank_sequence[bank]++;
+    active_slot[bank][sector] = target;                                                                                 // Reads now come from the new copy
+}
 
 /*
 Takes uint16_t start address between (0x0000 - 0x8000)
@@ -22,17 +273,21 @@ Writes to the Flash Memory to store long term data.
 (Probably for a 2 years max or 1000 tunes. "I've never tuned 1000 cars regardless xD")
 Using temp data speeds up writing to flash and injection processes
 cannot erase a page at a time it must be a full sector
+Tune sectors go through the A/B commit above, user presets are written in place.
 */
 __not_in_flash("save_to_flash")
 void save_to_flash(uint16_t start_address, uint8_t* save_data, bool save_tune){
     uint16_t base_address = start_address - (start_address % FLASH_SECTOR_SIZE);                                        // Normalized address to sector start
-    uint32_t location = ((save_tune) ? BANK_ZERO_OFFSET : FLASH_USER_OFFSET);                                           // Location: either bank zero or user presets
-    if (persist_bank){location = ((save_tune) ? BANK_ONE_OFFSET : FLASH_USER_OFFSET);}                                  // Location: either bank one or user presets
-    uint32_t sector_offset = location + (uint32_t)base_address;                                                         // Create a base address on decision
+    if (save_tune){                                                                                                     // Tune sectors are double buffered
+        save_sector(context->persist_bank, base_address / FLASH_SECTOR_SIZE, save_data + base_address);                 // Commit into the spare slot
+        return;
+    }
+    uint32_t sector_offset = FLASH_USER_OFFSET + (uint32_t)base_address;                                                // User presets live in one sector
     uint32_t interrupts = save_and_disable_interrupts();                                                                // Lock out flash for writing (will lock out XIP) (WARNING: Core 1)   
     flash_range_erase(sector_offset, FLASH_SECTOR_SIZE);                                                                // Erase the first sector of 4096 bytes by base address
     flash_range_program(sector_offset, (save_data + base_address), FLASH_SECTOR_SIZE);                                  // Write the first sector of 4096 bytes from temp to flash
     restore_interrupts(interrupts);                                                                                     // Exit lockout of flash data (will unlock XIP)
+    stat_add(STAT_ERASES_OTHER, 1);
 }
 
 /*
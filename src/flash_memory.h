@@ -34,6 +34,86 @@ Therefore: 1MB flash target is okay for now.
     #define FLASH_USER_OFFSET (0x100000u - 0x1000u)
 #endif
 
+// revision ring: starts right after bank one and holds 16 sectors of undo records (see revisions.c)
+#ifndef REVISION_OFFSET  
+    #define REVISION_OFFSET (BANK_ONE_OFFSET + 0x9000u)
+#endif
+
+#ifndef REVISION_SECTORS  
+    #define REVISION_SECTORS (16u)
+#endif
+
+// A/B sector slots: the bank regions above are slot A, these are the slot B copies of each bank.
+#ifndef BANK_ZERO_B_OFFSET  
+    #define BANK_ZERO_B_OFFSET (REVISION_OFFSET + (REVISION_SECTORS * 0x1000u))
+#endif
+
+#ifndef BANK_ONE_B_OFFSET  
+    #define BANK_ONE_B_OFFSET (BANK_ZERO_B_OFFSET + 0x8000u)
+#endif
+
+// commit journals: 2 sectors per bank (ping-pong) recording which slot holds each sector.
+#ifndef COMMIT_JOURNAL_OFFSET  
+    #define COMMIT_JOURNAL_OFFSET (BANK_ONE_B_OFFSET + 0x8000u)
+#endif
+
+// tune archive: compressed tune images (see tune_archive.c), right after the commit journals.
+#ifndef ARCHIVE_OFFSET  
+    #define ARCHIVE_OFFSET (COMMIT_JOURNAL_OFFSET + 0x4000u)
+#endif
+
+#ifndef ARCHIVE_SLOTS  
+    #define ARCHIVE_SLOTS (32u)
+#endif
+
+// black box: flash ring of recorded datalog frames (see blackbox.c), right after the tune archive.
+#ifndef BLACKBOX_OFFSET  
+    #define BLACKBOX_OFFSET (ARCHIVE_OFFSET + (ARCHIVE_SLOTS * 0x4000u))
+#endif
+
+#ifndef BLACKBOX_SECTORS  
+    #define BLACKBOX_SECTORS (256u)
+#endif
+
+#define BANK_SECTORS    (8u)              // 4kb sectors per bank (32kb tune)
+#define COMMIT_MAGIC    (0x54494D43u)     // "CMIT" valid journal record
+#define COMMIT_MARKER   (0x454E4F44u)     // "DONE" programmed last, a commit without it never happened
+#define COMMIT_HEADER   (0xFEu)           // Sector number used by the journal header record
+
+/*
+Structure for a COMMIT JOURNAL record (32 bytes, 128 per journal sector):
+
+    uint32_t magic;
+    uint8_t sector;
+    uint8_t slot;
+    uint16_t reserved;
+    uint32_t sequence;
+    uint32_t hash;
+    uint32_t marker;
+    uint32_t padding[3];
+
+A tune sector commit erases and programs the slot that is NOT in use,
+then programs a record (sequence + hash of the new slot) and finally
+the marker. Boot picks the newest record with a marker and a matching
+hash for every sector, so power loss at any step leaves either the old
+or the new sector. The first record of a journal is a header holding
+the journal epoch in sequence, sealed by its marker once the snapshot
+of every sector has been copied in.
+*/
+typedef struct {
+    uint32_t magic;
+    uint8_t sector;
+    uint8_t slot;
+    uint16_t reserved;
+    uint32_t sequence;
+    uint32_t hash;
+    uint32_t marker;
+    uint32_t padding[3];
+} commit_record_t;
+
+void flash_commits_init();
+const uint8_t* flash_sector(uint8_t bank, uint8_t sector);
+void save_sector(uint8_t bank, uint8_t sector, const uint8_t* data);
 void save_to_flash(uint16_t start_address, uint8_t* save_data, bool save_ostrich);
 uint8_t* flash_bank_zero();
 uint8_t* flash_bank_one();
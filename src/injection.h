@@ -9,6 +9,7 @@
 */
 #ifndef INJECTION_H
 #define INJECTION_H
+#include "pico/stdlib.h"
 
 /*
 Provides abstraction for injection.c
@@ -16,6 +17,53 @@ so that this function can be called later
 such there in main.c when splitting cores off.
 */
 
+
+/*
+INJECTION_IN_RAM places the core 1 hot path (the injection loops, the
+payload builders, the tune_data accessors and the shadow reads they use)
+in SRAM. A flash save flushes the XIP cache, so with the hot path in
+flash core 1 stalls on cache misses every time core 0 commits. Set it
+to 0 to run everything from flash again, e.g. to compare the XIP miss
+counts CMD_MM prints.
+*/
+#define INJECTION_IN_RAM    (1)             // Run the core 1 hot path from SRAM
+
+#if INJECTION_IN_RAM
+#define __injection_func(func_name) __not_in_flash_func(func_name)
+#else
+#define __injection_func(func_name) func_name
+#endif
+
+/*
+INJECTION_SNOOP starts the snoop state machine of injection.pio on
+ECU_SELECT_PIN (the ECU's chip select to the SRAM, low while it reads).
+Core 1 words then only reach the SRAM once the ECU has been off the
+bus for SNOOP_GUARD_NS, and only during the SNOOP_WINDOW_NS after that.
+An ECU that stays off the bus for SNOOP_OFFLINE_NS counts as switched
+off and gets no windows at all, words go straight through. Match the
+three times to the ECU's bus timing: guard + window + one write
+(~50ns) has to fit in the shortest gap between two ECU accesses, and
+offline has to be longer than the longest one.
+With INJECTION_SNOOP 0 every word goes straight through like before.
+*/
+#define INJECTION_SNOOP     (1)             // Only write the SRAM while the ECU is off the bus
+#define ECU_SELECT_PIN      (29u)           // Last free GPIO the PIO can see next to the SRAM pins (also ROM emulation's select)
+#define SNOOP_GUARD_NS      (100u)          // ECU quiet this long before a window opens
+#define SNOOP_WINDOW_NS     (100u)          // Writes may start this long after the guard
+#define SNOOP_OFFLINE_NS    (2000u)         // ECU quiet this long is switched off
+
+/*
+Packs a tune address and data byte into the word the injection state
+machine shifts out: data in bits 0-7, address in bits 8-22 and the
+bank pin in bit 23. Used by both payload builders in injection.c.
+*/
+static inline uint32_t injection_word(uint16_t address, uint8_t data, uint8_t bank){
+    return (((uint32_t)address & 0x7FFF) << 8) | data | (bank ? (1u << 23) : 0);
+}
+
 void inject_memory();
+uint32_t injection_time(uint8_t index);
+uint32_t injection_misses();
+uint32_t injection_worst_misses();
 
 #endif
@@ -0,0 +1,165 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "latency.h"
+#include "developer_tools.h"
+#include "trace.h"
+
+/*
+Structure for a LATENCY STAGE (core 0 only):
+
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+    uint32_t buckets[LATENCY_BUCKETS];
+
+Times are in microseconds. There is one per stage between two stamps
+and one for the whole way (LATENCY_RECEIVED to LATENCY_VISIBLE).
+*/
+typedef struct {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+    uint32_t buckets[LATENCY_BUCKETS];
+} latency_stage_t;
+
+latency_record_t latency_records[LATENCY_SLOTS];                                        // Shared with core 1, see latency.h
+static latency_stage_t stages[LATENCY_STAMPS];                                          // Stages between stamps, then the total
+static uint32_t next_edit;                                                              // Number of the last edit handed out
+static uint32_t finished;                                                               // Edits folded into the stages
+static uint32_t superseded;                                                             // Edits overtaken before core 1 took them
+static uint32_t dropped;                                                                // Slots reused before the edit came back
+
+/*
+Adds one time to a stage.
+*/
+static void fold(latency_stage_t* stage, uint32_t us){
+    uint8_t bucket = 31 - __builtin_clz(us | 1);                                        // Power of 2 the time falls under
+    if (bucket >= LATENCY_BUCKETS){bucket = LATENCY_BUCKETS - 1;}                       // Open ended last bucket
+    if (!stage->count || us < stage->min){stage->min = us;}
+    if (us > stage->max){stage->max = us;}
+    stage->count++;
+    stage->sum += us;
+    stage->buckets[bucket]++;
+}
+
+/*
+Returns the bucket the given percentile of a stage falls in.
+*/
+static uint8_t percentile(const latency_stage_t* stage, uint8_t percent){
+    uint64_t seen = 0;                                                                  // Times in the buckets so far
+    for (uint8_t i = 0; i < LATENCY_BUCKETS; i++){
+        seen += stage->buckets[i];
+        if (seen * 100 >= (uint64_t)stage->count * percent){return i;}
+    }
+    return LATENCY_BUCKETS - 1;
+}
+
+/*
+Writes the bound of a bucket as text, "<" its top or ">=" its bottom for the last one.
+*/
+static void bound(char* text, size_t size, uint8_t bucket){
+    if (bucket == LATENCY_BUCKETS - 1){snprintf(text, size, ">=%lu", 1ul << bucket);}
+    else {snprintf(text, size, "<%lu", 1ul << (bucket + 1));}
+}
+
+/*
+Starts the record of an edit that passed its checks. received is when
+micro_write() started, the payload stamp is now. Returns the edit number.
+*/
+uint32_t latency_begin(uint32_t received, uint8_t context){
+    if (!++next_edit){next_edit = 1;}                                                   // 0 means no edit
+    latency_record_t* record = &latency_records[next_edit % LATENCY_SLOTS];
+    if (record->edit){dropped++;}                                                       // That one never came back from core 1
+    record->done = 0;
+    record->context = context;
+    record->stamps[LATENCY_RECEIVED] = received;
+    record->stamps[LATENCY_PAYLOAD] = time_us_32();
+    record->edit = next_edit;                                                           // Core 1 only sees it after the handoff
+    return next_edit;
+}
+
+/*
+Forgets an edit that never made it to core 1.
+*/
+void latency_cancel(uint32_t edit){
+    latency_record_t* record = &latency_records[edit % LATENCY_SLOTS];
+    if (edit && record->edit == edit){record->edit = 0;}
+}
+
+/*
+Forgets an edit core 1 never took because a newer one of the same context
+replaced it, it is counted and traced instead.
+*/
+void latency_superseded(uint32_t edit){
+    latency_record_t* record = &latency_records[edit % LATENCY_SLOTS];
+    if (!edit || record->edit != edit){return;}
+    superseded++;
+    trace(TRACE_SUPERSEDED, record->context, edit);
+    record->edit = 0;
+}
+
+/*
+Folds every edit core 1 has finished into the stages. Called from the
+core 0 background service, so it never waits.
+*/
+void latency_service(){
+    for (uint8_t i = 0; i < LATENCY_SLOTS; i++){                                        // Every slot
+        latency_record_t* record = &latency_records[i];
+        uint32_t edit = record->edit;
+        if (!edit || record->done != edit){continue;}                                   // Free or still on its way
+        __dmb();                                                                        // Read the stamps after done
+        for (uint8_t stage = 0; stage < LATENCY_VISIBLE; stage++){                      // Time between each stamp and the next
+            fold(&stages[stage], record->stamps[stage + 1] - record->stamps[stage]);
+        }
+        uint32_t total = record->stamps[LATENCY_VISIBLE] - record->stamps[LATENCY_RECEIVED];
+        fold(&stages[LATENCY_VISIBLE], total);                                          // Last one is the whole way
+        trace(TRACE_EDIT, record->context, total);
+        record->edit = 0;                                                               // Free the slot
+        finished++;
+    }
+}
+
+/*
+CMD_EL: prints the edit latency of every stage to the developer COMPORT,
+then clears it if command[1] != 0. p50 and p99 are bucket bounds.
+*/
+void post_latency(uint8_t* command){
+    if (!DEVELOPER_CONSOLE){return;}                                                    // Perform security check
+    static const char* labels[LATENCY_STAMPS] = {
+        "payload read", "flash save", "handoff", "core 1 pickup", "injection", "total"
+    };
+    char line[112];                                                                     // One printed line
+    latency_service();                                                                  // Include whatever just finished
+    print("Edit latency (us), edits: ", (int32_t)finished, false);
+    print("  superseded: ", (int32_t)superseded, false);
+    print("  dropped: ", (int32_t)dropped, false);
+    for (uint8_t i = 0; i < LATENCY_STAMPS; i++){                                       // One line per stage
+        const latency_stage_t* stage = &stages[i];
+        if (!stage->count){continue;}
+        char p50[12], p99[12];
+        bound(p50, sizeof(p50), percentile(stage, 50));
+        bound(p99, sizeof(p99), percentile(stage, 99));
+        snprintf(line, sizeof(line), "  %-14s n %lu min %lu mean %lu p50 %s p99 %s max %lu",
+                 labels[i], (unsigned long)stage->count, (unsigned long)stage->min,
+                 (unsigned long)(stage->sum / stage->count), p50, p99, (unsigned long)stage->max);
+        print(line, -1, false);
+    }
+    if (command[1]){                                                                    // Start over
+        memset(stages, 0, sizeof(stages));
+        finished = 0;
+        superseded = 0;
+        dropped = 0;
+    }
+}
@@ -0,0 +1,114 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#ifndef LATENCY_H
+#define LATENCY_H
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+
+/*
+Edit latency: how long a W takes from arriving to the ECU being able to
+see the bytes. Every W that passes its checks gets an edit number and a
+record, each stage stamps time_us_32() into it on the core that runs it:
+
+    LATENCY_RECEIVED    micro_write() starts                        core 0
+    LATENCY_PAYLOAD     payload and checksum read and checked       core 0
+    LATENCY_SAVED       shadow written and committed to flash       core 0
+    LATENCY_HANDED      micro_update_mutexes() handed it to core 1  core 0
+    LATENCY_PICKED      core 1 took it in get_micro_data()          core 1
+    LATENCY_VISIBLE     PIO FIFO drained                            core 1
+
+Core 0 owns a record until LATENCY_HANDED, core 1 stamps the rest and
+sets done to the edit number last (after a barrier). In ROM_EMULATION
+builds micro_write() writes the bytes into the payload the ECU reads on
+core 0 and finishes the record there (latency_visible()), before the
+flash save, so the stages in between take no time. latency_service()
+folds finished records into a power of 2 histogram per stage, so there
+are no locks and no printing on core 1.
+
+A W that lands while the previous one of the context was not picked up
+yet supersedes it. The superseded edit goes out with a re-injection of
+its sectors instead (see micro_update_mutexes()) and is only counted.
+CMD_EL prints the distributions on the developer COMPORT.
+*/
+#define LATENCY_SLOTS       (8u)            // Edits in flight, only the newest of a context can be pending
+#define LATENCY_BUCKETS     (18u)           // Bucket n holds 2^n to 2^(n+1)-1 us, the last one is open ended
+
+typedef enum {
+    LATENCY_RECEIVED,
+    LATENCY_PAYLOAD,
+    LATENCY_SAVED,
+    LATENCY_HANDED,
+    LATENCY_PICKED,
+    LATENCY_VISIBLE,
+    LATENCY_STAMPS
+} latency_stamp_t;
+
+/*
+Structure for a LATENCY RECORD:
+
+    volatile uint32_t edit;
+    volatile uint32_t done;
+    volatile uint32_t stamps[LATENCY_STAMPS];
+    uint8_t context;
+
+edit is 0 while the slot is free, the slot of an edit is edit % LATENCY_SLOTS.
+*/
+typedef struct {
+    volatile uint32_t edit;
+    volatile uint32_t done;
+    volatile uint32_t stamps[LATENCY_STAMPS];
+    uint8_t context;
+} latency_record_t;
+
+extern latency_record_t latency_records[LATENCY_SLOTS];
+
+/*
+Stamps a stage of an edit, safe on either core. Edit 0 (no edit) and
+edits whose slot was already reused are left alone.
+*/
+static inline void latency_stamp(uint32_t edit, latency_stamp_t stamp){
+    latency_record_t* record = &latency_records[edit % LATENCY_SLOTS];
+    if (!edit || record->edit != edit){return;}
+    record->stamps[stamp] = time_us_32();
+}
+
+/*
+Core 1: the edit is visible to the ECU, hands the record back to core 0.
+*/
+static inline void latency_done(uint32_t edit){
+    latency_record_t* record = &latency_records[edit % LATENCY_SLOTS];
+    if (!edit || record->edit != edit){return;}
+    record->stamps[LATENCY_VISIBLE] = time_us_32();
+    __dmb();                                                                            // Stamps land before done does
+    record->done = edit;
+}
+
+/*
+Core 0, ROM emulation: the edit is in the payload, the ECU reads it from
+now on. Stamps the stages it skipped and hands the record to latency_service().
+*/
+static inline void latency_visible(uint32_t edit){
+    latency_stamp(edit, LATENCY_SAVED);
+    latency_stamp(edit, LATENCY_HANDED);
+    latency_stamp(edit, LATENCY_PICKED);
+    latency_done(edit);
+}
+
+/*
+function abstraction in latency.c
+*/
+
+uint32_t latency_begin(uint32_t received, uint8_t context);
+void latency_cancel(uint32_t edit);
+void latency_superseded(uint32_t edit);
+void latency_service(void);
+void post_latency(uint8_t* command);
+
+#endif
@@ -0,0 +1,186 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#include <stdlib.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "lz.h"
+
+/*
+Hashes the 3 bytes at data into the match table.
+*/
+static uint32_t hash3(const uint8_t* data){
+    uint32_t value = data[0] | (data[1] << 8) | (data[2] << 16);                        // Next 3 bytes as one word
+    return (value * 2654435761u) >> (32 - LZ_HASH_BITS);                                // Knuth multiplicative hash
+}
+
+/*
+Writes length literal bytes as as many literal runs as it takes.
+Returns false if dest runs out of room.
+*/
+static bool put_literals(const uint8_t* literals, uint32_t length, uint8_t* dest, uint32_t* out, uint32_t capacity){
+    while (length){                                                                     // Until every literal is out
+        uint32_t run = (length < LZ_MAX_LITERAL) ? length : LZ_MAX_LITERAL;             // One token holds 128 at most
+        if (*out + 1 + run > capacity){return false;}                                   // Would not fit
+        dest[(*out)++] = run - 1;                                                       // Literal token
+        memcpy(dest + *out, literals, run);                                             // Followed by the bytes
+        *out += run;
+        literals += run;
+        length -= run;
+    }
+    return true;
+}
+
+/*
+Compresses length bytes of source into dest. Greedy, one candidate per hash.
+Returns the compressed size or 0 if it does not fit in capacity (or no RAM).
+*/
+uint32_t lz_compress(const uint8_t* source, uint32_t length, uint8_t* dest, uint32_t capacity){
+    uint32_t* table = calloc(1u << LZ_HASH_BITS, sizeof(uint32_t));                     // Position + 1 of the last time each hash was seen
+    if (!table){return 0;}                                                              // Out of heap
+    uint32_t in = 0;                                                                    // Read position
+    uint32_t out = 0;                                                                   // Write position
+    uint32_t literal = 0;                                                               // Start of the literals not written yet
+    while (in + LZ_MIN_MATCH <= length){                                                // Room for a match left
+        uint32_t hash = hash3(source + in);
+        uint32_t candidate = table[hash];                                               // Where these 3 bytes were last seen
+        table[hash] = in + 1;
+        uint32_t match = 0;                                                             // Length of the match at candidate
+        if (candidate && (in - (candidate - 1)) <= LZ_MAX_OFFSET){                      // Seen and in reach
+            const uint8_t* from = source + candidate - 1;
+            while (match < LZ_MAX_MATCH && in + match < length && from[match] == source[in + match]){
+                match++;                                                                // Overlapping matches are fine (runs)
+            }
+        }
+        if (match < LZ_MIN_MATCH){in++; continue;}                                      // Not worth a token, keep it as a literal
+        if (!put_literals(source + literal, in - literal, dest, &out, capacity)){break;}
+        if (out + 3 > capacity){break;}                                                 // Match token would not fit
+        uint32_t distance = in - (candidate - 1) - 1;                                   // Stored as offset - 1
+        dest[out++] = 0x80 | (match - LZ_MIN_MATCH);                                    // Match token
+        dest[out++] = distance & 0xFF;                                                  // Offset low byte
+        dest[out++] = distance >> 8;                                                    // Offset high byte
+        for (uint32_t i = 1; i < match && in + i + LZ_MIN_MATCH <= length; i++){        // Remember the positions we skip over
+            table[hash3(source + in + i)] = in + i + 1;
+        }
+        in += match;
+        literal = in;
+    }
+    bool fits = (in + LZ_MIN_MATCH > length);                                           // Did the loop finish or run out of room
+    if (fits){fits = put_literals(source + literal, length - literal, dest, &out, capacity);}  // Whatever is left over
+    free(table);                                                                        // Give the table back
+    return (fits) ? out : 0;
+}
+
+/*
+Copies a match of length bytes from distance bytes back. An overlapping
+match repeats the pattern (runs of 0xFF), which is copied in doubling
+chunks: after every copy the pattern repeats far enough for the next one.
+*/
+static void copy_match(uint8_t* dest, uint32_t distance, uint32_t length){
+    const uint8_t* from = dest - distance;
+    uint32_t copied = 0;                                                                // Always a whole number of patterns but the last
+    while (copied < length){
+        uint32_t chunk = distance + copied;                                             // Everything from "from" up to dest + copied
+        if (chunk > length - copied){chunk = length - copied;}
+        memcpy(dest + copied, from, chunk);                                             // Never overlaps: dest + copied is chunk or more past from
+        copied += chunk;
+    }
+}
+
+/*
+Decompresses length bytes of source into dest. Source can be straight from XIP.
+Returns the decompressed size or 0 if the data is corrupt or does not fit.
+*/
+uint32_t lz_decompress(const uint8_t* source, uint32_t length, uint8_t* dest, uint32_t capacity){
+    uint32_t in = 0;                                                                    // Read position
+    uint32_t out = 0;                                                                   // Write position
+    while (in < length){                                                                // Until every token is done
+        uint8_t token = source[in++];
+        if (token < 0x80){                                                              // Literal run
+            uint32_t run = token + 1;
+            if (in + run > length || out + run > capacity){return 0;}                   // Corrupt or too big
+            memcpy(dest + out, source + in, run);
+            in += run;
+            out += run;
+            continue;
+        }
+        if (in + 2 > length){return 0;}                                                 // Offset cut off
+        uint32_t match = (token & 0x7F) + LZ_MIN_MATCH;                                 // Match length
+        uint32_t distance = (source[in] | (source[in + 1] << 8)) + 1;                   // How far back
+        in += 2;
+        if (distance > out || out + match > capacity){return 0;}                        // Points before the start or too big
+        copy_match(dest + out, distance, match);
+        out += match;
+    }
+    return out;
+}
+
+/*
+Starts decompressing length bytes of source (straight from XIP is fine).
+*/
+void lz_stream_init(lz_stream_t* stream, const uint8_t* source, uint32_t length){
+    memset(stream, 0, sizeof(lz_stream_t));
+    stream->source = source;
+    stream->length = length;
+}
+
+/*
+Returns where an output position lives in the sector table.
+*/
+static uint8_t* sector_at(uint8_t* const* sectors, uint32_t sector_size, uint32_t position){
+    return sectors[position / sector_size] + (position % sector_size);
+}
+
+/*
+Decompresses until the sector the stream is in (sectors[out / sector_size])
+is full or the source runs out. Every earlier sector must still hold what
+was decompressed into it. Returns false if the data is corrupt, the caller
+checks out to tell a full sector from a short source.
+*/
+bool lz_decompress_sector(lz_stream_t* stream, uint8_t* const* sectors, uint32_t sector_size){
+    uint32_t end = ((stream->out / sector_size) + 1) * sector_size;                     // This call never writes past here
+    while (stream->out < end){                                                          // Until the sector is full
+        if (!stream->literal && !stream->match){                                        // Next token
+            if (stream->in >= stream->length){return true;}                             // Source done
+            uint8_t token = stream->source[stream->in++];
+            if (token < 0x80){                                                          // Literal run
+                stream->literal = token + 1;
+                if (stream->in + stream->literal > stream->length){return false;}       // Run cut off
+                continue;
+            }
+            if (stream->in + 2 > stream->length){return false;}                         // Offset cut off
+            stream->match = (token & 0x7F) + LZ_MIN_MATCH;                              // Match length
+            stream->distance = (stream->source[stream->in] | (stream->source[stream->in + 1] << 8)) + 1;
+            stream->in += 2;
+            if (stream->distance > stream->out){return false;}                          // Points before the start
+            continue;
+        }
+        uint8_t* dest = sector_at(sectors, sector_size, stream->out);
+        uint32_t run = end - stream->out;                                               // Room left in the sector
+        if (stream->literal){                                                           // Literal bytes come from the source
+            if (stream->literal < run){run = stream->literal;}
+            memcpy(dest, stream->source + stream->in, run);
+            stream->in += run;
+            stream->literal -= run;
+            stream->out += run;
+            continue;
+        }
+        uint32_t from = stream->out - stream->distance;                                 // Match bytes come from earlier output
+        if (stream->match < run){run = stream->match;}
+        if (sector_size - (from % sector_size) < run){run = sector_size - (from % sector_size);}  // Stay inside the source sector
+        if (stream->distance >= run){                                                   // No overlap (maybe another sector), one copy
+            memcpy(dest, sector_at(sectors, sector_size, from), run);
+        } else {
+            copy_match(dest, stream->distance, run);                                    // Overlap stays inside this sector
+        }
+        stream->match -= run;
+        stream->out += run;
+    }
+    return true;
+}
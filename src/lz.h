@@ -0,0 +1,64 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#ifndef LZ_H
+#define LZ_H
+#include "pico/stdlib.h"
+
+/*
+Byte oriented LZ format used for archived tunes. Tunes are mostly 0xFF
+padding and repeated table rows so even a greedy match finder does well,
+and decompression is just memcpy's (testing/aetherion_bench.c times it
+against the raw 32kb copy).
+
+    0xxxxxxx                    literal run: (x + 1) bytes follow (1-128)
+    1xxxxxxx  lo  hi            match: (x + 3) bytes (3-130) copied from
+                                (hi:lo + 1) bytes back in the output
+*/
+#define LZ_MIN_MATCH    (3u)                // Shortest match worth a token
+#define LZ_MAX_MATCH    (0x7Fu + 3u)        // Longest match one token holds
+#define LZ_MAX_LITERAL  (0x80u)             // Longest literal run one token holds
+#define LZ_MAX_OFFSET   (0x10000u)          // Furthest a match can reach back
+#define LZ_HASH_BITS    (12u)               // 4096 entry match table (8kb while compressing)
+
+/*
+Structure for an LZ STREAM (decompression one sector at a time):
+
+    const uint8_t* source;
+    uint32_t length;
+    uint32_t in;
+    uint32_t out;
+    uint32_t literal;
+    uint32_t match;
+    uint32_t distance;
+
+lz_decompress_sector() picks up where the last call stopped, in the middle
+of a token if it has to. Sectors do not need to be contiguous, matches
+reach back into the earlier ones through the sector table.
+*/
+typedef struct {
+    const uint8_t* source;
+    uint32_t length;
+    uint32_t in;                            // Read position
+    uint32_t out;                           // Bytes decompressed so far
+    uint32_t literal;                       // Literal bytes of the current token still to copy
+    uint32_t match;                         // Match bytes of the current token still to copy
+    uint32_t distance;                      // How far back the current match reads
+} lz_stream_t;
+
+/*
+function abstraction in lz.c
+*/
+
+uint32_t lz_compress(const uint8_t* source, uint32_t length, uint8_t* dest, uint32_t capacity);
+uint32_t lz_decompress(const uint8_t* source, uint32_t length, uint8_t* dest, uint32_t capacity);
+void lz_stream_init(lz_stream_t* stream, const uint8_t* source, uint32_t length);
+bool lz_decompress_sector(lz_stream_t* stream, uint8_t* const* sectors, uint32_t sector_size);
+
+#endif
@@ -8,103 +8,33 @@
 *        See LEGAL.TXT in the root directory of this project for more details.
 */
 #include "mutexes.h"
+#include "contexts.h"
 
 /*
-Has Value: tune_data.tune_flag
-
-
-Example:
-
-if (!mutex_try_enter(&tune_data.tune_flag, owner)){
-    memcpy(tune_data.tune_binary, ostrich_temp, 0x8000);
-    mutex_exit(&tune_data.tune_flag);
-}
-*/
-shared_binary_t tune_data = {
-    .amount = 0,    
-    .tune_binary = NULL,
-    .tune_bytes = NULL,
-    .tune_byte_start = 0,
-};
-
-/*
-Example:
-
-if (!mutex_try_enter(&ostrich_usb.data_flag, owner)){
-    connected = ostrich_usb.data_ready;
-    mutex_exit(&ostrich_usb.data_flag);
-}
-*/
-shared_bool_t ostrich_usb = {
-    .data_ready = false,
-    .keep_alive = false
-};
-
-/*
-Has Value: dual.bank_number
-
+The tune_data, ostrich_usb and bank_number mutexes live in every
+emulation context (contexts.h), core 0 reaches the one it is serving
+through context and core 1 through the context it is injecting.
 
 Example:
 
-if (!mutex_try_enter(&bank_number.bank_flag, owner)){
-    bank = bank_number.current_bank;
-    mutex_exit(&bank_number.bank_flag);
+if (!mutex_try_enter(&context->tune_data.tune_flag, owner)){
+    amount = context->tune_data.amount;
+    mutex_exit(&context->tune_data.tune_flag);
 }
 */
-shared_bank_t bank_number = {
-    .current_bank = 0
-};
 
 /*
-Pointer to temporary BIN data.
-Only used in ostrich.c
-
-DO NOT USE AS MUTEX OR STRUCT CALL
-*/
-uint8_t* ostrich_temp = NULL;
-
-uint8_t* flash_temp = NULL;
-
-/*
-Pointer to temporary bytes data.
-Only used in ostrich.c
-
-DO NOT USE AS MUTEX OR STRUCT CALL
-*/
-uint8_t* micro_ostrich_temp = NULL;
-
-/*
-Holds the address to the persistant user settings.
-DO NOT USE AS MUTEX OR STRUCT CALL
-*/
-uint8_t persist_data[3] = {0};
-
-/*
-Holds the address to the volitile bank number.
-DO NOT USE AS MUTEX OR STRUCT CALL
-*/
-uint8_t volitile_bank = 0;
-
-/*
-Holds the address to the persistant bank number.
-DO NOT USE AS MUTEX OR STRUCT CALL
-*/
-uint8_t persist_bank = 0;
-
-/*
-quickly initalizes both available mutex structures
-it is equivalent to calling:
+quickly initalizes the mutex structures of every context
+it is equivalent to calling, for each one:
 
-    mutex_init(&tune_data.tune_flag);
-    mutex_init(&ostrich_connected.bool_in_use);
-    mutex_init(&dual.number_in_use);
-*/
-void mutexes_init(){
     mutex_init(&tune_data.tune_flag);
     mutex_init(&ostrich_usb.data_flag);
     mutex_init(&bank_number.bank_flag);
-}
-
-
-
-
+*/
+void mutexes_init(){
+    for (uint8_t i = 0; i < EMULATION_CONTEXTS; i++){
+        mutex_init(&contexts[i].tune_data.tune_flag);
+        mutex_init(&contexts[i].ostrich_usb.data_flag);
+        mutex_init(&contexts[i].bank_number.bank_flag);
+    }
+}
\ No newline at end of file
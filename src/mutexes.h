@@ -15,15 +15,23 @@
 Structure for the TUNE BINARY mutex:
 
     mutex_t tune_flag;
-    uint8_t* tune_binary;
+    volatile uint16_t tune_byte_start;
+    volatile uint16_t amount;
     volatile uint8_t* tune_bytes;
+    volatile uint8_t sectors;
+    volatile uint32_t edit;
+
+edit is the latency record of the pending micro edit (see latency.h).
+sectors is a bit mask of 4kb tune sectors core 1 has to re-inject.
+tune_flag also guards the tune shadow (tune_shadow.h).
 */
 typedef struct {
     mutex_t tune_flag;
-    volatile uint8_t* tune_binary;
     volatile uint16_t tune_byte_start;
     volatile uint16_t amount;
     volatile uint8_t* tune_bytes;
+    volatile uint8_t sectors;
+    volatile uint32_t edit;
 } shared_binary_t;
 
 /*
@@ -50,19 +58,9 @@ typedef struct {
 } shared_bank_t;
 
 /*
-variable list found in mutexes.c
+One of each per emulation context, see contexts.h
 */
 
-extern shared_binary_t tune_data;
-extern shared_bool_t ostrich_usb;
-extern shared_bank_t bank_number;
-extern uint8_t* ostrich_temp;
-extern uint8_t* flash_temp;
-extern uint8_t* micro_ostrich_temp;
-extern uint8_t persist_data[3];
-extern uint8_t volitile_bank;
-extern uint8_t persist_bank;
-
 /*
 function abstraction in mutexes.c
 */
@@ -45,6 +45,28 @@
 #define CMD_DM   0x5000           // Datalog Read Command: requests datalog array.
 #define CMD_F1   0x2201           // Erase Flash Command: developer erase flash command.
 #define CMD_F2   0x2202           // Rest Device Command: developer reset device command.
+#define CMD_HL   0x2203           // Revision List Command: developer lists the newest tune revisions.
+#define CMD_HU   0x2300           // Revision Undo Command: developer rolls back the newest (byte) revisions.
+#define CMD_AL   0x2204           // Archive List Command: developer lists the archived tunes.
+#define CMD_MM   0x2205           // Memory Command: developer prints the RAM layout and heap use.
+#define CMD_DL   0x2206           // Datalog Status Command: developer prints datalog link statistics and prefetch state.
+#define CMD_XD   0x2207           // Black Box Download Command: developer streams the recorded datalog ring.
+#define CMD_XS   0x2208           // Black Box Status Command: developer prints black box recording state.
+#define CMD_DZ   0x2209           // Datalog Reset Command: developer clears the datalog statistics.
+#define CMD_CA   0x220A           // Channel Summary Command: developer gets the channel aggregates as one binary packet.
+#define CMD_CP   0x220B           // Channel Print Command: developer gets the channel aggregates as text.
+#define CMD_UB   0x220C           // USB Batch Command: developer prints flushes/s, drops and round trips per COMPORT.
+#define CMD_UC   0x2D00           // USB Batching Command: developer turns response batching on (byte != 0) or off.
+#define CMD_TD   0x220E           // Trace Dump Command: developer gets the newest trace records of both cores as binary frames.
+#define CMD_TS   0x2A00           // Trace Stream Command: developer streams the trace rings as binary frames (byte != 0) or stops.
+#define CMD_SN   0x2B00           // Statistics Command: developer gets the statistics snapshot as one binary packet, (byte != 0) resets them after.
+#define CMD_EL   0x2C00           // Edit Latency Command: developer prints the W to SRAM latency of every stage, (byte != 0) clears it after.
+#define CMD_DV   0x2800           // Datalog Stream Command: developer streams frames every (byte) x 10ms, 0 = off.
+#define CMD_DB   0x2900           // Black Box Rate Command: developer records a frame every (byte) x 10ms, 0 = every frame.
+#define CMD_DP   0x2700           // Datalog Prefetch Command: developer turns background ECU polling on (byte != 0) or off.
+#define CMD_AS   0x2400           // Archive Save Command: developer compresses the tune into archive slot (byte).
+#define CMD_AR   0x2500           // Archive Load Command: developer loads archive slot (byte) into the current bank.
+#define CMD_AT   0x2600           // Archive Timing Command: developer times decompression of slot (byte) against memcpy.
 #define CMD_FF   0xFF00           // Vendor ID Command: sends back the vendor identification
 #define CMD_DC   0x0088           // Disconnect Command: send 'O'.
 #define NUL_BY   0x0000           // Null Byte Command: tells loop when to stop parsing struct.
@@ -52,5 +74,11 @@
     Function Declaration
 */
 void ostrich_init();
+uint16_t ostrich_dispatch(uint8_t* command);
+uint8_t checksum(uint8_t* array, size_t amount);
+bool checksum_wrong(uint8_t* array, size_t amount, uint8_t received);
+void save_with_blocking(uint16_t start_address, uint8_t* data, bool is_binary);
+void commit_with_blocking(uint8_t sector, const uint8_t* data);
+void commit_shadow();
 
 #endif
\ No newline at end of file
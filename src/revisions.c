@@ -0,0 +1,244 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+#include "flash_memory.h"
+#include "mutexes.h"
+#include "contexts.h"
+#include "tune_shadow.h"
+#include "revisions.h"
+#include "ostrich.h"
+#include "developer_tools.h"
+#include "stats.h"
+
+#define RING_PAGES  (REVISION_SECTORS * REVISION_PAGES)                                  // Pages in the whole ring
+
+static uint16_t write_page;                                                             // Next free page in the ring
+static uint32_t next_sequence;                                                          // Sequence number of the next record
+static uint8_t page_buffer[FLASH_PAGE_SIZE];                                            // Flash cannot be programmed from XIP, stage here
+static uint32_t* owner;                                                                 // Dummy place holder for mutex owner
+
+/*
+Returns the XIP address of a page in the revision ring.
+*/
+static const uint8_t* ring_page(uint16_t page){
+    return (const uint8_t *)(XIP_BASE + REVISION_OFFSET + ((uint32_t)page * FLASH_PAGE_SIZE));
+}
+
+/*
+Counts the pages stored in a record from its page mask.
+*/
+static uint8_t mask_pages(uint16_t page_mask){
+    uint8_t pages = 0;                                                                  // Zero out count
+    while (page_mask){                                                                  // Until every bit is gone
+        pages += page_mask & 1;                                                         // Count the low bit
+        page_mask >>= 1;                                                                // Move to the next one
+    }
+    return pages;
+}
+
+/*
+FNV-1a over the header (minus the hash itself) and the stored pages.
+Catches records that were cut short by a power loss or eaten by an erase.
+*/
+static uint32_t record_hash(const revision_header_t* header, const uint8_t* pages){
+    uint32_t hash = 0x811C9DC5u;                                                        // FNV offset basis
+    const uint8_t* bytes = (const uint8_t *)header;                                     // Walk the header as bytes
+    for (size_t i = 0; i < offsetof(revision_header_t, hash); i++){                     // Everything but the hash field
+        hash = (hash ^ bytes[i]) * 0x01000193u;                                         // FNV prime
+    }
+    size_t length = (size_t)mask_pages(header->page_mask) * FLASH_PAGE_SIZE;            // Size of the old page data
+    for (size_t i = 0; i < length; i++){                                                // Then every stored byte
+        hash = (hash ^ pages[i]) * 0x01000193u;
+    }
+    return hash;
+}
+
+/*
+Returns the header at a page if it starts a complete record, otherwise NULL.
+*/
+static const revision_header_t* record_at(uint16_t page){
+    const revision_header_t* header = (const revision_header_t *)ring_page(page);       // Headers live at the start of a page
+    if (header->magic != REVISION_MAGIC){return NULL;}                                  // Erased or old page data
+    if (!header->page_mask || header->sector >= TUNE_SECTORS){return NULL;}             // Nonsense
+    if ((uint32_t)page + 1u + mask_pages(header->page_mask) > RING_PAGES){return NULL;} // Records never wrap
+    if (record_hash(header, ring_page(page + 1)) != header->hash){return NULL;}         // Torn or partly erased
+    return header;
+}
+
+/*
+Erases a sector of the ring. The oldest records go with it.
+*/
+__not_in_flash("revisions")
+static void ring_erase(uint16_t sector){
+    uint32_t interrupts = save_and_disable_interrupts();                                // Lock out XIP while the flash is busy
+    flash_range_erase(REVISION_OFFSET + ((uint32_t)sector * FLASH_SECTOR_SIZE), FLASH_SECTOR_SIZE);
+    restore_interrupts(interrupts);                                                     // Unlock XIP
+    stat_add(STAT_ERASES_OTHER, 1);
+}
+
+/*
+Programs one page of the ring from page_buffer.
+*/
+__not_in_flash("revisions")
+static void ring_program(uint16_t page){
+    uint32_t interrupts = save_and_disable_interrupts();                                // Lock out XIP while the flash is busy
+    flash_range_program(REVISION_OFFSET + ((uint32_t)page * FLASH_PAGE_SIZE), page_buffer, FLASH_PAGE_SIZE);
+    restore_interrupts(interrupts);                                                     // Unlock XIP
+}
+
+/*
+Collects the page numbers of the newest records, newest first.
+bank < 0 collects records from both banks. Returns how many were found.
+*/
+static uint16_t newest_records(uint16_t* pages, uint16_t max, int16_t bank){
+    uint16_t found = 0;                                                                 // Nothing yet
+    uint16_t page = 0;                                                                  // Start of the ring
+    while (page < RING_PAGES){                                                          // Walk the whole ring
+        const revision_header_t* header = record_at(page);                              // Is a record here?
+        if (!header){page++; continue;}                                                 // No, try the next page
+        if (bank < 0 || header->bank == bank){                                          // Only the bank we were asked about
+            uint16_t slot = found;                                                      // Insertion sort by sequence, newest first
+            while (slot && ((const revision_header_t *)ring_page(pages[slot - 1]))->sequence < header->sequence){
+                if (slot < max){pages[slot] = pages[slot - 1];}                         // Shuffle older records down
+                slot--;
+            }
+            if (slot < max){pages[slot] = page;}                                        // Keep it if it made the cut
+            if (found < max){found++;}
+        }
+        page += 1 + mask_pages(header->page_mask);                                      // Jump over the record
+    }
+    return found;
+}
+
+/*
+Scans the ring at boot for the newest record and sets up where the next one goes.
+The next record always starts on a fresh sector so a record torn by power loss
+is never programmed over.
+*/
+void revisions_init(){
+    uint32_t newest = 0;                                                                // Highest sequence seen
+    uint16_t end = 0;                                                                   // Page after the newest record
+    uint16_t page = 0;                                                                  // Start of the ring
+    while (page < RING_PAGES){                                                          // Walk the whole ring
+        const revision_header_t* header = record_at(page);                              // Is a record here?
+        if (!header){page++; continue;}                                                 // No, try the next page
+        page += 1 + mask_pages(header->page_mask);                                      // Jump over the record
+        if (header->sequence >= newest){                                                // Newest so far?
+            newest = header->sequence;
+            end = page;
+        }
+    }
+    next_sequence = newest + 1;                                                         // Keep counting from where we left off
+    write_page = ((end + REVISION_PAGES - 1) / REVISION_PAGES) * REVISION_PAGES;        // Round up to the next sector
+    if (write_page >= RING_PAGES){write_page = 0;}                                      // Wrap the ring
+}
+
+/*
+Writes an undo record for the sector containing start_address.
+old_sector is the active copy of the sector in flash, new_sector is what is about
+to be committed (both point at the sector start). Only pages that differ are kept.
+Must be called with core 1 locked out, right before save_to_flash() commits the sector.
+*/
+void revision_record(uint16_t start_address, const uint8_t* old_sector, const uint8_t* new_sector){
+    uint16_t base = start_address - (start_address % FLASH_SECTOR_SIZE);                // Normalized address to sector start
+    uint16_t page_mask = 0;                                                             // Pages the commit changes
+    for (uint8_t i = 0; i < REVISION_PAGES; i++){                                       // Compare page by page
+        uint32_t offset = (uint32_t)i * FLASH_PAGE_SIZE;
+        if (memcmp(old_sector + offset, new_sector + offset, FLASH_PAGE_SIZE)){
+            page_mask |= (1u << i);                                                     // This page changes
+        }
+    }
+    if (!page_mask){return;}                                                            // Nothing changes, nothing to undo
+    uint8_t pages = mask_pages(page_mask);                                              // Old pages we need to keep
+    if ((uint32_t)write_page + 1u + pages > RING_PAGES){write_page = 0;}                // Records never wrap, start over
+    for (uint16_t page = write_page; page < write_page + 1 + pages; page++){            // Every page the record will use
+        if (!(page % REVISION_PAGES)){ring_erase(page / REVISION_PAGES);}               // Erase sectors as we enter them
+    }
+    revision_header_t header = {
+        .magic = REVISION_MAGIC,
+        .sequence = next_sequence,
+        .bank = context->persist_bank,
+        .sector = base / FLASH_SECTOR_SIZE,
+        .page_mask = page_mask,
+        .timestamp = (uint32_t)(time_us_64() / 1000),
+        .hash = 0
+    };
+    uint16_t page = write_page + 1;                                                     // Old pages go after the header
+    for (uint8_t i = 0; i < REVISION_PAGES; i++){
+        if (!(page_mask & (1u << i))){continue;}                                        // Unchanged page, skip
+        memcpy(page_buffer, old_sector + ((uint32_t)i * FLASH_PAGE_SIZE), FLASH_PAGE_SIZE);  // Stage the old page in RAM
+        ring_program(page++);                                                           // Keep it in the ring
+    }
+    header.hash = record_hash(&header, ring_page(write_page + 1));                      // Hash what actually landed in flash
+    memset(page_buffer, 0xFF, FLASH_PAGE_SIZE);                                         // Header page is mostly blank
+    memcpy(page_buffer, &header, sizeof(header));                                       // Header goes last so a half written record is never valid
+    ring_program(write_page);
+    write_page += 1 + pages;                                                            // Move past the record
+    next_sequence++;                                                                    // Count the revision
+}
+
+/*
+CMD_HL: prints the newest revisions of the current bank to the developer COMPORT.
+*/
+void post_revisions(uint8_t* command){
+    if (!DEVELOPER_CONSOLE){return;}                                                    // Perform security check
+    uint16_t pages[REVISION_LIST_MAX];                                                  // Newest records
+    char line[96];                                                                      // One printed line
+    uint16_t found = newest_records(pages, REVISION_LIST_MAX, context->persist_bank);
+    print("Revisions (newest first): ", found, false);
+    for (uint16_t i = 0; i < found; i++){                                               // One line per revision
+        const revision_header_t* header = (const revision_header_t *)ring_page(pages[i]);
+        snprintf(line, sizeof(line), "  -%u: seq %lu sector %u pages %u at %lums",
+                 (unsigned)(i + 1), (unsigned long)header->sequence, (unsigned)header->sector,
+                 (unsigned)mask_pages(header->page_mask), (unsigned long)header->timestamp);
+        print(line, -1, false);
+    }
+}
+
+/*
+CMD_HU: rolls back the newest n revisions of the current bank (n = command[1]).
+The old pages go straight into the tune shadow and core 1 re-injects only the
+sectors that were touched, then the dirty sectors are committed to flash. A rollback
+is itself a commit, so rolling back 1 again undoes the rollback.
+*/
+void rollback_revisions(uint8_t* command){
+    if (!DEVELOPER_CONSOLE){return;}                                                    // Perform security check
+    uint16_t pages[255];                                                                // Newest records
+    uint16_t count = command[1];                                                        // How many revisions to undo
+    if (!count){return;}                                                                // Nothing to do
+    uint16_t found = newest_records(pages, count, context->persist_bank);
+    uint8_t touched = 0;                                                                // Sectors we changed
+    bool restored = true;                                                               // Did the shadow take every page
+    while (1){                                                                          // Loop until we get that mutex
+        if (mutex_try_enter(&context->tune_data.tune_flag, owner)){                     // Obtain a mutex for binary use
+            for (uint16_t i = 0; i < found; i++){                                       // Newest first, back in time
+                const revision_header_t* header = (const revision_header_t *)ring_page(pages[i]);
+                uint16_t old_page = pages[i] + 1;                                       // Old pages follow the header
+                for (uint8_t p = 0; p < REVISION_PAGES; p++){
+                    if (!(header->page_mask & (1u << p))){continue;}                    // Page was not changed by that commit
+                    uint16_t address = (header->sector * TUNE_SECTOR_SIZE) + (p * FLASH_PAGE_SIZE);
+                    restored &= shadow_write(&context->shadow, address, ring_page(old_page++), FLASH_PAGE_SIZE);
+                }
+                touched |= (1u << header->sector);                                      // Remember the sector
+            }
+            context->tune_data.sectors |= touched;                                      // Tell core 1 to re-inject only these sectors
+            mutex_exit(&context->tune_data.tune_flag);                                  // Exit mutex like a moral person
+            break;                                                                      // Definitely break out of loop
+        }
+    }
+    commit_shadow();                                                                    // Records the undo of this rollback too
+    if (!restored){print("Rollback incomplete: out of RAM", -1, false);}
+    print("Rolled back revisions: ", found, false);
+}
@@ -0,0 +1,58 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#ifndef REVISIONS_H
+#define REVISIONS_H
+#include "pico/stdlib.h"
+
+/*
+Every tune sector commit leaves an undo record in the revision ring
+(REVISION_OFFSET in flash_memory.h) before the bank sector is erased.
+A record is one header page followed by the old contents of only the
+256 byte pages that the commit changed, so a single W costs 2-3 pages
+instead of a full sector. The oldest records are erased as the ring
+wraps around.
+
+    [header][old page][old page]...[header][old page]...
+*/
+#define REVISION_MAGIC      (0x31564552u)   // "REV1"
+#define REVISION_PAGES      (16u)           // 256 byte pages per 4kb sector
+#define REVISION_LIST_MAX   (16u)           // How many revisions CMD_HL prints
+
+/*
+Structure for the REVISION HEADER (first page of every record):
+
+    uint32_t magic;
+    uint32_t sequence;
+    uint8_t bank;
+    uint8_t sector;
+    uint16_t page_mask;
+    uint32_t timestamp;
+    uint32_t hash;
+*/
+typedef struct {
+    uint32_t magic;
+    uint32_t sequence;
+    uint8_t bank;
+    uint8_t sector;
+    uint16_t page_mask;
+    uint32_t timestamp;
+    uint32_t hash;
+} revision_header_t;
+
+/*
+function abstraction in revisions.c
+*/
+
+void revisions_init();
+void revision_record(uint16_t start_address, const uint8_t* old_sector, const uint8_t* new_sector);
+void post_revisions(uint8_t* command);
+void rollback_revisions(uint8_t* command);
+
+#endif
@@ -0,0 +1,54 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#include "pico/stdlib.h"
+#include "hardware/pio.h"
+#include "hardware/dma.h"
+#include "hardware/structs/bus_ctrl.h"
+#include "rom_emulation.pio.h"
+#include "rom_emulation.h"
+#include "injection.h"
+#include "arenas.h"
+
+/*
+Starts ROM emulation on core 1, in place of the injection state machines.
+The address channel moves each sampled address from rom_address into the
+read address trigger of the data channel, the data channel moves that one
+byte of payload_arena to rom_data and chains back to the address channel.
+Both get the bus fabric ahead of the cores, the ECU is waiting on them.
+*/
+void rom_emulation_init(){
+    uint address_channel = dma_claim_unused_channel(true);                              // Address in
+    uint data_channel = dma_claim_unused_channel(true);                                 // Byte out
+    bus_ctrl_hw->priority = BUSCTRL_BUS_PRIORITY_DMA_W_BITS | BUSCTRL_BUS_PRIORITY_DMA_R_BITS;  // DMA before the cores on every bus port
+
+    dma_channel_config config = dma_channel_get_default_config(address_channel);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_32);                        // Full bus address
+    channel_config_set_read_increment(&config, false);                                  // Always the RX FIFO
+    channel_config_set_write_increment(&config, false);                                 // Always the trigger register
+    channel_config_set_dreq(&config, pio_get_dreq(ROM_PIO, ROM_ADDRESS_SM, false));     // Go when an address is sampled
+    channel_config_set_high_priority(&config, true);
+    dma_channel_configure(address_channel, &config, &dma_hw->ch[data_channel].al3_read_addr_trig,
+                          &ROM_PIO->rxf[ROM_ADDRESS_SM], 1, false);
+
+    config = dma_channel_get_default_config(data_channel);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_8);                         // One tune byte
+    channel_config_set_read_increment(&config, false);
+    channel_config_set_write_increment(&config, false);
+    channel_config_set_dreq(&config, pio_get_dreq(ROM_PIO, ROM_DATA_SM, true));         // rom_data has room
+    channel_config_set_chain_to(&config, address_channel);                              // Wait for the next address
+    channel_config_set_high_priority(&config, true);
+    dma_channel_configure(data_channel, &config, &ROM_PIO->txf[ROM_DATA_SM], payload_arena[0], 1, false);
+
+    rom_address_program_init(ROM_PIO, ROM_ADDRESS_SM, pio_add_program(ROM_PIO, &rom_address_program), ROM_ADDRESS_PIN, payload_arena[0]);
+    rom_data_program_init(ROM_PIO, ROM_DATA_SM, pio_add_program(ROM_PIO, &rom_data_program), ROM_DATA_PIN);
+    rom_enable_program_init(ROM_PIO, ROM_ENABLE_SM, pio_add_program(ROM_PIO, &rom_enable_program), ECU_SELECT_PIN, ROM_DATA_PIN);
+    dma_channel_start(address_channel);                                                 // Arm it, it waits for the first address
+    pio_enable_sm_mask_in_sync(ROM_PIO, (1u << ROM_ADDRESS_SM) | (1u << ROM_DATA_SM) | (1u << ROM_ENABLE_SM));
+}
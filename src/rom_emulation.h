@@ -0,0 +1,47 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#ifndef ROM_EMULATION_H
+#define ROM_EMULATION_H
+#include "pico/stdlib.h"
+
+/*
+Direct ROM emulation, the alternative to injecting an external nvSRAM.
+The board sits in the ECU's ROM socket instead: the ECU's A0-A14 come in
+on ROM_ADDRESS_PIN and up, D0-D7 go out on ROM_DATA_PIN and up and its
+chip select (/CE and /OE tied together) comes in on ECU_SELECT_PIN.
+The state machines in rom_emulation.pio and two DMA channels answer every
+read straight from payload_arena. Core 1 fills it from the tune shadow
+at power on and for full injections and rollbacks, like it fills the SRAM
+in injection mode. A W is written into payload_arena by micro_write() on
+core 0 in the same mutex hold as the shadow, so it is on the ECU's data
+bus the moment it lands in RAM, before the flash save, without a handoff
+to core 1 and without PIO writes.
+
+The response time (address in to data out) has to fit in the ECU's read
+access window at the system clock, the host sim models it per read
+(AETHERION_ECU_DUTY, sim/sim_bus.c). Build with -DROM_EMULATION=1.
+*/
+#ifndef ROM_EMULATION
+#define ROM_EMULATION       (0)             // Answer ECU reads from RAM instead of injecting the SRAM
+#endif
+#define ROM_PIO             pio1            // pio0 belongs to injection.pio
+#define ROM_ADDRESS_SM      (0u)
+#define ROM_DATA_SM         (1u)
+#define ROM_ENABLE_SM       (2u)
+#define ROM_DATA_PIN        (2u)            // D0-D7 on GPIO 2-9, same pins as the SRAM data
+#define ROM_ADDRESS_PIN     (10u)           // A0-A14 on GPIO 10-24, same pins as the SRAM address
+
+/*
+function abstraction in rom_emulation.c
+*/
+
+void rom_emulation_init();
+
+#endif
@@ -0,0 +1,64 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#include "pico/stdlib.h"
+#include "stats.h"
+#include "developer_tools.h"
+#include "usb_batch.h"
+
+_Static_assert(STAT_COUNT <= 0xFF, "the snapshot counts fields in a byte");
+
+stats_block_t stats_blocks[2];                                                          // One per core
+static uint32_t baseline[STAT_COUNT];                                                   // Totals at the last reset (core 0)
+static uint64_t window_start;                                                           // Boot or the last reset
+
+/*
+Appends a little endian value to a packet.
+*/
+static uint16_t put(uint8_t* packet, uint16_t length, uint32_t value, uint8_t size){
+    for (uint8_t i = 0; i < size; i++){packet[length++] = (uint8_t)(value >> (8 * i));}
+    return length;
+}
+
+/*
+Returns a counter summed over both cores. Unsigned math rides out a wrap.
+*/
+static uint32_t stat_total(uint8_t stat){
+    return stats_blocks[0].counters[stat] + stats_blocks[1].counters[stat];
+}
+
+/*
+CMD_SN: writes every statistic since boot or the last reset to the
+developer COMPORT as one binary packet (layout in stats.h), then resets
+them if command[1] != 0.
+*/
+void stats_snapshot(uint8_t* command){
+    if (!DEVELOPER_CONSOLE){return;}                                                    // Perform security check
+    uint8_t packet[STATS_PACKET_HEADER + (STAT_COUNT * 4) + 1];
+    uint64_t now = time_us_64();
+    uint32_t totals[STAT_COUNT];
+    for (uint8_t i = 0; i < STAT_COUNT; i++){totals[i] = stat_total(i);}                // One pass so a reset matches what was sent
+    uint16_t length = 0;
+    packet[length++] = 'S';
+    packet[length++] = 'T';
+    packet[length++] = STATS_VERSION;
+    packet[length++] = STAT_COUNT;
+    length = put(packet, length, (uint32_t)((now - window_start) / 1000), 4);
+    for (uint8_t i = 0; i < STAT_COUNT; i++){
+        length = put(packet, length, totals[i] - baseline[i], 4);
+    }
+    uint8_t sum = 0;                                                                    // Same sum as the Ostrich protocol
+    for (uint16_t i = 0; i < length; i++){sum += packet[i];}
+    packet[length] = sum;
+    usb_write(2, packet, length + 1);
+    if (command[1]){                                                                    // Start a fresh window
+        for (uint8_t i = 0; i < STAT_COUNT; i++){baseline[i] = totals[i];}
+        window_start = now;
+    }
+}
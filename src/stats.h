@@ -0,0 +1,117 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#ifndef STATS_H
+#define STATS_H
+#include "pico/stdlib.h"
+
+/*
+Runtime statistics that can be polled without a debugger. Every core
+has its own block and only ever adds to its own counters (stat_add(),
+stat_time()), so there are no locks. A counter is bumped either from
+interrupts or from the main loop of a core, never from both. A counter
+is the sum of both blocks. A reset doesn't touch the blocks. It keeps a
+baseline on core 0 that later snapshots subtract, so core 1 never races
+a reset.
+
+CMD_SN answers on the developer COMPORT with one binary packet (little endian):
+
+    "ST" | version u8 | count u8 | window ms u32 | count x u32 | sum u8
+
+window is the time since boot or the last reset. The fields are the
+STATS_FIELDS below in order. New fields only ever go on the end (count
+tells the host how many there are), STATS_VERSION goes up when the
+meaning of an existing field changes. sum is the 8 bit sum of every byte
+before it (like checksum()). testing/deploy_ui.py reads the field list
+out of this file.
+*/
+#define STATS_VERSION       (1)
+#define STATS_PACKET_HEADER (8u)            // "ST", version, count, window
+
+/*
+Every statistic: X(id, text), text is what the host labels it with.
+*/
+#define STATS_FIELDS(X) \
+    X(STAT_COMMANDS_EMULATION,  "emulation commands") \
+    X(STAT_COMMANDS_DATALOG,    "datalog commands") \
+    X(STAT_COMMANDS_DEVELOPER,  "developer commands") \
+    X(STAT_COMMANDS_UNKNOWN,    "unknown commands") \
+    X(STAT_CHECKSUM_FAILURES,   "checksum failures") \
+    X(STAT_TIMEOUTS,            "read timeouts") \
+    X(STAT_BYTES_UPLOADED,      "bytes uploaded") \
+    X(STAT_BYTES_DOWNLOADED,    "bytes downloaded") \
+    X(STAT_ERASES_SECTOR0,      "erases of tune sector 0") \
+    X(STAT_ERASES_SECTOR1,      "erases of tune sector 1") \
+    X(STAT_ERASES_SECTOR2,      "erases of tune sector 2") \
+    X(STAT_ERASES_SECTOR3,      "erases of tune sector 3") \
+    X(STAT_ERASES_SECTOR4,      "erases of tune sector 4") \
+    X(STAT_ERASES_SECTOR5,      "erases of tune sector 5") \
+    X(STAT_ERASES_SECTOR6,      "erases of tune sector 6") \
+    X(STAT_ERASES_SECTOR7,      "erases of tune sector 7") \
+    X(STAT_ERASES_OTHER,        "other flash erases (journal, revisions, presets, black box)") \
+    X(STAT_SAVE_BLOCKING_MS,    "save with blocking (ms)") \
+    X(STAT_MACRO_INJECTIONS,    "macro injections") \
+    X(STAT_MICRO_INJECTIONS,    "micro injections") \
+    X(STAT_BYTES_INJECTED,      "bytes injected") \
+    X(STAT_CORE1_BUSY_MS,       "core 1 busy (ms)") \
+    X(STAT_DATALOG_FRAMES,      "datalog frames") \
+    X(STAT_UART_ERRORS,         "UART errors") \
+    X(STAT_COMMANDS_R,          "emulation R commands") \
+    X(STAT_COMMANDS_W,          "emulation W commands") \
+    X(STAT_COMMANDS_ZR,         "emulation ZR commands") \
+    X(STAT_COMMANDS_ZW,         "emulation ZW commands") \
+    X(STAT_COMMANDS_OTHER,      "other emulation commands")
+
+#define STATS_ENUM(id, text) id,
+
+typedef enum {
+    STATS_FIELDS(STATS_ENUM)
+    STAT_COUNT
+} stat_t;
+
+/*
+Structure for a STATS BLOCK (one per core):
+
+    volatile uint32_t counters[STAT_COUNT];
+    uint16_t remainder_us[STAT_COUNT];
+
+remainder_us carries the part of a millisecond stat_time() could not
+add to a _MS counter yet.
+*/
+typedef struct {
+    volatile uint32_t counters[STAT_COUNT];
+    uint16_t remainder_us[STAT_COUNT];
+} stats_block_t;
+
+extern stats_block_t stats_blocks[2];
+
+/*
+Adds to a counter in the calling core's block.
+*/
+static inline void stat_add(stat_t stat, uint32_t amount){
+    stats_blocks[get_core_num()].counters[stat] += amount;
+}
+
+/*
+Adds microseconds to a _MS counter in the calling core's block.
+*/
+static inline void stat_time(stat_t stat, uint32_t us){
+    stats_block_t* block = &stats_blocks[get_core_num()];
+    uint32_t total = block->remainder_us[stat] + us;
+    block->counters[stat] += total / 1000;
+    block->remainder_us[stat] = (uint16_t)(total % 1000);
+}
+
+/*
+function abstraction in stats.c
+*/
+
+void stats_snapshot(uint8_t* command);
+
+#endif
@@ -0,0 +1,152 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#include <string.h>
+#include "pico/stdlib.h"
+#include "tusb.h"
+#include "trace.h"
+#include "developer_tools.h"
+#include "usb_batch.h"
+
+_Static_assert(!(TRACE_DEPTH & (TRACE_DEPTH - 1)), "TRACE_DEPTH must be a power of 2");
+_Static_assert(sizeof(trace_record_t) == 12, "trace_record_t is sent as is");
+
+trace_ring_t trace_rings[2];                                                            // One per core
+static bool streaming = TRACE_STREAM;                                                   // CMD_TS
+static uint64_t last_drain;                                                             // Last time a part filled batch went out
+
+/*
+Waits up to wait_us for bytes of room on the developer COMPORT,
+flushing what is already queued. Returns false if there is none.
+*/
+static bool frame_room(uint32_t bytes, uint32_t wait_us){
+    uint64_t start = time_us_64();
+    while (tud_cdc_n_write_available(2) < bytes){                                       // FIFO still holds earlier frames
+        if (time_us_64() - start >= wait_us){return false;}                             // Nobody is reading, give up
+        usb_flush(2);                                                                   // Push out what is queued
+        tud_task();                                                                     // And let the stack send it
+    }
+    return true;
+}
+
+/*
+Writes one frame to the developer COMPORT, room must already be there.
+*/
+static void send_frame(uint8_t kind, uint8_t core, const trace_record_t* records, uint8_t count){
+    uint8_t header[TRACE_HEADER] = {TRACE_SYNC, kind, core, count};
+    usb_write(2, header, sizeof(header));
+    usb_write(2, records, count * sizeof(trace_record_t));
+}
+
+/*
+Copies records first up to head out of a ring into frame + 1 and
+returns how many at the start were overwritten by the writer while
+they were being copied (those must be thrown away).
+*/
+static uint32_t copy_records(const trace_ring_t* ring, trace_record_t* frame, uint32_t first, uint32_t count){
+    for (uint32_t i = 0; i < count; i++){                                               // Oldest first
+        frame[i + 1] = ring->records[(first + i) & (TRACE_DEPTH - 1)];
+    }
+    __dmb();                                                                            // Copies done before head is read again
+    int32_t overwritten = (int32_t)((ring->head + 1 - TRACE_DEPTH) - first);            // Slots the writer may have reached (+1 for the one it is filling)
+    if (overwritten <= 0){return 0;}
+    return ((uint32_t)overwritten > count) ? count : (uint32_t)overwritten;
+}
+
+/*
+Sends up to one batch of a core's new records as a 'T' frame, a
+TRACE_LOST record goes first if records were overwritten unread.
+*/
+static void drain(uint8_t core){
+    trace_ring_t* ring = &trace_rings[core];
+    trace_record_t frame[TRACE_BATCH + 1];                                              // Room for a TRACE_LOST record up front
+    uint32_t head = ring->head;                                                         // Snapshot, the writer keeps going
+    __dmb();                                                                            // Records up to head are visible now
+    if (head - ring->tail > TRACE_DEPTH){                                               // Ring went round since the last drain
+        ring->lost += head - ring->tail - TRACE_DEPTH;
+        ring->tail = head - TRACE_DEPTH;
+    }
+    uint32_t count = head - ring->tail;                                                 // Unread records
+    if (count > TRACE_BATCH){count = TRACE_BATCH;}
+    uint32_t room = tud_cdc_n_write_available(2);
+    if (room < TRACE_HEADER + ((count + 1) * sizeof(trace_record_t))){return;}          // Try again once the FIFO drains
+    uint32_t skip = copy_records(ring, frame, ring->tail, count);
+    ring->tail += count;
+    ring->lost += skip;
+    trace_record_t* start = &frame[skip + 1];                                           // First record that survived
+    count -= skip;
+    if (ring->lost){                                                                    // Tell the host about the gap
+        start--;
+        *start = (trace_record_t){.time = time_us_32(), .event = TRACE_LOST, .a = core, .b = ring->lost};
+        ring->lost = 0;
+        count++;
+    }
+    if (count){send_frame('T', core, start, (uint8_t)count);}
+}
+
+/*
+Drains both rings to the developer COMPORT while the stream is on.
+A core's records go out once a batch is full or TRACE_PERIOD_US after
+the last drain, so the COMPORT sees a few large frames instead of one
+per record. Called wherever core 0 loops.
+*/
+void trace_service(){
+    if (!DEVELOPER_CONSOLE || !streaming){return;}                                      // Recording only
+    if (console_muted() || !tud_cdc_n_connected(2)){return;}                            // Keep them for later
+    uint64_t now = time_us_64();
+    bool due = (now - last_drain >= TRACE_PERIOD_US);                                   // Time to send part filled batches
+    for (uint8_t core = 0; core < 2; core++){
+        uint32_t waiting = trace_rings[core].head - trace_rings[core].tail;
+        if (waiting >= TRACE_BATCH || (waiting && due)){drain(core);}
+    }
+    if (due){last_drain = now;}
+}
+
+/*
+Sends the newest TRACE_DUMP records of both cores as 'D' frames without
+marking them read, the flight recorder view after an error. Core 0 is
+the only reader so it may block here for a moment while the host reads.
+*/
+void trace_dump(){
+    if (!DEVELOPER_CONSOLE || console_muted()){return;}                                 // Never mix frames into a download
+    trace_record_t frame[TRACE_BATCH + 1];
+    for (uint8_t core = 0; core < 2; core++){
+        trace_ring_t* ring = &trace_rings[core];
+        uint32_t head = ring->head;                                                     // Snapshot, core 1 may still be writing
+        __dmb();
+        uint32_t first = (head > TRACE_DUMP) ? head - TRACE_DUMP : 0;                   // Newest TRACE_DUMP records
+        while (first != head){                                                          // A batch per frame
+            uint32_t count = head - first;
+            if (count > TRACE_BATCH){count = TRACE_BATCH;}
+            if (!frame_room(TRACE_HEADER + (count * sizeof(trace_record_t)), TRACE_DUMP_WAIT_US)){return;}
+            uint32_t skip = copy_records(ring, frame, first, count);
+            if (count > skip){send_frame('D', core, &frame[skip + 1], (uint8_t)(count - skip));}
+            first += count;
+        }
+    }
+    usb_flush(2);                                                                       // Out now, not at the deadline
+}
+
+/*
+CMD_TD: dumps the newest records of both cores to the developer COMPORT.
+*/
+void trace_download(uint8_t* command){
+    if (!DEVELOPER_CONSOLE){return;}                                                    // Perform security check
+    trace_dump();
+}
+
+/*
+CMD_TS: turns streaming of the trace rings on (command[1] != 0) or off.
+Records made while it was off go out first (up to TRACE_DEPTH per core).
+*/
+void trace_stream(uint8_t* command){
+    if (!DEVELOPER_CONSOLE){return;}                                                    // Perform security check
+    streaming = (command[1] != 0);
+    last_drain = time_us_64();
+}
@@ -0,0 +1,131 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#ifndef TRACE_H
+#define TRACE_H
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+
+/*
+Binary trace ring (flight recorder). trace() drops a 12 byte record
+(timestamp, event id, two arguments) into a ring owned by the calling
+core, no formatting and no USB, so it is cheap enough to stay on and
+safe to call from core 1's hot path. Each ring has one writer (its
+core, interrupts held off for the few stores) and one reader (core 0),
+head only ever counts up and the oldest records are overwritten.
+
+Core 0 drains both rings to the developer COMPORT in frames while the
+stream is on (CMD_TS) and dumps the newest TRACE_DUMP records of each
+core on CMD_TD or once core 1 has stopped answering. Frames are binary
+(little endian) and may sit between text lines:
+
+    0xFE | kind u8 | core u8 | count u8 | count x (time u32 | event u16 | a u16 | b u32)
+
+kind is 'T' (stream) or 'D' (dump), time is time_us_32(). Records lost
+to an overrun come through as a TRACE_LOST record. testing/trace_decode.py
+reads the event list below out of this file and renders the text, the
+strings are never compiled into the firmware.
+*/
+#define TRACE_DEPTH         (256u)          // Records per core, must be a power of 2
+#define TRACE_BATCH         (32u)           // Most records per frame
+#define TRACE_PERIOD_US     (10000u)        // Drain a part filled batch after this long
+#define TRACE_DUMP          (64u)           // Newest records per core in a dump
+#define TRACE_DUMP_WAIT_US  (100000u)       // Longest a dump waits for room on the COMPORT
+#define TRACE_STREAM        (0)             // Stream the rings at boot (CMD_TS toggles it)
+#define TRACE_SYNC          (0xFEu)         // First byte of a frame, never in a text line
+#define TRACE_HEADER        (4u)            // sync, kind, core, count
+
+/*
+Every trace event: X(id, text). text is a Python format string the
+decoder fills with the record's a and b, ids are numbered in order so
+only ever add new events at the end.
+*/
+#define TRACE_EVENTS(X) \
+    X(TRACE_LOST,           "{b} records of core {a} lost") \
+    X(TRACE_BOOT,           "boot at {b}Hz") \
+    X(TRACE_COMMAND,        "command 0x{b:04X}") \
+    X(TRACE_UNKNOWN,        "unknown command 0x{b:04X} from COMPORT {a}") \
+    X(TRACE_COMMIT,         "sector {a} committed in {b}us") \
+    X(TRACE_MICRO,          "context {a}: micro injection of {b} bytes") \
+    X(TRACE_SECTOR,         "context {a}: sector {b} injected") \
+    X(TRACE_MACRO,          "context {a}: full injection in {b}us") \
+    X(TRACE_CORE0_ERROR,    "CORE_0 ERROR: Ostrich timed out.") \
+    X(TRACE_CORE1_ERROR,    "CORE_1 ERROR: Injection timed out.") \
+    X(TRACE_EDIT,           "context {a}: edit visible after {b}us") \
+    X(TRACE_SUPERSEDED,     "context {a}: edit {b} superseded, its sectors go again")
+
+#define TRACE_ENUM(id, text) id,
+
+typedef enum {
+    TRACE_EVENTS(TRACE_ENUM)
+    TRACE_EVENT_COUNT
+} trace_event_t;
+
+/*
+Structure for a TRACE RECORD:
+
+    uint32_t time;
+    uint16_t event;
+    uint16_t a;
+    uint32_t b;
+*/
+typedef struct {
+    uint32_t time;
+    uint16_t event;
+    uint16_t a;
+    uint32_t b;
+} trace_record_t;
+
+/*
+Structure for a TRACE RING (one per core):
+
+    volatile uint32_t head;
+    uint32_t tail;
+    uint32_t lost;
+    trace_record_t records[TRACE_DEPTH];
+
+head counts every record ever written (the writer's), tail and lost
+belong to the reader on core 0.
+*/
+typedef struct {
+    volatile uint32_t head;
+    uint32_t tail;
+    uint32_t lost;
+    trace_record_t records[TRACE_DEPTH];
+} trace_ring_t;
+
+extern trace_ring_t trace_rings[2];
+
+/*
+Records an event in the calling core's ring.
+*/
+static inline void trace(trace_event_t event, uint16_t a, uint32_t b){
+    trace_ring_t* ring = &trace_rings[get_core_num()];
+    uint32_t interrupts = save_and_disable_interrupts();                                // An interrupt tracing on this core would share the slot
+    uint32_t head = ring->head;
+    trace_record_t* record = &ring->records[head & (TRACE_DEPTH - 1)];
+    record->time = time_us_32();
+    record->event = (uint16_t)event;
+    record->a = a;
+    record->b = b;
+    __dmb();                                                                            // Record lands before core 0 sees it
+    ring->head = head + 1;
+    restore_interrupts(interrupts);
+}
+
+/*
+function abstraction in trace.c
+*/
+
+void trace_service();
+void trace_dump();
+void trace_download(uint8_t* command);
+void trace_stream(uint8_t* command);
+
+#endif
@@ -0,0 +1,217 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+#include "flash_memory.h"
+#include "mutexes.h"
+#include "contexts.h"
+#include "tune_shadow.h"
+#include "tune_archive.h"
+#include "lz.h"
+#include "ostrich.h"
+#include "developer_tools.h"
+
+static uint32_t* owner;                                                                 // Dummy place holder for mutex owner
+
+/*
+Returns the flash offset of an archive slot.
+*/
+static uint32_t slot_offset(uint8_t slot){
+    return ARCHIVE_OFFSET + ((uint32_t)slot * ARCHIVE_SLOT_SIZE);
+}
+
+/*
+Returns the XIP address of the compressed data in a slot.
+*/
+static const uint8_t* slot_data(uint8_t slot){
+    return (const uint8_t *)(XIP_BASE + slot_offset(slot) + FLASH_PAGE_SIZE);
+}
+
+/*
+Carries an FNV-1a hash on over length more bytes.
+*/
+static uint32_t hash_more(uint32_t hash, const uint8_t* data, uint32_t length){
+    for (uint32_t i = 0; i < length; i++){
+        hash = (hash ^ data[i]) * 0x01000193u;                                          // FNV prime
+    }
+    return hash;
+}
+
+/*
+FNV-1a over length bytes.
+*/
+static uint32_t archive_hash(const uint8_t* data, uint32_t length){
+    return hash_more(0x811C9DC5u, data, length);                                        // FNV offset basis
+}
+
+/*
+Returns the header of a slot if it holds a complete archive, otherwise NULL.
+*/
+static const archive_header_t* archive_at(uint8_t slot){
+    const archive_header_t* header = (const archive_header_t *)(XIP_BASE + slot_offset(slot));
+    if (header->magic != ARCHIVE_MAGIC){return NULL;}                                   // Erased or never written
+    if (!header->length || header->length > ARCHIVE_DATA_MAX){return NULL;}             // Nonsense
+    if (archive_hash(slot_data(slot), header->length) != header->data_hash){return NULL;}  // Torn write
+    return header;
+}
+
+/*
+Erases a slot and programs pages of image into it, header page last
+so a slot cut short by a power loss never has a valid header.
+*/
+__not_in_flash("tune_archive")
+static void slot_program(uint8_t slot, const uint8_t* image, uint32_t pages){
+    uint32_t offset = slot_offset(slot);                                                // Where the slot starts
+    uint32_t interrupts = save_and_disable_interrupts();                                // Lock out XIP while the flash is busy
+    flash_range_erase(offset, ARCHIVE_SLOT_SIZE);                                       // Whole slot goes
+    flash_range_program(offset + FLASH_PAGE_SIZE, image + FLASH_PAGE_SIZE, (pages - 1) * FLASH_PAGE_SIZE);  // Compressed data first
+    flash_range_program(offset, image, FLASH_PAGE_SIZE);                                // Header last
+    restore_interrupts(interrupts);                                                     // Unlock XIP
+}
+
+/*
+CMD_AS: compresses the tune being emulated into archive slot command[1].
+*/
+void archive_save(uint8_t* command){
+    if (!DEVELOPER_CONSOLE){return;}                                                    // Perform security check
+    uint8_t slot = command[1];                                                          // Which slot to fill
+    if (slot >= ARCHIVE_SLOTS){print("Archive slot out of range: ", slot, false); return;}
+    uint8_t* tune = malloc(TUNE_SIZE);                                                  // Contiguous copy of the tune, only while compressing
+    uint8_t* image = malloc(ARCHIVE_SLOT_SIZE);                                         // Header page + compressed data
+    if (!tune || !image){
+        free(tune);
+        free(image);
+        print("Archive failed: out of RAM", -1, false);
+        return;
+    }
+    shadow_read(&context->shadow, tune, 0, TUNE_SIZE);                                  // Core 0 is the only shadow writer, no mutex needed to read
+    uint32_t length = lz_compress(tune, TUNE_SIZE, image + FLASH_PAGE_SIZE, ARCHIVE_DATA_MAX);
+    if (!length){
+        free(tune);
+        free(image);
+        print("Archive failed: tune does not fit in a slot", -1, false);
+        return;
+    }
+    archive_header_t header = {
+        .magic = ARCHIVE_MAGIC,
+        .length = length,
+        .tune_hash = archive_hash(tune, TUNE_SIZE),
+        .data_hash = archive_hash(image + FLASH_PAGE_SIZE, length),
+        .timestamp = (uint32_t)(time_us_64() / 1000),
+        .bank = context->persist_bank
+    };
+    uint32_t pages = 1 + ((length + FLASH_PAGE_SIZE - 1) / FLASH_PAGE_SIZE);            // Header page + data pages
+    memset(image, 0xFF, FLASH_PAGE_SIZE);                                               // Header page is mostly blank
+    memcpy(image, &header, sizeof(header));
+    memset(image + FLASH_PAGE_SIZE + length, 0xFF, ((pages - 1) * FLASH_PAGE_SIZE) - length);  // Pad the last data page
+    multicore_lockout_start_blocking();                                                 // Blocks core 1 from XIP operations
+    slot_program(slot, image, pages);
+    multicore_lockout_end_blocking();                                                   // Lifts block on core 1
+    free(tune);                                                                         // Give the RAM back
+    free(image);
+    print("Archived tune, compressed bytes: ", length, false);
+}
+
+/*
+CMD_AR: decompresses archive slot command[1] and commits it to the current bank.
+The slot is decompressed a sector at a time straight into the RAM sectors
+of the tune shadow, no second copy of the tune. Only sectors that differ
+are committed (each one leaves a revision, so CMD_HU can undo a load), then
+the shadow is pointed at the new sectors and core 1 re-injects the whole tune.
+A corrupt slot puts the shadow back on flash, nothing was committed.
+*/
+void archive_load(uint8_t* command){
+    if (!DEVELOPER_CONSOLE){return;}                                                    // Perform security check
+    uint8_t slot = command[1];                                                          // Which slot to load
+    const archive_header_t* header = (slot < ARCHIVE_SLOTS) ? archive_at(slot) : NULL;
+    if (!header){print("Archive slot empty: ", slot, false); return;}
+    lz_stream_t stream;
+    lz_stream_init(&stream, slot_data(slot), header->length);                          // Straight from XIP
+    uint32_t hash = archive_hash(NULL, 0);                                              // Tune hash, a sector at a time
+    bool loaded = true;
+    for (uint8_t sector = 0; sector < TUNE_SECTORS && loaded; sector++){                // Earlier sectors stay put, matches read them
+        while (1){                                                                      // Loop until we get that mutex
+            if (mutex_try_enter(&context->tune_data.tune_flag, owner)){                 // Core 1 reads these sectors under it
+                uint8_t* data = shadow_sector(&context->shadow, sector);                // RAM copy to decompress into
+                loaded = data && lz_decompress_sector(&stream, context->shadow.sectors, TUNE_SECTOR_SIZE);
+                loaded = loaded && stream.out == (uint32_t)(sector + 1) * TUNE_SECTOR_SIZE;  // Short slot
+                if (loaded){hash = hash_more(hash, data, TUNE_SECTOR_SIZE);}
+                mutex_exit(&context->tune_data.tune_flag);                              // Exit mutex like a moral person
+                break;                                                                  // Definitely break out of loop
+            }
+        }
+    }
+    loaded = loaded && stream.in == header->length && hash == header->tune_hash;        // Nothing left over and the right tune
+    if (loaded){
+        for (uint8_t sector = 0; sector < TUNE_SECTORS; sector++){                      // Commit what changed
+            const uint8_t* data = context->shadow.sectors[sector];                      // Sector of the loaded tune
+            if (!memcmp(data, flash_sector(context->persist_bank, sector), TUNE_SECTOR_SIZE)){continue;}
+            commit_with_blocking(sector, data);                                         // Records a revision too
+        }
+    }
+    while (1){                                                                          // Loop until we get that mutex
+        if (mutex_try_enter(&context->tune_data.tune_flag, owner)){                     // Obtain a mutex for binary use
+            shadow_init(&context->shadow, context->persist_bank);                       // Drop RAM sectors, serve what flash holds
+            context->tune_data.sectors = (1u << TUNE_SECTORS) - 1;                      // Re-inject every sector (core 1 may have read a half load)
+            mutex_exit(&context->tune_data.tune_flag);                                  // Exit mutex like a moral person
+            break;                                                                      // Definitely break out of loop
+        }
+    }
+    if (!loaded){print("Archive corrupt or out of RAM: ", slot, false); return;}
+    print("Loaded archive slot: ", slot, false);
+}
+
+/*
+CMD_AL: prints every archive slot that holds a tune to the developer COMPORT.
+*/
+void post_archives(uint8_t* command){
+    if (!DEVELOPER_CONSOLE){return;}                                                    // Perform security check
+    char line[96];                                                                      // One printed line
+    print("Archived tunes:", -1, false);
+    for (uint8_t slot = 0; slot < ARCHIVE_SLOTS; slot++){                               // One line per used slot
+        const archive_header_t* header = archive_at(slot);
+        if (!header){continue;}                                                         // Empty slot
+        snprintf(line, sizeof(line), "  -%u: %lu bytes (%lu%%) bank %u at %lums",
+                 (unsigned)slot, (unsigned long)header->length,
+                 (unsigned long)((header->length * 100) / TUNE_SIZE),
+                 (unsigned)header->bank, (unsigned long)header->timestamp);
+        print(line, -1, false);
+    }
+}
+
+/*
+CMD_AT: times decompressing archive slot command[1] against the raw 32kb
+memcpy out of XIP that conditional() used to do, both into the same RAM buffer.
+*/
+void archive_timing(uint8_t* command){
+    if (!DEVELOPER_CONSOLE){return;}                                                    // Perform security check
+    uint8_t slot = command[1];                                                          // Which slot to time
+    const archive_header_t* header = (slot < ARCHIVE_SLOTS) ? archive_at(slot) : NULL;
+    if (!header){print("Archive slot empty: ", slot, false); return;}
+    uint8_t* tune = malloc(TUNE_SIZE);                                                  // Both runs land here
+    if (!tune){print("Archive timing failed: out of RAM", -1, false); return;}
+    uint64_t start = time_us_64();                                                      // Decompression first
+    uint32_t length = lz_decompress(slot_data(slot), header->length, tune, TUNE_SIZE);
+    uint32_t decompress = (uint32_t)(time_us_64() - start);
+    start = time_us_64();                                                               // Then the raw copy
+    for (uint8_t sector = 0; sector < TUNE_SECTORS; sector++){
+        memcpy(&tune[sector * TUNE_SECTOR_SIZE], flash_sector(context->persist_bank, sector), TUNE_SECTOR_SIZE);
+    }
+    uint32_t copy = (uint32_t)(time_us_64() - start);
+    free(tune);                                                                         // Give the RAM back
+    print("Decompressed bytes: ", length, false);
+    print("Decompress (us): ", decompress, false);
+    print("Raw memcpy (us): ", copy, false);
+}
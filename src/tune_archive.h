@@ -0,0 +1,57 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#ifndef TUNE_ARCHIVE_H
+#define TUNE_ARCHIVE_H
+#include "pico/stdlib.h"
+#include "hardware/flash.h"
+
+/*
+The tune archive keeps whole tunes compressed (lz.h) in fixed slots at
+ARCHIVE_OFFSET (flash_memory.h). A raw bank needs 0x9000 bytes of flash,
+an archived tune is usually a few kb so 32 of them fit in 512kb.
+Each slot is one header page followed by the compressed image:
+
+    [header][lz data ...........][0xFF]
+*/
+#define ARCHIVE_MAGIC       (0x31435241u)   // "ARC1"
+#define ARCHIVE_SLOT_SIZE   (0x4000u)       // 4 sectors per slot
+#define ARCHIVE_DATA_MAX    (ARCHIVE_SLOT_SIZE - FLASH_PAGE_SIZE)  // Compressed bytes a slot can hold
+
+/*
+Structure for the ARCHIVE HEADER (first page of every slot):
+
+    uint32_t magic;
+    uint32_t length;
+    uint32_t tune_hash;
+    uint32_t data_hash;
+    uint32_t timestamp;
+    uint8_t bank;
+
+tune_hash is over the 32kb tune, data_hash over the compressed bytes.
+*/
+typedef struct {
+    uint32_t magic;
+    uint32_t length;
+    uint32_t tune_hash;
+    uint32_t data_hash;
+    uint32_t timestamp;
+    uint8_t bank;
+} archive_header_t;
+
+/*
+function abstraction in tune_archive.c
+*/
+
+void post_archives(uint8_t* command);
+void archive_save(uint8_t* command);
+void archive_load(uint8_t* command);
+void archive_timing(uint8_t* command);
+
+#endif
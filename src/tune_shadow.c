@@ -0,0 +1,159 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#include <stdlib.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "tune_shadow.h"
+#include "flash_memory.h"
+#include "injection.h"
+
+/*
+Points the shadow at a bank in XIP flash. Nothing is copied here,
+sectors are only pulled into RAM once they are written to.
+Any sectors materialized from a previous bank are released.
+*/
+void shadow_init(tune_shadow_t* shadow, uint8_t bank){
+    for (uint8_t i = 0; i < TUNE_SECTORS; i++){                                         // Walk every sector of the tune
+        free(shadow->sectors[i]);                                                       // Release the RAM copy (free(NULL) is fine)
+        shadow->sectors[i] = NULL;                                                      // Serve this sector from flash again
+    }
+    shadow->dirty = 0;                                                                  // Nothing left to commit
+    shadow_refresh(shadow, bank);                                                       // Look up where each sector lives
+}
+
+/*
+Re-reads which A/B slot holds each sector of the bank. Called after
+every commit, the slot that was active stays intact until the next
+commit of that sector so readers holding the old pointer are still fine.
+*/
+void shadow_refresh(tune_shadow_t* shadow, uint8_t bank){
+    shadow->bank = bank;                                                                // Remember which bank we are shadowing
+    for (uint8_t i = 0; i < TUNE_SECTORS; i++){                                         // Walk every sector of the tune
+        shadow->flash[i] = flash_sector(bank, i);                                       // XIP address of the newest copy
+    }
+}
+
+/*
+Returns the address of a tune byte, in RAM if the sector
+has been written or in XIP flash if it has not.
+shadow_ptr, shadow_span and shadow_read are on the core 1 hot path
+and follow INJECTION_IN_RAM (see injection.h).
+*/
+const uint8_t* __injection_func(shadow_ptr)(const tune_shadow_t* shadow, uint16_t address){
+    uint8_t sector = address / TUNE_SECTOR_SIZE;                                        // Which 4kb sector the byte lives in
+    if (shadow->sectors[sector]){                                                       // Sector already copied into RAM?
+        return shadow->sectors[sector] + (address % TUNE_SECTOR_SIZE);                  // Serve the edited copy
+    }
+    return shadow->flash[sector] + (address % TUNE_SECTOR_SIZE);                        // Serve straight from flash
+}
+
+/*
+Returns how many bytes (up to length) can be read from shadow_ptr(address)
+before crossing into the next sector. Sectors are not contiguous in RAM.
+*/
+uint16_t __injection_func(shadow_span)(uint16_t address, uint16_t length){
+    uint16_t left = TUNE_SECTOR_SIZE - (address % TUNE_SECTOR_SIZE);                    // Bytes until the sector ends
+    return (length < left) ? length : left;                                             // Clamp to the request
+}
+
+/*
+Returns a single byte of the tune.
+*/
+uint8_t shadow_byte(const tune_shadow_t* shadow, uint16_t address){
+    return *shadow_ptr(shadow, address);                                                // Dereference wherever the byte lives
+}
+
+/*
+Copies length bytes of the tune starting at address into buffer.
+*/
+void __injection_func(shadow_read)(const tune_shadow_t* shadow, uint8_t* buffer, uint16_t address, uint16_t length){
+    while (length){                                                                     // Loop until everything is copied
+        uint16_t span = shadow_span(address, length);                                   // Stay inside one sector per copy
+        memcpy(buffer, shadow_ptr(shadow, address), span);                              // Copy that piece out
+        buffer += span;                                                                 // Move along the destination
+        address += span;                                                                // Move along the tune
+        length -= span;                                                                 // Less to go
+    }
+}
+
+/*
+Copies a sector from flash into RAM the first time it is written.
+Returns false if there is no RAM left for the copy.
+*/
+static bool materialize(tune_shadow_t* shadow, uint8_t sector){
+    if (shadow->sectors[sector]){return true;}                                          // Already in RAM, nothing to do
+    uint8_t* copy = malloc(TUNE_SECTOR_SIZE);                                           // Cut out 4kb for this sector only
+    if (!copy){return false;}                                                           // Out of heap, refuse the write
+    memcpy(copy, shadow->flash[sector], TUNE_SECTOR_SIZE);                              // Seed it with what flash holds
+    shadow->sectors[sector] = copy;                                                     // From now on reads come from RAM
+    return true;
+}
+
+/*
+Writes length bytes into the tune at address, materializing
+every sector the write touches before copying anything, so a
+write crossing sectors is never left half done.
+Returns false, with the tune untouched, if out of RAM.
+*/
+bool shadow_write(tune_shadow_t* shadow, uint16_t address, const uint8_t* data, uint16_t length){
+    if (!length){return true;}                                                          // Nothing to write
+    uint8_t last = (address + length - 1) / TUNE_SECTOR_SIZE;                           // Sector the write ends in
+    for (uint8_t sector = address / TUNE_SECTOR_SIZE; sector <= last; sector++){        // Pull every sector into RAM first
+        if (!materialize(shadow, sector)){return false;}                                // A clean copy of flash, harmless to keep
+    }
+    while (length){                                                                     // Loop until everything is written
+        uint8_t sector = address / TUNE_SECTOR_SIZE;                                    // Sector the write starts in
+        uint16_t span = shadow_span(address, length);                                   // Bytes that fit in that sector
+        memcpy(shadow->sectors[sector] + (address % TUNE_SECTOR_SIZE), data, span);     // Write the piece
+        shadow->dirty |= (1u << sector);                                                // Needs a commit
+        data += span;                                                                   // Move along the source
+        address += span;                                                                // Move along the tune
+        length -= span;                                                                 // Less to go
+    }
+    return true;
+}
+
+/*
+Returns the RAM copy of a whole sector for writing in place (materializing
+it first), or NULL if out of RAM. The caller commits it or drops it with
+shadow_init(), dirty is not touched.
+*/
+uint8_t* shadow_sector(tune_shadow_t* shadow, uint8_t sector){
+    if (!materialize(shadow, sector)){return NULL;}                                     // Pull the sector into RAM first
+    return shadow->sectors[sector];
+}
+
+/*
+Calculates the same sum as checksum() in ostrich.c over a range of the shadow.
+*/
+uint8_t shadow_checksum(const tune_shadow_t* shadow, uint16_t address, uint16_t length){
+    uint8_t sum = 0;                                                                    // Zero out sum
+    while (length){                                                                     // Loop over every sector piece
+        uint16_t span = shadow_span(address, length);                                   // Stay inside one sector
+        const uint8_t* bytes = shadow_ptr(shadow, address);                             // Where this piece lives
+        for (uint16_t i = 0; i < span; i++){                                            // Add the piece together
+            sum += bytes[i];
+        }
+        address += span;                                                                // Move along the tune
+        length -= span;                                                                 // Less to go
+    }
+    return sum;                                                                         // Return trunicated data
+}
+
+/*
+Returns how many sectors of the shadow currently live in RAM.
+*/
+uint8_t shadow_resident(const tune_shadow_t* shadow){
+    uint8_t count = 0;                                                                  // Zero out count
+    for (uint8_t i = 0; i < TUNE_SECTORS; i++){                                         // Walk every sector of the tune
+        if (shadow->sectors[i]){count++;}                                               // This one was copied into RAM
+    }
+    return count;
+}
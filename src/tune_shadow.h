@@ -0,0 +1,63 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#ifndef TUNE_SHADOW_H
+#define TUNE_SHADOW_H
+#include "pico/stdlib.h"
+
+/*
+The tune shadow is the 32kb image the ECU, BMTune and core 1 see.
+It is split into 4kb sectors (same size as a flash sector) and
+every sector is served straight from the XIP mapped bank until
+the first write lands in it. Only then is the sector copied into
+RAM (copy-on-write) so unedited tunes cost no RAM at all.
+*/
+#define TUNE_SIZE          (0x8000u)                         // 2^15 bytes of tune image
+#define TUNE_SECTOR_SIZE   (0x1000u)                         // Must match FLASH_SECTOR_SIZE
+#define TUNE_SECTORS       (TUNE_SIZE / TUNE_SECTOR_SIZE)    // 8 sectors per tune
+
+/*
+Structure for the TUNE SHADOW:
+
+    uint8_t bank;
+    uint8_t dirty;
+    const uint8_t* flash[TUNE_SECTORS];
+    uint8_t* sectors[TUNE_SECTORS];
+
+bank is the bank the shadow was loaded from, flash[n] is the XIP
+address of the active A/B slot of sector n (see flash_memory.h).
+dirty has a bit per sector written since the last commit_shadow(),
+it is only touched by core 0.
+sectors[n] is NULL until sector n has been written (then it is RAM).
+Every emulation context has its own (see contexts.h), guarded by
+that context's tune_data.tune_flag.
+*/
+typedef struct {
+    uint8_t bank;
+    uint8_t dirty;
+    const uint8_t* flash[TUNE_SECTORS];
+    uint8_t* sectors[TUNE_SECTORS];
+} tune_shadow_t;
+
+/*
+function abstraction in tune_shadow.c
+*/
+
+void shadow_init(tune_shadow_t* shadow, uint8_t bank);
+void shadow_refresh(tune_shadow_t* shadow, uint8_t bank);
+const uint8_t* shadow_ptr(const tune_shadow_t* shadow, uint16_t address);
+uint16_t shadow_span(uint16_t address, uint16_t length);
+uint8_t shadow_byte(const tune_shadow_t* shadow, uint16_t address);
+void shadow_read(const tune_shadow_t* shadow, uint8_t* buffer, uint16_t address, uint16_t length);
+bool shadow_write(tune_shadow_t* shadow, uint16_t address, const uint8_t* data, uint16_t length);
+uint8_t* shadow_sector(tune_shadow_t* shadow, uint8_t sector);
+uint8_t shadow_checksum(const tune_shadow_t* shadow, uint16_t address, uint16_t length);
+uint8_t shadow_resident(const tune_shadow_t* shadow);
+
+#endif
@@ -0,0 +1,136 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "tusb.h"
+#include "usb_batch.h"
+#include "developer_tools.h"
+
+static usb_batch_t batch[USB_INTERFACES];                                               // Per COMPORT state and counters
+static bool batching = USB_BATCH;                                                       // Off = flush on every write
+static uint64_t measure_start;                                                          // Start of the flushes/s window
+
+_Static_assert(USB_INTERFACES <= CFG_TUD_CDC, "tusb_config.h needs a CDC interface per COMPORT (see descriptors.c)");
+
+/*
+Returns the flush deadline of a COMPORT, every emulation COMPORT
+(CONTEXT_ITF()) gets the emulation one.
+*/
+static uint32_t deadline(uint8_t itf){
+    if (itf == 1){return USB_DEADLINE_DATALOG_US;}
+    if (DEVELOPER_CONSOLE && itf == 2){return USB_DEADLINE_DEVELOPER_US;}
+    return USB_DEADLINE_EMULATION_US;
+}
+
+/*
+Writes bytes to a COMPORT, the flush comes with the rest of the batch.
+A full FIFO is flushed and USB is run until everything is in, unless
+nothing goes out for USB_WRITE_TIMEOUT_US, then the rest is dropped.
+*/
+void usb_write(uint8_t itf, const void* data, uint32_t length){
+    usb_batch_t* port = &batch[itf];
+    const uint8_t* bytes = data;
+    uint64_t waited = time_us_64();                                                     // Last time the FIFO took something
+    port->writes++;
+    while (length){
+        uint32_t written = tud_cdc_n_write(itf, bytes, length);                         // Into the FIFO, no packet yet
+        bytes += written;
+        length -= written;
+        port->bytes += written;
+        if (!length){port->stalled = false; break;}                                     // All in, the host is reading again
+        if (written){waited = time_us_64();}
+        if (port->stalled || !tud_cdc_n_connected(itf) || time_us_64() - waited >= USB_WRITE_TIMEOUT_US){
+            port->stalled = true;                                                       // Nobody reading, do not wait on every write
+            port->dropped += length;
+            break;
+        }
+        tud_cdc_n_write_flush(itf);                                                     // FIFO full, get its packets on the wire
+        tud_task();
+    }
+    if (!port->pending){                                                                // First byte of the batch
+        port->pending = true;
+        port->oldest = time_us_64();
+    }
+    if (!batching){usb_flush(itf);}                                                     // Old behaviour for comparison
+}
+
+/*
+Flushes a COMPORT now if anything is waiting, the end of a batch.
+*/
+void usb_flush(uint8_t itf){
+    usb_batch_t* port = &batch[itf];
+    if (!port->pending){return;}                                                        // Nothing to send
+    tud_cdc_n_write_flush(itf);
+    port->pending = false;
+    port->flushes++;
+    if (port->command){                                                                 // Answer to a command went out
+        uint32_t round_trip = (uint32_t)(time_us_64() - port->command);
+        if (round_trip > port->round_trip_max){port->round_trip_max = round_trip;}
+        port->round_trip_sum += round_trip;
+        port->commands++;
+        port->command = 0;
+    }
+}
+
+/*
+Flushes every COMPORT whose oldest byte reached its deadline, the
+emulation COMPORT first. Called wherever core 0 loops.
+*/
+void usb_service(){
+    uint64_t now = time_us_64();
+    for (uint8_t itf = 0; itf < USB_INTERFACES; itf++){                                 // 0 = emulation goes first
+        if (batch[itf].pending && now - batch[itf].oldest >= deadline(itf)){usb_flush(itf);}
+    }
+}
+
+/*
+Stamps the arrival of a command on a COMPORT for the round trip time.
+*/
+void usb_command(uint8_t itf){
+    batch[itf].command = time_us_64();
+}
+
+/*
+CMD_UB: prints flushes/s, dropped bytes and command round trips of every COMPORT.
+*/
+void post_usb(uint8_t* command){
+    if (!DEVELOPER_CONSOLE){return;}                                                    // Perform security check
+    static const char* names[] = {"emulation", "datalog", "developer"};                 // Then emulation1, emulation2
+    uint64_t elapsed = time_us_64() - measure_start;                                    // Length of the window
+    char line[128];                                                                     // One printed line
+    print("USB batching: ", batching, false);
+    for (uint8_t itf = 0; itf < USB_INTERFACES; itf++){                                 // One line per COMPORT
+        usb_batch_t* port = &batch[itf];
+        uint32_t mean = (port->commands) ? (uint32_t)(port->round_trip_sum / port->commands) : 0;
+        char name[24];
+        if (itf < CONTEXT_ITF_BASE){snprintf(name, sizeof(name), "%s", names[itf]);}
+        else {snprintf(name, sizeof(name), "emulation%u", (unsigned)(itf - CONTEXT_ITF_BASE + 1));}
+        snprintf(line, sizeof(line), "  -%s: %u flushes/s, %u writes, %u bytes, %u dropped",  // Two lines, print() takes 125 characters
+                 name, (unsigned)(elapsed ? ((uint64_t)port->flushes * 1000000) / elapsed : 0),
+                 (unsigned)port->writes, (unsigned)port->bytes, (unsigned)port->dropped);
+        print(line, -1, false);
+        snprintf(line, sizeof(line), "    round trip mean %uus max %uus", (unsigned)mean, (unsigned)port->round_trip_max);
+        print(line, -1, false);
+    }
+}
+
+/*
+CMD_UC: turns batching on (command[1] != 0) or off and starts a fresh
+measurement window, run the same load with both and compare CMD_UB.
+*/
+void usb_batching(uint8_t* command){
+    if (!DEVELOPER_CONSOLE){return;}                                                    // Perform security check
+    for (uint8_t itf = 0; itf < USB_INTERFACES; itf++){usb_flush(itf);}                 // Nothing left behind
+    batching = (command[1] != 0);
+    memset(batch, 0, sizeof(batch));
+    measure_start = time_us_64();
+    print("USB batching: ", batching, false);
+}
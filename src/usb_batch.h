@@ -0,0 +1,94 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+#ifndef USB_BATCH_H
+#define USB_BATCH_H
+#include "pico/stdlib.h"
+#include "contexts.h"
+
+/*
+Response batching for the three COMPORTS. Writes go into the CDC FIFO
+without a flush and each interface is flushed once per processed command
+batch (usb_flush()) or once its oldest unflushed byte reaches the
+interface deadline (usb_service()), instead of a short USB packet per
+write. The emulation COMPORT is always flushed first and the moment core 0
+starts waiting on BMTune, developer prints never hold it up.
+
+    COMPORT 0 (emulation)   flushed after every Ostrich command
+    COMPORT 1 (datalog)     flushed after every batch of ECU answers
+    COMPORT 2 (developer)   flushed after USB_DEADLINE_DEVELOPER_US
+    COMPORT 3, 4            emulation of contexts 1 and 2 (CONTEXT_ITF(),
+                            2 and 3 without the developer COMPORT),
+                            same as COMPORT 0
+
+A write that does not fit the CDC FIFO flushes and runs tud_task() until
+the rest is in, so no reply is cut short. Only once nothing went out for
+USB_WRITE_TIMEOUT_US (nobody reading the port) is the rest dropped and
+counted, further writes to that port then take what fits and drop the
+rest without waiting until one fits whole again.
+
+CMD_UB prints flushes/s (each ends in one short USB packet, the full
+packets follow from bytes / 64), dropped bytes and command round trips
+per COMPORT, CMD_UC turns batching off (flush per write, the old
+behaviour) to compare the two.
+*/
+#define USB_BATCH                   (1)         // Batch responses at boot
+#define USB_INTERFACES              (CONTEXT_ITF_BASE + EMULATION_CONTEXTS - 1)  // Emulation, datalog, developer, more emulation
+#define USB_DEADLINE_EMULATION_US   (500u)      // Longest a response byte may wait
+#define USB_DEADLINE_DATALOG_US     (1000u)
+#define USB_DEADLINE_DEVELOPER_US   (10000u)    // Prints coalesce into full packets
+#define USB_WRITE_TIMEOUT_US        (100000u)   // Longest a write waits on a full FIFO before dropping the rest
+
+/*
+Structure for the USB BATCH (one per COMPORT):
+
+    bool pending;
+    bool stalled;
+    uint64_t oldest;
+    uint64_t command;
+    uint32_t writes;
+    uint32_t flushes;
+    uint32_t bytes;
+    uint32_t dropped;
+    uint32_t commands;
+    uint32_t round_trip_max;
+    uint64_t round_trip_sum;
+
+oldest is when the first unflushed byte was written, command is when
+the command being answered arrived (0 = none). A round trip is command
+arrival to the flush carrying its answer, in us. stalled is set once a
+write timed out on a full FIFO, bytes counts what made it into the FIFO
+and dropped what did not.
+*/
+typedef struct {
+    bool pending;
+    bool stalled;
+    uint64_t oldest;
+    uint64_t command;
+    uint32_t writes;
+    uint32_t flushes;
+    uint32_t bytes;
+    uint32_t dropped;
+    uint32_t commands;
+    uint32_t round_trip_max;
+    uint64_t round_trip_sum;
+} usb_batch_t;
+
+/*
+function abstraction in usb_batch.c
+*/
+
+void usb_write(uint8_t itf, const void* data, uint32_t length);
+void usb_flush(uint8_t itf);
+void usb_service();
+void usb_command(uint8_t itf);
+void post_usb(uint8_t* command);
+void usb_batching(uint8_t* command);
+
+#endif
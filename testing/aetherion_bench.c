@@ -0,0 +1,465 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+
+/*
+Host microbenchmarks of the firmware hot paths. Built next to aetherion-sim
+from the same sources (cmake -DAETHERION_HOST_SIM=ON), main.c is replaced by
+this file and sim_usb.c by sim_usb_memory.c. Core 1 is never launched, the
+emulation COMPORT is the in-memory transport and flash is the sim's file
+backed image (AETHERION_FLASH, aetherion-flash.bin by default).
+
+Every benchmark runs the same fixed inputs for a fixed number of operations
+BENCH_ROUNDS times (interleaved) and keeps the fastest round, so a busy host
+skews it less. A calibration loop that calls no firmware code runs in the
+same rounds, it tells how fast the host was during this run.
+Results go to stdout as JSON (ns per operation):
+
+    {"version": 2, "unit": "ns/op", "calibration": 1520.3, "results": {"checksum_256": 95.1, ...}}
+
+Build:  cmake --build build-sim --target aetherion_bench
+Run:    cmake --build build-sim --target bench   (fresh flash image, reports against the baseline)
+        ./aetherion_bench [--baseline <json>] [--tolerance <percent>] [--strict] [--write <json>]
+
+    --baseline <json>     compare to a result file and report what is slower
+    --tolerance <percent> how much slower is still not reported (default 25)
+    --strict              exit 1 if anything is reported slower
+    --write <json>        also write the results there (a new baseline)
+
+Each baseline result is scaled by calibration now / calibration in the
+baseline before the comparison, so a host that is busier (or faster) as a
+whole moves the expectation with it and only a path that got slower on its
+own is reported. The comparison is a report unless --strict is given: the
+rounds cut the noise but do not remove it on a shared host.
+
+testing/bench_baseline.json is the committed baseline. Numbers only compare
+on the same build, regenerate it with --write on a quiet host after a change
+that is meant to move them and commit it with that change.
+*/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "pico/stdlib.h"
+#include "hardware/flash.h"
+#include "contexts.h"
+#include "mutexes.h"
+#include "flash_memory.h"
+#include "tune_shadow.h"
+#include "revisions.h"
+#include "injection.h"
+#include "ostrich.h"
+#include "arenas.h"
+#include "usb_batch.h"
+#include "stats.h"
+#include "lz.h"
+#include "sim.h"
+
+#define BENCH_VERSION       (2)
+#define BENCH_ROUNDS        (9u)            // Rounds per benchmark, the fastest one counts
+#define BENCH_CALIBRATION   (200u)          // Operations of the calibration loop per round
+#define BENCH_TOLERANCE     (25.0)          // Percent slower than the baseline that still passes
+#define BENCH_ADDRESS       (0x1230u)       // Tune address every micro benchmark works on
+#define BENCH_SECTOR        (3u)            // Tune sector the flash benchmarks commit
+
+/*
+Structure for a BENCHMARK:
+
+    const char* name;
+    uint32_t operations;
+    void (*run)(uint32_t operations);
+
+run does operations of the benchmark with fixed inputs.
+*/
+typedef struct {
+    const char* name;
+    uint32_t operations;
+    void (*run)(uint32_t operations);
+} bench_t;
+
+static uint8_t bytes[TUNE_SIZE];                                                        // Fixed input data
+static uint8_t packet[COMMAND_SIZE];                                                    // One host packet
+static volatile uint32_t sink;                                                          // Keeps results alive
+static uint8_t tune_image[TUNE_SIZE];                                                   // Tune-like: tables, then 0xFF padding
+static uint8_t archived[TUNE_SIZE];                                                     // tune_image LZ compressed
+static uint32_t archived_length;
+static uint8_t unpacked[TUNE_SIZE];                                                     // Where the archive benchmarks land
+static uint8_t* unpacked_sectors[TUNE_SECTORS];                                         // unpacked in reverse, like scattered shadow sectors
+
+/*
+Nanoseconds on the monotonic clock.
+*/
+static uint64_t now_ns(){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t)now.tv_sec * 1000000000u) + now.tv_nsec;
+}
+
+/*
+Plays BMTune sending a command: the first 2 bytes are what read_command()
+already took, the rest waits on the emulation COMPORT. Dispatches it the
+way the main loop does and flushes the answer.
+*/
+static void send_command(const uint8_t* data, uint32_t length){
+    uint8_t* command = command_arena;
+    memset(command, 0, 8);                                                              // The main loop clears it between commands
+    command[0] = data[0];
+    command[1] = data[1];
+    if (length > 2){sim_usb_feed(context->pins.itf, data + 2, length - 2);}
+    if (ostrich_dispatch(command)){panic("command 0x%02X%02X not dispatched", data[0], data[1]);}
+    usb_flush(context->pins.itf);
+}
+
+/*
+Appends the Ostrich checksum to a packet, returns the new length.
+*/
+static uint32_t seal(uint8_t* data, uint32_t length){
+    data[length] = checksum(data, length);
+    return length + 1;
+}
+
+static void bench_checksum(uint32_t operations){
+    for (uint32_t i = 0; i < operations; i++){sink += checksum(bytes, 256);}
+}
+
+static void bench_checksum_wrong(uint32_t operations){
+    uint8_t sum = checksum(bytes, 4096 + 5);
+    for (uint32_t i = 0; i < operations; i++){sink += checksum_wrong(bytes, 4096 + 5, sum);}
+}
+
+/*
+The word create_macro_payload() builds for every byte of a full injection.
+*/
+static void bench_pack_macro(uint32_t operations){
+    for (uint32_t i = 0; i < operations; i++){
+        for (uint32_t address = 0; address < TUNE_SIZE; address++){
+            sink ^= injection_word(address, bytes[address], i & 1);
+        }
+    }
+}
+
+/*
+The words create_micro_payload() builds for a 256 byte W.
+*/
+static void bench_pack_micro(uint32_t operations){
+    for (uint32_t i = 0; i < operations; i++){
+        for (uint32_t address = 0; address < MICRO_SIZE; address++){
+            sink ^= injection_word(address + BENCH_ADDRESS, bytes[address], i & 1);
+        }
+    }
+}
+
+/*
+VV, the first entry of the command table.
+*/
+static void bench_dispatch_version(uint32_t operations){
+    static const uint8_t version[2] = {'V', 'V'};
+    for (uint32_t i = 0; i < operations; i++){send_command(version, 2);}
+}
+
+/*
+A key no entry matches walks the whole table twice (one and two byte keys).
+*/
+static void bench_dispatch_unknown(uint32_t operations){
+    uint8_t command[2] = {0x7E, 0x7E};
+    for (uint32_t i = 0; i < operations; i++){sink += ostrich_dispatch(command);}
+}
+
+/*
+R of 256 bytes: parse, checksum, shadow read and the answer.
+*/
+static void bench_micro_read(uint32_t operations){
+    uint8_t request[8] = {'R', 0x00, 0x80 + (BENCH_ADDRESS >> 8), BENCH_ADDRESS & 0xFF, 0, 0};
+    request[4] = checksum(request, 6);                                                  // micro_read() sums 6 bytes of the buffer
+    for (uint32_t i = 0; i < operations; i++){send_command(request, 5);}
+}
+
+/*
+W of 16 bytes end to end: parse, checksum, shadow write, flash commit and
+the handoff to core 1. The bytes change every time so every commit programs.
+*/
+static void bench_micro_write(uint32_t operations){
+    for (uint32_t i = 0; i < operations; i++){
+        packet[0] = 'W';
+        packet[1] = 16;
+        packet[2] = 0x80 + (BENCH_ADDRESS >> 8);
+        packet[3] = BENCH_ADDRESS & 0xFF;
+        for (uint8_t b = 0; b < 16; b++){packet[4 + b] = (uint8_t)(i + b);}
+        send_command(packet, seal(packet, 20));
+        context->tune_data.amount = 0;                                                  // Core 1 would have taken it
+    }
+}
+
+/*
+ZR of 4kb: parse, checksum of the range and 4kb out through the batch.
+*/
+static void bench_bulk_read(uint32_t operations){
+    uint8_t request[8] = {'Z', 'R', 16, 0x00, 0x80 + (BENCH_SECTOR * TUNE_SECTOR_SIZE >> 8), 0};
+    request[5] = checksum(request, 6);                                                  // bulk_read() sums 6 bytes of the buffer
+    for (uint32_t i = 0; i < operations; i++){send_command(request, 6);}
+}
+
+/*
+ZW of 4kb end to end: 4kb in, checksum, shadow write and the flash commit.
+*/
+static void bench_bulk_write(uint32_t operations){
+    for (uint32_t i = 0; i < operations; i++){
+        packet[0] = 'Z';
+        packet[1] = 'W';
+        packet[2] = 16;
+        packet[3] = 0x00;
+        packet[4] = 0x80 + (BENCH_SECTOR * TUNE_SECTOR_SIZE >> 8);
+        memcpy(packet + 5, bytes, TUNE_SECTOR_SIZE);
+        packet[5] = (uint8_t)i;                                                         // Something to commit every time
+        send_command(packet, seal(packet, TUNE_SECTOR_SIZE + 5));
+    }
+}
+
+/*
+commit_shadow() of one dirty sector: undo record, A/B slot program, journal.
+*/
+static void bench_flash_commit(uint32_t operations){
+    for (uint32_t i = 0; i < operations; i++){
+        uint8_t change = (uint8_t)i;
+        if (!shadow_write(&context->shadow, (BENCH_SECTOR * TUNE_SECTOR_SIZE) + (i % FLASH_PAGE_SIZE), &change, 1)){
+            panic("no RAM for the shadow");
+        }
+        commit_shadow();
+    }
+}
+
+/*
+lz_decompress() of a 32kb tune archive into one buffer.
+*/
+static void bench_lz_decompress(uint32_t operations){
+    for (uint32_t i = 0; i < operations; i++){
+        sink += lz_decompress(archived, archived_length, unpacked, TUNE_SIZE);
+    }
+}
+
+/*
+The same archive a sector at a time into 8 separate sectors, the way
+archive_load() fills the tune shadow.
+*/
+static void bench_lz_decompress_sectors(uint32_t operations){
+    for (uint32_t i = 0; i < operations; i++){
+        lz_stream_t stream;
+        lz_stream_init(&stream, archived, archived_length);
+        for (uint8_t sector = 0; sector < TUNE_SECTORS; sector++){
+            sink += lz_decompress_sector(&stream, unpacked_sectors, TUNE_SECTOR_SIZE);
+        }
+    }
+}
+
+/*
+What conditional() did before the archive: the raw 32kb memcpy out of XIP.
+*/
+static void bench_tune_copy(uint32_t operations){
+    for (uint32_t i = 0; i < operations; i++){
+        for (uint8_t sector = 0; sector < TUNE_SECTORS; sector++){
+            memcpy(unpacked + (sector * TUNE_SECTOR_SIZE), flash_sector(0, sector), TUNE_SECTOR_SIZE);
+        }
+        sink += unpacked[i % TUNE_SIZE];
+    }
+}
+
+static const bench_t benches[] = {
+    {"checksum_256",            200000, bench_checksum},
+    {"checksum_wrong_4101",     20000,  bench_checksum_wrong},
+    {"pack_macro_32k",          200,    bench_pack_macro},
+    {"pack_micro_256",          50000,  bench_pack_micro},
+    {"dispatch_version",        200000, bench_dispatch_version},
+    {"dispatch_unknown",        200000, bench_dispatch_unknown},
+    {"micro_read_256",          20000,  bench_micro_read},
+    {"micro_write_16",          2000,   bench_micro_write},
+    {"bulk_read_4k",            2000,   bench_bulk_read},
+    {"bulk_write_4k",           1000,   bench_bulk_write},
+    {"flash_commit_sector",     2000,   bench_flash_commit},
+    {"lz_decompress_32k",       2000,   bench_lz_decompress},
+    {"lz_decompress_sectors",   2000,   bench_lz_decompress_sectors},
+    {"tune_copy_32k",           2000,   bench_tune_copy},
+};
+
+#define BENCH_COUNT (sizeof(benches) / sizeof(benches[0]))
+
+/*
+The calibration loop: FNV-1a over the fixed input, no firmware code, so
+only the host (load, clock, build flags) moves its time.
+*/
+static void bench_calibrate(uint32_t operations){
+    uint32_t hash = 2166136261u;
+    for (uint32_t i = 0; i < operations; i++){
+        for (uint32_t j = 0; j < TUNE_SIZE; j++){hash = (hash ^ bytes[j]) * 16777619u;}
+    }
+    sink += hash;
+}
+
+static const bench_t calibration = {"calibration", BENCH_CALIBRATION, bench_calibrate};
+
+/*
+Brings up what main() would on core 0 only: contexts, mutexes,
+the flash journal, revisions and the tune shadow of context 0.
+Also compresses the tune the archive benchmarks decompress.
+*/
+static void bench_init(){
+    contexts_init();
+    mutexes_init();
+    flash_commits_init();
+    revisions_init();
+    for (uint8_t i = 0; i < EMULATION_CONTEXTS; i++){
+        shadow_init(&contexts[i].shadow, contexts[i].persist_bank);                     // Bank 0, like a new image
+    }
+    context = contexts;
+    for (uint32_t i = 0; i < TUNE_SIZE; i++){bytes[i] = (uint8_t)((i * 7) ^ (i >> 8));}
+    memset(tune_image, 0xFF, TUNE_SIZE);
+    for (uint32_t i = 0; i < TUNE_SIZE / 4; i++){tune_image[i] = (uint8_t)((i % 16) * 9 + (i / 256));}
+    archived_length = lz_compress(tune_image, TUNE_SIZE, archived, TUNE_SIZE);
+    if (!archived_length){panic("the bench tune does not compress");}
+    for (uint8_t sector = 0; sector < TUNE_SECTORS; sector++){
+        unpacked_sectors[sector] = unpacked + ((TUNE_SECTORS - 1 - sector) * TUNE_SECTOR_SIZE);
+    }
+    bench_lz_decompress_sectors(1);                                                     // Both decoders must give the tune back
+    for (uint8_t sector = 0; sector < TUNE_SECTORS; sector++){
+        if (memcmp(unpacked_sectors[sector], tune_image + (sector * TUNE_SECTOR_SIZE), TUNE_SECTOR_SIZE)){
+            panic("lz_decompress_sector() does not give the tune back");
+        }
+    }
+    if (lz_decompress(archived, archived_length, unpacked, TUNE_SIZE) != TUNE_SIZE || memcmp(unpacked, tune_image, TUNE_SIZE)){
+        panic("lz_decompress() does not give the tune back");
+    }
+}
+
+/*
+Runs one round of a benchmark, returns ns per operation.
+*/
+static double measure(const bench_t* bench){
+    uint64_t start = now_ns();
+    bench->run(bench->operations);
+    return (double)(now_ns() - start) / bench->operations;
+}
+
+/*
+Runs every benchmark BENCH_ROUNDS times, one round of each in turn so a
+slow spell of the host spreads over all of them, and keeps the fastest.
+The calibration loop runs with every round, its fastest goes to host.
+*/
+static void run_benches(double* results, double* host){
+    calibration.run(calibration.operations / 10 + 1);
+    *host = measure(&calibration);
+    for (uint32_t i = 0; i < BENCH_COUNT; i++){
+        benches[i].run(benches[i].operations / 10 + 1);                                 // Warm caches and the shadow up
+        results[i] = measure(&benches[i]);
+    }
+    for (uint32_t round = 1; round < BENCH_ROUNDS; round++){
+        double result = measure(&calibration);
+        if (result < *host){*host = result;}
+        for (uint32_t i = 0; i < BENCH_COUNT; i++){
+            result = measure(&benches[i]);
+            if (result < results[i]){results[i] = result;}
+        }
+    }
+}
+
+/*
+Writes the results as JSON.
+*/
+static void write_results(FILE* file, const double* results, double host){
+    fprintf(file, "{\n    \"version\": %d,\n    \"unit\": \"ns/op\",\n    \"calibration\": %.1f,\n    \"results\": {\n", BENCH_VERSION, host);
+    for (uint32_t i = 0; i < BENCH_COUNT; i++){
+        fprintf(file, "        \"%s\": %.1f%s\n", benches[i].name, results[i], (i + 1 < BENCH_COUNT) ? "," : "");
+    }
+    fprintf(file, "    }\n}\n");
+}
+
+/*
+Looks a result up in a baseline file's text, returns false if it is not there.
+*/
+static bool baseline_value(const char* text, const char* name, double* value){
+    char key[64];
+    snprintf(key, sizeof(key), "\"%s\"", name);
+    const char* found = strstr(text, key);
+    if (!found){return false;}
+    found = strchr(found + strlen(key), ':');
+    if (!found){return false;}
+    char* end;
+    *value = strtod(found + 1, &end);
+    return end != found + 1;
+}
+
+/*
+Compares the results to a baseline file scaled by the calibration ratio,
+returns how many are slower than the tolerance allows. The comparison goes
+to stderr, stdout stays JSON.
+*/
+static uint32_t compare(const char* path, const double* results, double host, double tolerance){
+    FILE* file = fopen(path, "r");
+    if (!file){panic("cannot open baseline %s", path);}
+    char text[8192];
+    size_t length = fread(text, 1, sizeof(text) - 1, file);
+    text[length] = 0;
+    fclose(file);
+    double base_host;
+    if (!baseline_value(text, calibration.name, &base_host) || base_host <= 0){
+        fprintf(stderr, "aetherion_bench: %s has no calibration, comparing unscaled\n", path);
+        base_host = host;
+    }
+    double scale = host / base_host;
+    fprintf(stderr, "aetherion_bench: %-22s %12.1f ns/op   baseline %12.1f   host x%.2f\n", calibration.name, host, base_host, scale);
+    uint32_t slower = 0;
+    for (uint32_t i = 0; i < BENCH_COUNT; i++){
+        double base;
+        if (!baseline_value(text, benches[i].name, &base) || base <= 0){
+            fprintf(stderr, "aetherion_bench: %-22s %12.1f ns/op   (not in the baseline)\n", benches[i].name, results[i]);
+            continue;
+        }
+        base *= scale;                                                                  // What the baseline would take on this host now
+        double change = ((results[i] / base) - 1.0) * 100.0;
+        bool failed = change > tolerance;
+        slower += failed;
+        fprintf(stderr, "aetherion_bench: %-22s %12.1f ns/op   baseline %12.1f   %+6.1f%%%s\n",
+                benches[i].name, results[i], base, change, failed ? "   SLOWER" : "");
+    }
+    return slower;
+}
+
+int main(int argc, char** argv){
+    const char* baseline = NULL;
+    const char* output = NULL;
+    double tolerance = BENCH_TOLERANCE;
+    bool strict = false;
+    for (int i = 1; i < argc; i++){
+        if (!strcmp(argv[i], "--baseline") && i + 1 < argc){baseline = argv[++i];}
+        else if (!strcmp(argv[i], "--tolerance") && i + 1 < argc){tolerance = atof(argv[++i]);}
+        else if (!strcmp(argv[i], "--strict")){strict = true;}
+        else if (!strcmp(argv[i], "--write") && i + 1 < argc){output = argv[++i];}
+        else {
+            fprintf(stderr, "usage: aetherion_bench [--baseline <json>] [--tolerance <percent>] [--strict] [--write <json>]\n");
+            return 2;
+        }
+    }
+    bench_init();
+    double results[BENCH_COUNT];
+    double host;
+    run_benches(results, &host);
+    if (stats_blocks[0].counters[STAT_CHECKSUM_FAILURES] || stats_blocks[0].counters[STAT_TIMEOUTS]){
+        panic("a command was refused or cut short, the numbers do not time the real path");
+    }
+    write_results(stdout, results, host);
+    if (output){
+        FILE* file = fopen(output, "w");
+        if (!file){panic("cannot write %s", output);}
+        write_results(file, results, host);
+        fclose(file);
+    }
+    if (!baseline){return 0;}
+    uint32_t slower = compare(baseline, results, host, tolerance);
+    if (slower){fprintf(stderr, "aetherion_bench: %u benchmark(s) more than %.0f%% slower than %s\n", slower, tolerance, baseline);}
+    return (strict && slower) ? 1 : 0;
+}
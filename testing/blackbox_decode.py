@@ -0,0 +1,81 @@
+# SPDX-License-Identifier: BSD-3-Clause
+# 
+# Copyright (c) 2025, Dennis B. Lewis
+# All rights reserved.
+#
+# This file is part of the Aetherion-2350 project.
+# Licensed under the BSD 3-Clause License. See LICENSE file for full license text.
+
+import csv
+import struct
+import sys
+import serial
+
+COMPORT = "COM19"                   # Developer COMPORT
+BAUDRATE = 115200
+OUTPUT_FILE = "blackbox.csv"
+FRAME_SIZE = 52                     # DATALOG_FRAME_SIZE
+MASK_BYTES = (FRAME_SIZE + 7) // 8  # BLACKBOX_MASK_BYTES
+PAGE_SIZE = 256
+HEADER = struct.Struct("<IIII")     # blackbox_page_t
+MAGIC = 0x31584242                  # "BBX1"
+CMD_XD = bytes([0x22, 0x07])
+
+
+class BlackBox():
+
+    def __init__(self) -> None:
+        self.pages = []
+        self.frames = []
+
+    def download(self) -> None:
+        with serial.Serial(port=COMPORT, baudrate=BAUDRATE, timeout=2) as connection:
+            connection.reset_input_buffer()
+            connection.write(CMD_XD)
+            count = struct.unpack("<I", connection.read(4))[0]
+            print(f'Downloading {count} pages from {COMPORT}.')
+            for _ in range(count):
+                page = connection.read(PAGE_SIZE)
+                if len(page) != PAGE_SIZE: break
+                self.pages.append(page)
+
+    def load(self, path:str) -> None:
+        with open(path, "rb") as file:
+            data = file.read()
+        count = struct.unpack("<I", data[:4])[0]
+        self.pages = [data[4 + i * PAGE_SIZE:4 + (i + 1) * PAGE_SIZE] for i in range(count)]
+
+    def decode_page(self, page:bytes) -> None:
+        magic, sequence, timestamp, _ = HEADER.unpack(page[:HEADER.size])
+        if magic != MAGIC: return
+        offset, frame, now = HEADER.size, [0] * FRAME_SIZE, timestamp
+        while offset + 2 + MASK_BYTES <= PAGE_SIZE:
+            dt = page[offset] | (page[offset + 1] << 8)
+            if dt == 0xFFFF: break
+            mask = page[offset + 2:offset + 2 + MASK_BYTES]
+            offset += 2 + MASK_BYTES
+            for i in range(FRAME_SIZE):
+                if mask[i // 8] & (1 << (i % 8)):
+                    frame[i] = page[offset]
+                    offset += 1
+            now += dt
+            self.frames.append((sequence, now, list(frame)))
+
+    def decode(self) -> None:
+        for page in self.pages:
+            self.decode_page(page)
+        with open(OUTPUT_FILE, "w", newline="") as file:
+            writer = csv.writer(file)
+            writer.writerow(["page", "ms"] + [f"b{i}" for i in range(FRAME_SIZE)])
+            for sequence, ms, frame in self.frames:
+                writer.writerow([sequence, ms] + frame)
+        print(f'\033[92m{len(self.frames)} frames written to {OUTPUT_FILE}\033[0m')
+
+
+if __name__ == "__main__":
+    black_box = BlackBox()
+    if len(sys.argv) > 1:
+        black_box.load(sys.argv[1])     # Decode a saved download instead
+    else:
+        black_box.download()
+    black_box.decode()
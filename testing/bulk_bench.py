@@ -0,0 +1,125 @@
+# SPDX-License-Identifier: BSD-3-Clause
+# 
+# Copyright (c) 2025, Dennis B. Lewis
+# All rights reserved.
+#
+# This file is part of the Aetherion-2350 project.
+# Licensed under the BSD 3-Clause License. See LICENSE file for full license text.
+
+import struct
+import sys
+from time import perf_counter
+import serial
+import usb.core
+import usb.util
+
+COMPORT = "COM20"                   # Ostrich (emulation) COMPORT
+BAUDRATE = 115200
+USB_VID = 0x2E8A                    # USBD_VID
+USB_PID = 0x0009                    # USBD_PID
+TUNE_SIZE = 0x8000
+SECTOR = 0x1000
+HEADER = struct.Struct("<BBBBII")   # bulk_header_t
+MAGIC = 0xAE                        # BULK_MAGIC
+BULK_READ, BULK_WRITE, BULK_VERIFY = 0x01, 0x02, 0x03
+STATUS = {0: "ok", 1: "bad request", 2: "bad hash", 3: "no RAM"}
+
+
+def fnv(data:bytes) -> int:
+    value = 0x811C9DC5
+    for byte in data:
+        value = ((value ^ byte) * 0x01000193) & 0xFFFFFFFF
+    return value
+
+
+class BulkLink():
+
+    def __init__(self) -> None:
+        self.device = usb.core.find(idVendor=USB_VID, idProduct=USB_PID)
+        if self.device is None: raise SystemExit("Aetherion not found")
+        config = self.device.get_active_configuration()
+        vendor = usb.util.find_descriptor(config, bInterfaceClass=0xFF)
+        if vendor is None: raise SystemExit("Firmware built without USB_VENDOR_BULK")
+        usb.util.claim_interface(self.device, vendor.bInterfaceNumber)
+        direction = lambda ep: usb.util.endpoint_direction(ep.bEndpointAddress)
+        self.ep_out = usb.util.find_descriptor(vendor, custom_match=lambda ep: direction(ep) == usb.util.ENDPOINT_OUT)
+        self.ep_in = usb.util.find_descriptor(vendor, custom_match=lambda ep: direction(ep) == usb.util.ENDPOINT_IN)
+
+    def request(self, op:int, length:int=0, value:int=0) -> None:
+        self.ep_out.write(HEADER.pack(MAGIC, op, 0, 0, length, value))
+
+    def reply(self, timeout:int=5000) -> tuple:
+        magic, op, status, _, length, value = HEADER.unpack(bytes(self.ep_in.read(HEADER.size, timeout)))
+        if magic != MAGIC: raise SystemExit("Out of step with the device")
+        return status, length, value
+
+    def read_image(self) -> bytes:
+        self.request(BULK_READ)
+        status, length, value = self.reply()
+        if status: raise SystemExit(f'Read failed: {STATUS[status]}')
+        image = bytearray()
+        while len(image) < length:
+            image.extend(self.ep_in.read(SECTOR, 5000))
+        if fnv(image) != value: raise SystemExit("Read image does not match its hash")
+        return bytes(image)
+
+    def write_image(self, image:bytes) -> int:
+        self.request(BULK_WRITE, len(image), fnv(image))
+        self.ep_out.write(image, 5000)
+        return self.reply(10000)[0]     # Flash commit happens before the reply
+
+    def verify_image(self, image:bytes) -> int:
+        self.request(BULK_VERIFY, 0, fnv(image))
+        return self.reply()[0]
+
+
+class OstrichLink():
+
+    def __init__(self) -> None:
+        self.connection = serial.Serial(port=COMPORT, baudrate=BAUDRATE, timeout=2)
+
+    def checksum(self, data:bytes) -> int:
+        return sum(data) % 256
+
+    def read_image(self) -> bytes:
+        image = bytearray()
+        for block in range(TUNE_SIZE // SECTOR):
+            #              Z     R    16   LSB   MSB (0x8000 based)
+            request = [0x5A, 0x52, 0x10, 0x00, 0x80 + block * 0x10]
+            self.connection.write(bytes(request + [self.checksum(request)]))
+            response = self.connection.read(SECTOR + 1)
+            image.extend(response[:SECTOR])
+        return bytes(image)
+
+    def write_image(self, image:bytes) -> bool:
+        for block in range(TUNE_SIZE // SECTOR):
+            #              Z     W    16   LSB   MSB (0x8000 based)
+            request = bytes([0x5A, 0x57, 0x10, 0x00, 0x80 + block * 0x10]) + image[block * SECTOR:(block + 1) * SECTOR]
+            self.connection.write(request + bytes([self.checksum(request)]))
+            if self.connection.read(1) != b'O': return False
+        return True
+
+
+def timed(label:str, work) -> tuple:
+    start = perf_counter()
+    result = work()
+    elapsed = perf_counter() - start
+    print(f'{label:<16}{elapsed * 1000:9.1f} ms{TUNE_SIZE / 1024 / elapsed:9.1f} KB/s')
+    return result, elapsed
+
+
+if __name__ == "__main__":
+    # Reads the emulated tune and writes the same image back over both paths,
+    # the tune is left as it was. Pass "bulk" to skip the Ostrich COMPORT.
+    bulk = BulkLink()
+    image, bulk_read = timed("bulk read", bulk.read_image)
+    status, bulk_write = timed("bulk write", lambda: bulk.write_image(image))
+    if status: raise SystemExit(f'Write failed: {STATUS[status]}')
+    status, _ = timed("bulk verify", lambda: bulk.verify_image(image))
+    print(f'verify: {STATUS[status]}')
+    if len(sys.argv) > 1 and sys.argv[1] == "bulk": raise SystemExit(0)
+    ostrich = OstrichLink()
+    ostrich_image, ostrich_read = timed("ostrich ZR", ostrich.read_image)
+    written, ostrich_write = timed("ostrich ZW", lambda: ostrich.write_image(image))
+    print(f'images match: {ostrich_image == image}, ZW confirmed: {written}')
+    print(f'\033[92mread {ostrich_read / bulk_read:.1f}x, write {ostrich_write / bulk_write:.1f}x faster over bulk\033[0m')
@@ -0,0 +1,86 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+
+/*
+Decode check of the datalog channel table (channels.c) on the host. Built
+next to aetherion-sim (cmake -DAETHERION_HOST_SIM=ON) and run by ctest.
+
+Decodes frames laid out like the bench ECU's
+(testing/data_logging_RP2/lib/abstract.py) and checks every channel
+against its conversion worked out by hand.
+
+Build:  cmake --build build-sim --target channels_test
+Run:    ctest --test-dir build-sim
+*/
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "channels.h"
+#include "datalog.h"
+
+/*
+Structure for a CHECK (one channel of one frame):
+
+    const char* name;
+    uint8_t offset;
+    uint8_t raw[2];
+    int32_t expected;
+
+raw goes to frame[offset] and frame[offset + 1], expected is in
+hundredths of the channel unit.
+*/
+typedef struct {
+    const char* name;
+    uint8_t offset;
+    uint8_t raw[2];
+    int32_t expected;
+} check_t;
+
+static const check_t checks[] = {
+    {"o2",  2,  {40, 0},    78},                                                        // 0.78V, the bench ECU's 40
+    {"o2",  2,  {255, 0},   498},                                                       // 4.98V, top of the ADC
+    {"tps", 5,  {25, 0},    0},                                                         // Closed
+    {"tps", 5,  {229, 0},   10000},                                                     // Wide open
+    {"tps", 5,  {127, 0},   5000},                                                      // Half way
+    {"rpm", 6,  {0x00, 8},  91552},                                                     // 1875000 / 2048, the bench ECU's idle
+    {"rpm", 6,  {0x27, 1},  635593},                                                    // 1875000 / 295
+    {"rpm", 6,  {0, 0},     0},                                                         // Stopped
+    {"vss", 16, {1, 0},     100},                                                       // 1 km/h
+    {"vss", 16, {120, 0},   12000}
+};
+
+int main(){
+    uint32_t failures = 0;
+    for (uint8_t i = 0; i < sizeof(checks) / sizeof(checks[0]); i++){
+        const check_t* check = &checks[i];
+        uint8_t frame[DATALOG_FRAME_SIZE];
+        memset(frame, 0x02, sizeof(frame));                                             // The bench ECU's filler
+        memcpy(frame + check->offset, check->raw, 2);
+        int32_t value;
+        if (!channel_decode(check->name, frame, &value)){
+            fprintf(stderr, "channels_test: no channel %s\n", check->name);
+            failures++;
+        }
+        else if (value != check->expected){
+            fprintf(stderr, "channels_test: %s of %u %u is %ld, expected %ld\n", check->name,
+                    check->raw[0], check->raw[1], (long)value, (long)check->expected);
+            failures++;
+        }
+    }
+    uint8_t frame[DATALOG_FRAME_SIZE] = {0};
+    int32_t value;
+    if (channel_decode("ect", frame, &value)){
+        fprintf(stderr, "channels_test: ect decodes but has no conversion\n");
+        failures++;
+    }
+    if (failures){fprintf(stderr, "channels_test: %u failure(s)\n", (unsigned)failures);}
+    else {printf("channels_test: %u decodes match\n", (unsigned)(sizeof(checks) / sizeof(checks[0])));}
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,102 @@
+# SPDX-License-Identifier: BSD-3-Clause
+#
+# Copyright (c) 2025, Dennis B. Lewis
+# All rights reserved.
+#
+# This file is part of the Aetherion-2350 project.
+# Licensed under the BSD 3-Clause License. See LICENSE file for full license text.
+
+import os
+import re
+import select
+import signal
+import subprocess
+import sys
+import tempfile
+import tty
+from time import perf_counter, sleep
+
+SECONDS = 5.0                       # Load per build
+ROLES = ["emulation", "emulation1", "emulation2"]
+CMD_MM = bytes([0x22, 0x05])        # Developer COMPORT: memory and injection report
+TUNE_SIZE = 0x8000
+
+
+def checksum(data:bytes) -> int:
+    return sum(data) % 256
+
+
+class SimRun():
+
+    def __init__(self, binary:str) -> None:
+        self.folder = tempfile.mkdtemp(prefix="aetherion-bench-")
+        environment = dict(os.environ, AETHERION_SIM_DIR=self.folder,
+                           AETHERION_FLASH=os.path.join(self.folder, "flash.bin"))
+        self.process = subprocess.Popen([binary], env=environment, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE)
+        while not os.path.exists(os.path.join(self.folder, "developer")): sleep(0.05)
+        sleep(0.5)
+        self.ports = [self.open(role) for role in ROLES if os.path.exists(os.path.join(self.folder, role))]
+        self.developer = self.open("developer")
+        self.read(self.developer, 0.5)                      # Boot memory report
+
+    def open(self, role:str) -> int:
+        port = os.open(os.path.join(self.folder, role), os.O_RDWR | os.O_NOCTTY)
+        tty.setraw(port)
+        return port
+
+    def read(self, port:int, timeout:float, until:bytes=None) -> bytes:
+        data = b''
+        while select.select([port], [], [], timeout)[0]:
+            data += os.read(port, 65536)
+            if until and data.endswith(until): break
+        return data
+
+    def write_16(self, port:int, offset:int) -> None:
+        #              W    16   MSB   LSB (0x8000 based)
+        request = bytes([0x57, 0x10, 0x80 + (offset >> 8), offset & 0xF0]) + bytes(range(16))
+        os.write(port, request + bytes([checksum(request)]))
+
+    def load(self, seconds:float) -> int:
+        # Every W ends with a full 32kb injection of that context (upload_count stays 0),
+        # so keeping a W in flight on every emulation COMPORT keeps core 1 busy on all of them.
+        confirms = 0
+        start = perf_counter()
+        while perf_counter() - start < seconds:
+            for port in self.ports: self.write_16(port, confirms % 0x80 * 0x100)
+            for port in self.ports: confirms += self.read(port, 1.0, b'O').count(b'O')
+        return confirms
+
+    def report(self) -> list:
+        os.write(self.developer, CMD_MM)
+        text = self.read(self.developer, 1.0).decode(errors="replace")
+        times = [int(value) for value in re.findall(r"ast 32kb injection \(us\): (\d+)", text)]
+        return times[-len(self.ports):]                     # The boot report may still be in there
+
+    def stop(self) -> str:
+        self.process.send_signal(signal.SIGINT)
+        return self.process.communicate(timeout=10)[1].decode(errors="replace")
+
+
+def bench(binary:str) -> None:
+    run = SimRun(binary)
+    confirms = run.load(SECONDS)
+    times = run.report()
+    exit_report = run.stop()
+    words = [int(count) for count in re.findall(r"pio\d sm0 (\d+) words injected", exit_report)]
+    contexts = len(run.ports)
+    print(f'{contexts} context(s), {confirms} W confirmed in {SECONDS:.0f}s')
+    for index in range(contexts):
+        injected = words[index] if index < len(words) else 0
+        last = times[index] if index < len(times) else 0
+        rate = (TUNE_SIZE / 1024) / (last / 1e6) if last else 0.0
+        print(f'  context {index}: {injected / SECONDS / 1024:9.1f} KB/s injected, last 32kb in {last / 1000:7.1f} ms ({rate:6.1f} KB/s)')
+    total = sum(words[:contexts])
+    print(f'  total:     {total / SECONDS / 1024:9.1f} KB/s')
+
+
+if __name__ == "__main__":
+    # Pass aetherion-sim binaries built with -DEMULATION_CONTEXTS=1, 2 and 3 (see README),
+    # each one is loaded on every emulation COMPORT it has for SECONDS.
+    if len(sys.argv) < 2: raise SystemExit("usage: context_bench.py <aetherion-sim> [<aetherion-sim> ...]")
+    for binary in sys.argv[1:]:
+        bench(binary)
@@ -7,7 +7,9 @@
 # Licensed under the BSD 3-Clause License. See LICENSE file for full license text.
 
 import os
+import re
 import shutil
+import struct
 from time import sleep, time
 import serial
 import customtkinter as ctk
@@ -16,7 +18,9 @@ import serial
 
 OUTPUT_FILE = "tune_file.bin"
 COMPORT = "COM20"
+DEVELOPER_COMPORT = "COM19"
 BAUDRATE = 115200
+STATS_H = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "src", "stats.h")
 
 class DownloadBin():
 
@@ -54,6 +58,43 @@ class DownloadBin():
             print(f'\033[92mData written to {os.getcwd()}\\{OUTPUT_FILE}\033[0m')
 
 
+class Statistics():
+
+    def __init__(self) -> None:
+        # Field order and labels come from the STATS_FIELDS X-macro, same as the firmware.
+        with open(STATS_H) as file:
+            self.fields = re.findall(r'X\((STAT_\w+),\s*"([^"]*)"\)', file.read())
+        self.header = struct.Struct("<2sBBI")        # "ST", version, count, window ms
+
+    def request(self, reset:bool=False) -> tuple:
+        with serial.Serial(port=DEVELOPER_COMPORT, baudrate=BAUDRATE, timeout=1) as connection:
+            connection.reset_input_buffer()
+            connection.write(bytes([0x2B, 0x01 if reset else 0x00]))     # CMD_SN
+            data = connection.read(self.header.size)
+            while len(data) == self.header.size and data[:2] != b'ST':   # Skip anything that was still on the port
+                data = data[1:] + connection.read(1)
+            if len(data) != self.header.size: raise TimeoutError("no statistics snapshot")
+            _, version, count, window = self.header.unpack(data)
+            data += connection.read(count * 4 + 1)
+        if len(data) != self.header.size + count * 4 + 1 or sum(data[:-1]) % 256 != data[-1]:
+            raise ValueError("statistics snapshot damaged")
+        values = struct.unpack_from(f"<{count}I", data, self.header.size)
+        return version, window, values
+
+    def show(self, reset:bool=False) -> None:
+        try:
+            version, window, values = self.request(reset)
+        except (serial.SerialException, TimeoutError, ValueError) as e:
+            print(f'\033[91m{e}\nIs {DEVELOPER_COMPORT} free and DEVELOPER_CONSOLE on?\033[0m')
+            return
+        print(f'Statistics v{version} over {window / 1000:.1f}s' + (' (now reset)' if reset else ''))
+        for index, value in enumerate(values):
+            label = self.fields[index][1] if index < len(self.fields) else f'field {index}'   # Newer firmware
+            print(f'  {label:<60}{value:>12}')
+            if index < len(self.fields) and self.fields[index][0] == "STAT_CORE1_BUSY_MS" and window:
+                print(f'  {"core 1 busy / idle (%)":<60}{100 * value / window:>6.1f} / {100 - 100 * value / window:.1f}')
+
+
 class CleanBuild:
 
     def __init__(self):
@@ -172,10 +213,11 @@ class FirmwareUploader(ctk.CTk):
         super().__init__()
         self.firmware = CleanBuild()
         self.tune_download = DownloadBin()
+        self.statistics = Statistics()
         self.home_directory = os.getcwd()
         self.build_directory = f'{self.home_directory}/build'
         self.title('Deploy UF2')
-        self.geometry('300x200')
+        self.geometry('300x260')
         theme_color = '#1ee89b'
         hover_color = '#70fac6'
         text_color = '#206b4f'
@@ -239,6 +281,26 @@ class FirmwareUploader(ctk.CTk):
                                            border_color='black')
         self.download_button.pack(expand=True, fill='both')
 
+        self.statistics_button = ctk.CTkButton(self, text='Statistics',
+                                           command=self.show_statistics,
+                                           fg_color=theme_color,
+                                           corner_radius=0,
+                                           text_color=text_color,
+                                           hover_color=hover_color,
+                                           border_width=1,
+                                           border_color='black')
+        self.statistics_button.pack(expand=True, fill='both')
+
+        self.reset_statistics_button = ctk.CTkButton(self, text='Reset Statistics',
+                                           command=self.reset_statistics,
+                                           fg_color=theme_color,
+                                           corner_radius=0,
+                                           text_color=text_color,
+                                           hover_color=hover_color,
+                                           border_width=1,
+                                           border_color='black')
+        self.reset_statistics_button.pack(expand=True, fill='both')
+
     def upload_firmware(self):
         thread = threading.Thread(target=self.firmware.upload, daemon=True)
         thread.start()
@@ -251,6 +313,12 @@ class FirmwareUploader(ctk.CTk):
         thread = threading.Thread(target=self.firmware.reuse_build, daemon=True)
         thread.start()
 
+    def show_statistics(self):
+        self.statistics.show()
+
+    def reset_statistics(self):
+        self.statistics.show(reset=True)
+
     def download_tune(self):
         try:
             self.tune_download.request_data()
@@ -0,0 +1,369 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+
+/*
+Host side ECU stand-in for the datalog link, replaces the CircuitPython
+script in data_logging_RP2 when there is no second board around. Speaks
+the same request set on a PTY (default) or a real serial port wired to
+uart0 and paces every byte like a 38400 baud 8N1 line:
+
+    0x10 0x00   answers 0xCD (ready)
+    0x20 0x00   answers a 52 byte frame (last byte is the sum of the others)
+    0x50 0x00   answers 0x50
+
+Frames are generated from a seed (same seed, same run) or replayed from a
+CSV written by blackbox_decode.py, keeping the recorded frame timing.
+Faults are injected from the same seed: short frames, bad sums and stalls.
+On exit it reports what the bridge under test managed: frames/s and the
+worst gap between the end of an answer and the next request.
+
+Build:  cmake --build build-sim --target ecu_sim (or cc -O2 -o ecu_sim testing/ecu_sim.c)
+Run:    ./build-sim/ecu_sim -t 60 -S 2 -B 1 -X 1
+        ./build-sim/ecu_sim -d /dev/ttyUSB0 -r blackbox.csv
+
+    -d <device>   serial port to use instead of a PTY
+    -r <csv>      replay frames from a blackbox_decode.py CSV
+    -s <seed>     seed for frames and faults (default 1)
+    -t <seconds>  stop and report after this long (default: until Ctrl+C)
+    -a <us>       ECU turnaround before the first byte (default 1000)
+    -S <percent>  short frames (cut off somewhere in the middle)
+    -B <percent>  bad sums
+    -X <percent>  stalls (no answer at all)
+*/
+#define _XOPEN_SOURCE 600
+#define _DEFAULT_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#define FRAME_SIZE      (52u)           // DATALOG_FRAME_SIZE
+#define BAUD_RATE       (38400u)        // DATALOG_BAUD_RATE
+#define BYTE_NS         (10000000000ull / BAUD_RATE)  // Start + 8 data + stop bits
+#define MAX_FRAMES      (200000u)       // Replay frames kept in memory
+#define RESYNC_MS       (20)            // A lone byte this old is dropped
+
+/*
+Structure for a REPLAY FRAME:
+
+    uint64_t ms;
+    uint8_t frame[FRAME_SIZE];
+
+ms is the recorded time of the frame, relative to the first one.
+*/
+typedef struct {
+    uint64_t ms;
+    uint8_t frame[FRAME_SIZE];
+} replay_t;
+
+/*
+Structure for the SIMULATOR STATISTICS:
+
+    uint64_t requests;
+    uint64_t frames;
+    uint64_t short_frames;
+    uint64_t bad_sums;
+    uint64_t stalls;
+    uint64_t unknown;
+    uint64_t gap_max;
+    uint64_t gap_sum;
+    uint64_t gaps;
+
+gap is the time in ns from the last byte of an answer to the first
+byte of the next request, the turnaround of the bridge under test.
+*/
+typedef struct {
+    uint64_t requests;
+    uint64_t frames;
+    uint64_t short_frames;
+    uint64_t bad_sums;
+    uint64_t stalls;
+    uint64_t unknown;
+    uint64_t gap_max;
+    uint64_t gap_sum;
+    uint64_t gaps;
+} sim_stats_t;
+
+static replay_t* replay;                                                                // Frames from the CSV (NULL = generate)
+static size_t replay_count;                                                             // How many were loaded
+static uint32_t rng_state = 1;                                                          // Seeded generator state
+static sim_stats_t stats;                                                               // What the run did
+static volatile sig_atomic_t stop;                                                      // Ctrl+C
+static uint64_t started;                                                                // When the first request came in (ns)
+static uint64_t answered;                                                               // When the last answer byte went out (ns)
+static int fault_short, fault_bad, fault_stall;                                         // Fault percentages
+static uint32_t turnaround_us = 1000;                                                   // ECU think time
+
+/*
+Returns the monotonic clock in ns.
+*/
+static uint64_t now_ns(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000u) + (uint64_t)ts.tv_nsec;
+}
+
+/*
+Sleeps until an absolute monotonic time in ns.
+*/
+static void sleep_until(uint64_t deadline){
+    struct timespec ts = {.tv_sec = deadline / 1000000000u, .tv_nsec = deadline % 1000000000u};
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR && !stop){}
+}
+
+/*
+xorshift32, small and the same on every host.
+*/
+static uint32_t rng(){
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+/*
+Returns true percent% of the time.
+*/
+static bool chance(int percent){
+    return percent > 0 && (int)(rng() % 100) < percent;
+}
+
+/*
+Generates a frame like data_logging_RP2/lib/abstract.py does, from the seed.
+*/
+static void generate_frame(uint8_t* frame){
+    uint8_t rpm_graph = 2 + (rng() % 2);
+    uint8_t vacuum = rpm_graph - 2;
+    memset(frame, 0x02, FRAME_SIZE);                                                    // Unknown bytes
+    frame[0] = 128 + (rng() % 2);                                                       // Engine coolant temp
+    frame[1] = 125 + (rng() % 4);                                                       // Air intake temp
+    frame[2] = 40 + (rng() % 2);                                                        // Air fuel ratio
+    frame[4] = 6 + vacuum;                                                              // Mass air flow
+    frame[5] = 0x00;                                                                    // Throttle position sensor
+    frame[6] = 0x00;                                                                    // Bar graph RPM
+    frame[7] = rpm_graph + 6;
+    frame[8] = 0x00;                                                                    // Fuel cut flag
+    frame[9] = rpm_graph;                                                               // RPM (graph)
+    frame[10] = 0x00;
+    frame[11] = vacuum;                                                                 // Vacuum amount hg
+    memset(&frame[12], 0x00, 4);                                                        // O2, cam and CEL flags
+    frame[16] = rng() % 2;                                                              // Vehicle speed sensor
+    frame[17] = !vacuum;                                                                // Injector value
+    frame[18] = vacuum * 8;                                                             // Injector duty
+    frame[19] = 96 + (uint8_t)((666 * rpm_graph) / 100);                                // Ignition degrees
+    frame[22] = frame[23] = 0x00;                                                       // Fuel pressure and MIL flags
+    frame[38] = 0x00;                                                                   // FTL flag
+}
+
+/*
+Picks the replay frame that was current at elapsed ms, looping the recording.
+*/
+static const uint8_t* replay_frame(uint64_t elapsed_ms){
+    uint64_t length = replay[replay_count - 1].ms + 1;                                  // Recording length
+    uint64_t at = elapsed_ms % length;
+    size_t low = 0, high = replay_count - 1;
+    while (low < high){                                                                 // Last frame at or before 'at'
+        size_t middle = (low + high + 1) / 2;
+        if (replay[middle].ms <= at){low = middle;} else {high = middle - 1;}
+    }
+    return replay[low].frame;
+}
+
+/*
+Loads a CSV written by blackbox_decode.py (page, ms, b0..b51).
+Returns false if nothing usable was in it.
+*/
+static bool replay_load(const char* path){
+    FILE* file = fopen(path, "r");
+    if (!file){perror(path); return false;}
+    replay = calloc(MAX_FRAMES, sizeof(replay_t));
+    char line[1024];
+    uint64_t first = 0;
+    while (replay && replay_count < MAX_FRAMES && fgets(line, sizeof(line), file)){
+        char* field = strtok(line, ",");                                                // page
+        if (!field || !strcmp(field, "page")){continue;}                                // Header row
+        field = strtok(NULL, ",");                                                      // ms
+        if (!field){continue;}
+        uint64_t ms = strtoull(field, NULL, 10);
+        replay_t* entry = &replay[replay_count];
+        size_t i = 0;
+        while (i < FRAME_SIZE && (field = strtok(NULL, ",\r\n"))){entry->frame[i++] = (uint8_t)atoi(field);}
+        if (i != FRAME_SIZE){continue;}                                                 // Cut off row
+        if (!replay_count){first = ms;}
+        entry->ms = (ms >= first) ? ms - first : 0;
+        if (replay_count && entry->ms < replay[replay_count - 1].ms){entry->ms = replay[replay_count - 1].ms;}
+        replay_count++;
+    }
+    fclose(file);
+    if (!replay_count){fprintf(stderr, "%s: no frames\n", path); return false;}
+    fprintf(stderr, "Replaying %zu frames (%llu ms)\n", replay_count,
+            (unsigned long long)replay[replay_count - 1].ms);
+    return true;
+}
+
+/*
+Writes bytes one at a time at line speed.
+*/
+static void line_write(int fd, const uint8_t* bytes, size_t length){
+    uint64_t due = now_ns();
+    for (size_t i = 0; i < length && !stop; i++){
+        due += BYTE_NS;                                                                 // One character time per byte
+        if (write(fd, &bytes[i], 1) != 1 && errno != EAGAIN){perror("write"); stop = 1;}
+        sleep_until(due);
+    }
+    answered = now_ns();
+}
+
+/*
+Answers a datalog read, injecting faults as configured.
+*/
+static void answer_frame(int fd){
+    uint8_t frame[FRAME_SIZE];
+    if (chance(fault_stall)){stats.stalls++; answered = now_ns(); return;}              // ECU says nothing
+    if (replay){memcpy(frame, replay_frame((now_ns() - started) / 1000000), FRAME_SIZE);}
+    else {generate_frame(frame);}
+    uint8_t sum = 0;
+    for (size_t i = 0; i < FRAME_SIZE - 1; i++){sum += frame[i];}
+    frame[FRAME_SIZE - 1] = sum;                                                        // Same sum as the firmware checks
+    if (chance(fault_bad)){frame[FRAME_SIZE - 1] ^= 0x5A; stats.bad_sums++;}
+    size_t length = FRAME_SIZE;
+    if (chance(fault_short)){length = 1 + (rng() % (FRAME_SIZE - 1)); stats.short_frames++;}
+    line_write(fd, frame, length);
+    stats.frames++;
+}
+
+/*
+Handles one 2 byte request. Returns false if it was not one we know.
+*/
+static bool handle_request(int fd, const uint8_t* request, uint64_t arrived){
+    uint16_t key = (uint16_t)((request[0] << 8) | request[1]);
+    if (key != 0x1000 && key != 0x2000 && key != 0x5000){return false;}
+    if (!started){started = arrived;}
+    if (answered){                                                                      // Bridge turnaround
+        uint64_t gap = arrived - answered;
+        if (gap > stats.gap_max){stats.gap_max = gap;}
+        stats.gap_sum += gap;
+        stats.gaps++;
+    }
+    stats.requests++;
+    sleep_until(arrived + ((uint64_t)turnaround_us * 1000));                            // ECU think time
+    if (key == 0x1000){uint8_t ready = 0xCD; line_write(fd, &ready, 1);}
+    if (key == 0x5000){uint8_t ready = 0x50; line_write(fd, &ready, 1);}
+    if (key == 0x2000){answer_frame(fd);}
+    return true;
+}
+
+/*
+Opens the serial port raw at 38400 8N1, or a new PTY if device is NULL.
+*/
+static int line_open(const char* device){
+    int fd;
+    if (device){fd = open(device, O_RDWR | O_NOCTTY);}
+    else {
+        fd = posix_openpt(O_RDWR | O_NOCTTY);
+        if (fd >= 0 && (grantpt(fd) || unlockpt(fd))){close(fd); fd = -1;}
+    }
+    if (fd < 0){perror(device ? device : "posix_openpt"); return -1;}
+    struct termios tio;
+    if (!tcgetattr(fd, &tio)){
+        cfmakeraw(&tio);
+        cfsetispeed(&tio, B38400);
+        cfsetospeed(&tio, B38400);
+        tio.c_cflag |= CLOCAL | CREAD;
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+    if (!device){fprintf(stderr, "ECU on %s\n", ptsname(fd));}
+    return fd;
+}
+
+/*
+Prints what the bridge under test managed.
+*/
+static void report(){
+    double seconds = (started && answered > started) ? (double)(answered - started) / 1e9 : 0.0;  // First request to last answer
+    printf("requests       %llu\n", (unsigned long long)stats.requests);
+    printf("frames         %llu\n", (unsigned long long)stats.frames);
+    printf("frames/s       %.1f\n", (seconds > 0) ? (double)stats.frames / seconds : 0.0);
+    printf("short frames   %llu\n", (unsigned long long)stats.short_frames);
+    printf("bad sums       %llu\n", (unsigned long long)stats.bad_sums);
+    printf("stalls         %llu\n", (unsigned long long)stats.stalls);
+    printf("unknown bytes  %llu\n", (unsigned long long)stats.unknown);
+    if (stats.gaps){
+        printf("gap mean (us)  %.1f\n", (double)stats.gap_sum / (double)stats.gaps / 1000.0);
+        printf("gap max (us)   %.1f\n", (double)stats.gap_max / 1000.0);
+    }
+}
+
+static void on_signal(int signal){
+    stop = 1;
+}
+
+int main(int argc, char** argv){
+    const char* device = NULL;
+    const char* csv = NULL;
+    int seconds = 0;
+    int option;
+    while ((option = getopt(argc, argv, "d:r:s:t:a:S:B:X:")) != -1){
+        switch (option){
+            case 'd': device = optarg; break;
+            case 'r': csv = optarg; break;
+            case 's': rng_state = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 't': seconds = atoi(optarg); break;
+            case 'a': turnaround_us = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'S': fault_short = atoi(optarg); break;
+            case 'B': fault_bad = atoi(optarg); break;
+            case 'X': fault_stall = atoi(optarg); break;
+            default:
+                fprintf(stderr, "usage: %s [-d device] [-r csv] [-s seed] [-t seconds] [-a us] [-S %%] [-B %%] [-X %%]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (!rng_state){rng_state = 1;}                                                     // xorshift never leaves zero
+    if (csv && !replay_load(csv)){return 1;}
+    int fd = line_open(device);
+    if (fd < 0){return 1;}
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    uint64_t finish = (seconds > 0) ? now_ns() + ((uint64_t)seconds * 1000000000u) : 0;
+    uint8_t request[2];
+    size_t have = 0;
+    uint64_t first_byte = 0;                                                            // When request[0] arrived
+    while (!stop && (!finish || now_ns() < finish)){
+        struct pollfd fds = {.fd = fd, .events = POLLIN};
+        if (poll(&fds, 1, 10) <= 0){                                                    // Nothing yet
+            if (have && now_ns() - first_byte > (uint64_t)RESYNC_MS * 1000000){have = 0; stats.unknown++;}
+            continue;
+        }
+        if (fds.revents & POLLHUP){usleep(10000); continue;}                            // PTY with nobody on the other end
+        uint8_t byte;
+        if (read(fd, &byte, 1) != 1){continue;}
+        if (!have){first_byte = now_ns();}
+        request[have++] = byte;
+        if (have < 2){continue;}
+        have = 0;
+        if (!handle_request(fd, request, first_byte)){                                  // Out of step, slide by one byte
+            request[0] = request[1];
+            have = 1;
+            stats.unknown++;
+        }
+    }
+    report();
+    close(fd);
+    free(replay);
+    return 0;
+}
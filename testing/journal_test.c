@@ -0,0 +1,150 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+
+/*
+Power loss test of the A/B commit journal (flash_memory.c) on the host.
+Built next to aetherion-sim (cmake -DAETHERION_HOST_SIM=ON) and run by
+ctest. Flash is the sim's file backed image (AETHERION_FLASH).
+
+A tune sector commit is erase, program, record and seal. The test commits
+a new image over an old one and cuts the power after the 1st, 2nd, ...
+flash operation (sim_flash_cut()) until the commit gets through uncut.
+After every cut it boots (flash_commits_init()) and checks:
+
+    - the sector is the old image until the seal, the new one after it
+    - the other sectors of the bank are untouched
+    - the journal still takes a commit and boots into it
+
+The same runs once more with a full journal, so the cuts also land in
+every step of the compaction the commit starts with.
+
+Build:  cmake --build build-sim --target journal_test
+Run:    ctest --test-dir build-sim
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include "pico/stdlib.h"
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+#include "flash_memory.h"
+#include "sim.h"
+
+#define TEST_BANK           (1u)            // Bank the commits go to
+#define TEST_SECTOR         (5u)            // Sector that is cut while committing
+#define TEST_NEIGHBOUR      (2u)            // Sector that must never change
+#define JOURNAL_RECORDS     (FLASH_SECTOR_SIZE / sizeof(commit_record_t))
+
+static uint8_t images[3][FLASH_SECTOR_SIZE];                                            // Old, new and the commit after the cut
+static uint8_t* snapshot;                                                               // Flash before the commit that gets cut
+static jmp_buf power;                                                                   // Where a power cut lands
+static uint32_t failures;
+
+/*
+Called by sim_flash.c in place of the rest of the commit.
+*/
+static void power_cut(){
+    longjmp(power, 1);
+}
+
+/*
+Returns 0 for the old image, 1 for the new one and -1 for anything else.
+*/
+static int8_t which_image(uint8_t bank, uint8_t sector){
+    const uint8_t* data = flash_sector(bank, sector);
+    if (!memcmp(data, images[0], FLASH_SECTOR_SIZE)){return 0;}
+    if (!memcmp(data, images[1], FLASH_SECTOR_SIZE)){return 1;}
+    return -1;
+}
+
+/*
+Prints a failure and counts it.
+*/
+static void fail(const char* scenario, uint32_t step, const char* what){
+    fprintf(stderr, "journal_test: %s, cut after operation %u: %s\n", scenario, (unsigned)step, what);
+    failures++;
+}
+
+/*
+Erases the bank, commits the old image to the test sectors and then
+records more commits until fill records of the journal are used.
+*/
+static void prepare(uint16_t fill){
+    memset((uint8_t *)XIP_BASE, 0xFF, PICO_FLASH_SIZE_BYTES);                           // A blank chip
+    flash_commits_init();                                                               // Fresh journals, header in record 0
+    save_sector(TEST_BANK, TEST_SECTOR, images[0]);
+    save_sector(TEST_BANK, TEST_NEIGHBOUR, images[0]);
+    for (uint16_t used = 3; used < fill; used++){                                       // Records 0-2 are the header and the two above
+        save_sector(TEST_BANK, TEST_NEIGHBOUR, images[0]);
+    }
+    memcpy(snapshot, (const uint8_t *)XIP_BASE, PICO_FLASH_SIZE_BYTES);
+}
+
+/*
+Commits the new image with the power cut after step operations.
+Returns true if the commit finished before the cut.
+*/
+static bool cut_commit(uint32_t step){
+    memcpy((uint8_t *)XIP_BASE, snapshot, PICO_FLASH_SIZE_BYTES);                       // Same flash every time
+    flash_commits_init();                                                               // Boot
+    sim_flash_cut(step, power_cut);
+    if (setjmp(power)){
+        restore_interrupts(0);                                                          // The cut hit inside the flash hold
+        return false;
+    }
+    save_sector(TEST_BANK, TEST_SECTOR, images[1]);
+    sim_flash_cut(0, NULL);
+    return true;
+}
+
+/*
+Cuts a commit after every flash operation in turn. fill is how many
+records of the journal are used before the commit.
+*/
+static void run_scenario(const char* scenario, uint16_t fill){
+    int8_t seen[2 * JOURNAL_RECORDS];                                                   // Image found after each cut
+    uint32_t step = 1;
+    prepare(fill);
+    for (; !cut_commit(step); step++){
+        if (step >= sizeof(seen)){panic("%s: the commit never finishes", scenario);}
+        flash_commits_init();                                                           // Boot after the power cut
+        seen[step] = which_image(TEST_BANK, TEST_SECTOR);
+        if (seen[step] < 0){fail(scenario, step, "neither the old nor the new image");}
+        if (which_image(TEST_BANK, TEST_NEIGHBOUR)){fail(scenario, step, "another sector changed");}
+        save_sector(TEST_BANK, TEST_SECTOR, images[2]);                                 // The journal must still work
+        flash_commits_init();
+        if (memcmp(flash_sector(TEST_BANK, TEST_SECTOR), images[2], FLASH_SECTOR_SIZE)){
+            fail(scenario, step, "the next commit did not survive a boot");
+        }
+    }
+    uint32_t operations = step - 1;                                                     // The last cut came right after the seal
+    if (operations < 4){fail(scenario, operations, "fewer than erase, program, record and seal");}
+    for (step = 1; step <= operations; step++){                                         // Old until the seal, new from the seal on
+        if (seen[step] >= 0 && seen[step] != (step == operations)){
+            fail(scenario, step, (step == operations) ? "sealed commit lost" : "commit visible before its seal");
+        }
+    }
+    printf("%s: old image after cuts 1-%u, new image after cut %u (the seal)\n", scenario, (unsigned)operations - 1, (unsigned)operations);
+}
+
+int main(){
+    snapshot = malloc(PICO_FLASH_SIZE_BYTES);
+    if (!snapshot){panic("no memory for a flash snapshot");}
+    for (uint32_t i = 0; i < FLASH_SECTOR_SIZE; i++){
+        images[0][i] = (uint8_t)i;
+        images[1][i] = (uint8_t)(i * 7 + 1);
+        images[2][i] = (uint8_t)(i ^ 0x5A);
+    }
+    run_scenario("journal with room", 3);
+    run_scenario("full journal", JOURNAL_RECORDS);
+    if (failures){fprintf(stderr, "journal_test: %u failure(s)\n", (unsigned)failures);}
+    return failures ? 1 : 0;
+}
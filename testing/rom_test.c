@@ -0,0 +1,99 @@
+/*
+*        SPDX-License-Identifier: BSD-3-Clause
+*
+*        Copyright (c) 2025, Dennis B. Lewis
+*        All rights reserved.
+*        This file contains modifications to software originally licensed under the
+*        BSD-3-Clause license by the Raspberry Pi Foundation.
+*        See LEGAL.TXT in the root directory of this project for more details.
+*/
+
+/*
+Boot test of ROM emulation (rom_emulation.h) on the host. Built next to
+aetherion-sim (cmake -DAETHERION_HOST_SIM=ON) with ROM_EMULATION 1 and run
+by ctest with the ECU on the bus (AETHERION_ECU_DUTY, sim/sim_bus.c).
+
+A tune is stored in flash, then the board boots the way main() does but
+no host ever connects. The ECU has to read that tune from the first bus
+cycle on: every byte it latches (sim_bus_latched()) is checked against
+the stored one.
+
+Build:  cmake --build build-sim --target rom_test
+Run:    ctest --test-dir build-sim
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "contexts.h"
+#include "mutexes.h"
+#include "flash_memory.h"
+#include "tune_shadow.h"
+#include "revisions.h"
+#include "injection.h"
+#include "rom_emulation.h"
+#include "sim.h"
+
+#define TEST_READS          (2000u)         // Distinct addresses the ECU has to read
+#define TEST_TIMEOUT_MS     (20000u)        // Longest the ECU gets for them
+
+static uint8_t tune[TUNE_SIZE];                                                         // What is stored in flash
+static uint32_t* owner;
+
+/*
+Plays core 0's part of the keep alive handshake so core 1 stays in its loop.
+*/
+static void keep_alive(){
+    while (1){
+        if (mutex_try_enter(&contexts[0].ostrich_usb.data_flag, owner)){
+            contexts[0].ostrich_usb.keep_alive = false;
+            mutex_exit(&contexts[0].ostrich_usb.data_flag);
+            break;
+        }
+    }
+}
+
+/*
+Counts the addresses the ECU has read so far and the ones that did not
+give the stored tune byte.
+*/
+static uint32_t check(uint32_t* wrong){
+    uint32_t reads = 0;
+    *wrong = 0;
+    for (uint32_t address = 0; address < TUNE_SIZE; address++){
+        int16_t latched = sim_bus_latched((uint16_t)address);
+        if (latched < 0){continue;}
+        reads++;
+        if (latched != tune[address]){
+            if (!*wrong){fprintf(stderr, "rom_test: ECU read 0x%02X at 0x%04X, the tune has 0x%02X\n", latched, (unsigned)address, tune[address]);}
+            (*wrong)++;
+        }
+    }
+    return reads;
+}
+
+int main(){
+    if (!ROM_EMULATION){panic("rom_test has to be built with ROM_EMULATION 1");}
+    for (uint32_t i = 0; i < TUNE_SIZE; i++){tune[i] = (uint8_t)((i * 13) ^ (i >> 7) ^ 0xA5);}
+    contexts_init();
+    mutexes_init();
+    flash_commits_init();
+    for (uint8_t sector = 0; sector < TUNE_SECTORS; sector++){
+        save_sector(contexts[0].persist_bank, sector, tune + (sector * TUNE_SECTOR_SIZE));  // Stored by an earlier session
+    }
+    flash_commits_init();                                                               // Power cycle
+    revisions_init();
+    shadow_init(&contexts[0].shadow, contexts[0].persist_bank);
+    multicore_launch_core1(inject_memory);                                              // No host, nothing sets connected
+    uint32_t reads = 0;
+    uint32_t wrong = 0;
+    for (uint32_t waited = 0; waited < TEST_TIMEOUT_MS && reads < TEST_READS; waited += 10){
+        sleep_ms(10);
+        keep_alive();
+        reads = check(&wrong);
+    }
+    printf("rom_test: ECU read %u addresses after boot, %u not the stored tune\n", (unsigned)reads, (unsigned)wrong);
+    if (reads < TEST_READS){fprintf(stderr, "rom_test: the ECU read only %u addresses in %ums\n", (unsigned)reads, (unsigned)TEST_TIMEOUT_MS);}
+    return (wrong || reads < TEST_READS) ? 1 : 0;
+}
@@ -0,0 +1,92 @@
+# SPDX-License-Identifier: BSD-3-Clause
+#
+# Copyright (c) 2025, Dennis B. Lewis
+# All rights reserved.
+#
+# This file is part of the Aetherion-2350 project.
+# Licensed under the BSD 3-Clause License. See LICENSE file for full license text.
+
+import os
+import re
+import struct
+import sys
+import serial
+
+COMPORT = "COM19"                   # Developer COMPORT
+BAUDRATE = 115200
+TRACE_H = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "src", "trace.h")
+SYNC = 0xFE                         # TRACE_SYNC
+HEADER = 4                          # TRACE_HEADER
+RECORD = struct.Struct("<IHHI")     # trace_record_t
+CMD_TD = bytes([0x22, 0x0E])
+CMD_TS_ON = bytes([0x2A, 0x01])
+CMD_TS_OFF = bytes([0x2A, 0x00])
+
+
+def trace_events(path:str) -> list:
+    # Event ids are the order of the TRACE_EVENTS X-macro, the text is right next to them.
+    with open(path) as file:
+        return re.findall(r'X\((TRACE_\w+),\s*"((?:[^"\\]|\\.)*)"\)', file.read())
+
+
+class TraceDecoder():
+
+    def __init__(self) -> None:
+        self.events = trace_events(TRACE_H)
+        self.buffer = b''
+
+    def render(self, kind:str, core:int, record:tuple) -> str:
+        time, event, a, b = record
+        source = f'{time / 1000:12.3f}ms core {core}' + (" (dump)" if kind == 'D' else "")
+        if event >= len(self.events): return f'{source} unknown event {event} a={a} b={b}'
+        return f'{source} {self.events[event][1].format(a=a, b=b)}'
+
+    def feed(self, data:bytes) -> list:
+        # Text lines pass through as they are, frames are cut out from between them.
+        self.buffer += data
+        lines = []
+        while self.buffer:
+            sync = self.buffer.find(bytes([SYNC]))
+            if sync:
+                text = self.buffer if sync < 0 else self.buffer[:sync]
+                cut = text.rfind(b'\n') + 1 if sync < 0 else len(text)
+                if not cut: break                               # Wait for the rest of the line
+                lines += [line for line in text[:cut].decode(errors="replace").splitlines() if line]
+                self.buffer = self.buffer[cut:]
+                continue
+            if len(self.buffer) < HEADER: break
+            kind, core, count = chr(self.buffer[1]), self.buffer[2], self.buffer[3]
+            size = HEADER + count * RECORD.size
+            if len(self.buffer) < size: break
+            for i in range(count):
+                lines.append(self.render(kind, core, RECORD.unpack_from(self.buffer, HEADER + i * RECORD.size)))
+            self.buffer = self.buffer[size:]
+        return lines
+
+
+def run(port:str, dump:bool) -> None:
+    decoder = TraceDecoder()
+    with serial.Serial(port=port, baudrate=BAUDRATE, timeout=0.2) as connection:
+        connection.reset_input_buffer()
+        connection.write(CMD_TD if dump else CMD_TS_ON)
+        quiet = 0
+        try:
+            while not dump or quiet < 5:                        # A dump is over once the port goes quiet
+                data = connection.read(4096)
+                quiet = 0 if data else quiet + 1
+                for line in decoder.feed(data): print(line)
+        except KeyboardInterrupt:
+            pass
+        if not dump: connection.write(CMD_TS_OFF)
+
+
+if __name__ == "__main__":
+    # trace_decode.py [COMPORT or capture file] [dump]
+    # Streams the trace rings until Ctrl+C, or with "dump" prints the newest records of both cores.
+    # A capture file (raw bytes saved off the developer COMPORT) is decoded as is.
+    target = sys.argv[1] if len(sys.argv) > 1 else COMPORT
+    if os.path.isfile(target):
+        with open(target, "rb") as file:
+            for line in TraceDecoder().feed(file.read()): print(line)
+    else:
+        run(target, len(sys.argv) > 2 and sys.argv[2] == "dump")